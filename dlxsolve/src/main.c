@@ -0,0 +1,621 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <inttypes.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "libdlx.h"
+
+/**
+ * Solves exact cover problems given as a matrix in either:
+ *
+ * - the text format used by the examples and the test cases: a line
+ *   "(primary, secondary)" followed by one line of 0's and 1's per row.
+ *   In secondary columns a letter a-z stands for a one of color 1-26.
+ *   Reading stops at EOF or at a line reading "solutions".
+ * - the binary format described in matrix_file.h.
+ *
+ * Rows are identified by their index (text) or row id (binary).
+ */
+
+enum mode {
+	MODE_COUNT,     /* Print the amount of solutions. */
+	MODE_ENUMERATE, /* Print solutions, at most `limit' if it's not 0. */
+	MODE_CONVERT,   /* Write the matrix to a binary matrix file. */
+	MODE_ESTIMATE,  /* Estimate the size of the search. */
+	MODE_SPLIT,     /* Print the subproblems `levels' levels down. */
+	MODE_SUBPROBLEM, /* Count the subproblems listed in `input'. */
+	MODE_SAMPLE     /* Print `limit' solutions picked at random. */
+};
+
+static void usage(const char *name)
+{
+	fprintf(stderr,
+		"usage: %s [-c | -b levels | -1 | -n N | -a | -u N | -w output | -E probes |\n"
+		"           -S levels | -P list] [-p] [-e linked|cells|bitset]\n"
+		"           [-s scan|buckets] [-t threads] [-N nodes] [-T seconds] [-z] [file]\n"
+		"\n"
+		"  -c          count the solutions (default)\n"
+		"  -b levels   count, and print the count under every row chosen at the\n"
+		"              first levels levels as \"level row count\" lines\n"
+		"  -1          print the first solution\n"
+		"  -n N        print the first N solutions\n"
+		"  -a          print all solutions\n"
+		"  -u N        print N solutions picked uniformly at random (implies -z)\n"
+		"  -w output   convert the matrix to a binary matrix file\n"
+		"  -E probes   estimate the size of the search with this many random probes\n"
+		"  -S levels   split the search levels levels down and print the subproblems\n"
+		"  -P list     count the subproblems listed one per line in list, - for stdin\n"
+		"  -p          reduce the matrix before solving it, see dlx_matrix_preprocess\n"
+		"  -e engine   engine to solve with, linked, cells (experimental) or\n"
+		"              bitset; by default bitset for up to %d columns and linked\n"
+		"              otherwise\n"
+		"  -s select   find the smallest column by a scan (default) or from\n"
+		"              buckets by size, the latter on the linked engine\n"
+		"  -t threads  count using this many threads, or with -1 race this many\n"
+		"              randomized searches for the first solution; 0 for one per CPU\n"
+		"  -N nodes    stop counting after visiting this many nodes of the search\n"
+		"  -T seconds  stop counting after this many seconds\n"
+		"  -z          count or print the solutions by building their diagram, see\n"
+		"              dlx_zdd.h; not for matrices with colors\n"
+		"\n"
+		"Reads the matrix from stdin if no file is given, binary matrix files\n"
+		"have to be given as a file.  Solutions are printed one per line as a\n"
+		"comma separated list of rows, and so are subproblems.  The counts of\n"
+		"the subproblems printed by -S add up to the count of the matrix, so\n"
+		"they can be counted by -P in separate processes, pass -p to both or\n"
+		"neither.  With -p the rows that are in every solution are printed in\n"
+		"front of the others, and -w writes the reduced matrix without them.  A\n"
+		"count that is stopped by -N or -T is printed as far as it got, and\n"
+		"dlxsolve exits with status 2.\n",
+		name, DLX_BITSET_COLUMNS);
+	exit(1);
+}
+
+/**
+ * Parse the argument of an option that takes an amount, anything but a
+ * decimal number up to \c max gets the usage text.
+ */
+static unsigned long long parse_amount(const char *name, const char *arg, unsigned long long max)
+{
+	char *end;
+
+	errno = 0;
+	const unsigned long long value = strtoull(arg, &end, 10);
+	if (*arg < '0' || *arg > '9' || *end != '\0' || errno != 0 || value > max) {
+		usage(name);
+	}
+
+	return value;
+}
+
+/**
+ * Same as parse_amount, for a number of seconds.
+ */
+static double parse_seconds(const char *name, const char *arg)
+{
+	char *end;
+
+	errno = 0;
+	const double value = strtod(arg, &end);
+	if (((*arg < '0' || *arg > '9') && *arg != '.') || *end != '\0' || errno != 0 || !isfinite(value)) {
+		usage(name);
+	}
+
+	return value;
+}
+
+/**
+ * Read a matrix in the text format, one row at a time.
+ */
+static struct dlx_matrix *read_text(FILE *in)
+{
+	size_t primary, secondary;
+
+	if (fscanf(in, " (%zu , %zu )", &primary, &secondary) != 2) {
+		fprintf(stderr, "Expected \"(primary, secondary)\" at line 1.\n");
+		exit(1);
+	}
+
+	const size_t num_columns = primary + secondary;
+	struct dlx_matrix *mat = dlx_matrix_create_growable(primary, secondary);
+	if (mat == 0) {
+		fprintf(stderr, "Out of memory.\n");
+		exit(1);
+	}
+
+	char *line = 0;
+	size_t line_size = 0;
+	ssize_t len;
+
+	/* Skip the rest of the first line, a matrix without rows may end
+	   right there. */
+	if (getline(&line, &line_size, in) < 0 && ferror(in)) {
+		fprintf(stderr, "Input error.\n");
+		exit(1);
+	}
+
+	size_t rows = 0;
+	for (size_t current_line = 2; (len = getline(&line, &line_size, in)) >= 0; ++current_line) {
+		while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r')) {
+			line[--len] = '\0';
+		}
+
+		if (len == 0) {
+			continue;
+		}
+		if (strcmp(line, "solutions") == 0) {
+			break;
+		}
+		if ((size_t)len != num_columns) {
+			fprintf(stderr, "Line %zu has %zd columns, expected %zu.\n", current_line, len, num_columns);
+			exit(1);
+		}
+
+		if (dlx_matrix_begin_new_row(mat, (void *)rows) == 0) {
+			fprintf(stderr, "Out of memory.\n");
+			exit(1);
+		}
+		for (size_t i = 0; i < num_columns; ++i) {
+			const bool colored = i >= primary && line[i] >= 'a' && line[i] <= 'z';
+			if (line[i] == '1' || colored) {
+				if (!dlx_matrix_current_row_set_colored_one(mat, i, colored ? line[i] - 'a' + 1 : 0)) {
+					fprintf(stderr, "Out of memory.\n");
+					exit(1);
+				}
+			} else if (line[i] != '0') {
+				fprintf(stderr, "Unexpected character at line %zu, character %zu.\n", current_line,
+					i + 1);
+				exit(1);
+			}
+		}
+		++rows;
+	}
+
+	if (ferror(in)) {
+		fprintf(stderr, "Input error.\n");
+		exit(1);
+	}
+
+	free(line);
+	return mat;
+}
+
+/**
+ * Read a matrix from a file in either format.
+ */
+static struct dlx_matrix *read_file(const char *path)
+{
+	FILE *in = fopen(path, "rb");
+	if (in == 0) {
+		fprintf(stderr, "Can't open %s.\n", path);
+		exit(1);
+	}
+
+	char magic[4] = {0};
+	const size_t read = fread(magic, 1, sizeof(magic), in);
+
+	if (read == sizeof(magic) && memcmp(magic, "DLXB", sizeof(magic)) == 0) {
+		fclose(in);
+		struct dlx_matrix *mat = dlx_matrix_load(path);
+		if (mat == 0) {
+			fprintf(stderr, "%s is not a valid binary matrix file.\n", path);
+			exit(1);
+		}
+		return mat;
+	}
+
+	rewind(in);
+	struct dlx_matrix *mat = read_text(in);
+	fclose(in);
+	return mat;
+}
+
+/**
+ * Prints solutions, preceded by the rows that were forced by -p.
+ */
+struct printer {
+	size_t remaining; /* Solutions left to print. */
+	const void **forced;
+	size_t num_forced;
+};
+
+static void print_solution(const struct printer *printer, const void *const *rows, size_t num_rows)
+{
+	for (size_t i = 0; i < printer->num_forced + num_rows; ++i) {
+		const void *row = i < printer->num_forced ? printer->forced[i] : rows[i - printer->num_forced];
+		printf(i > 0 ? ",%zu" : "%zu", (size_t)row);
+	}
+	putchar('\n');
+}
+
+/**
+ * Print every solution until the printer's `remaining' runs out.
+ */
+static bool print_solution_callback(const void *const *rows, size_t num_rows, void *printer)
+{
+	print_solution(printer, rows, num_rows);
+	return --((struct printer *)printer)->remaining > 0;
+}
+
+/**
+ * Count without overflowing, with a breakdown for the first `levels' levels.
+ */
+static void print_count(struct dlx_matrix *mat, size_t levels)
+{
+	char buffer[DLX_COUNT_STRING_SIZE];
+	struct dlx_count total;
+	struct dlx_branch_count *branches = 0;
+	size_t num_branches = 0;
+
+	if (!dlx_recursive_solver_count_solutions_breakdown(mat, levels, &total, &branches, &num_branches)) {
+		fprintf(stderr, "Out of memory.\n");
+		exit(1);
+	}
+
+	printf("%s\n", dlx_count_format(total, buffer));
+	for (size_t i = 0; i < num_branches; ++i) {
+		printf("%zu %zu %s\n", branches[i].level, (size_t)branches[i].user_data,
+		       dlx_count_format(branches[i].count, buffer));
+	}
+
+	free(branches);
+}
+
+/**
+ * Count within a budget.
+ *
+ * @return false if the count was stopped
+ */
+static bool print_count_budget(struct dlx_matrix *mat, uint64_t max_nodes, double seconds)
+{
+	struct dlx_budget *budget = dlx_budget_create();
+
+	if (budget == 0) {
+		fprintf(stderr, "Out of memory.\n");
+		exit(1);
+	}
+
+	dlx_budget_set_max_nodes(budget, max_nodes);
+	dlx_budget_set_time_limit(budget, seconds);
+	printf("%zu\n", dlx_recursive_solver_count_solutions_budget(mat, budget));
+
+	const enum dlx_budget_status status = dlx_budget_status(budget);
+	if (status != DLX_BUDGET_OK) {
+		fprintf(stderr, "Stopped by the %s limit after %" PRIu64 " nodes, the count is incomplete.\n",
+			status == DLX_BUDGET_NODES ? "node" : "time", dlx_budget_nodes(budget));
+	}
+
+	dlx_budget_destroy(budget);
+	return status == DLX_BUDGET_OK;
+}
+
+static bool print_subproblem_callback(const size_t *rows, size_t num_rows, void *ctx)
+{
+	(void)ctx;
+	for (size_t i = 0; i < num_rows; ++i) {
+		printf(i > 0 ? ",%zu" : "%zu", rows[i]);
+	}
+	putchar('\n');
+	return true;
+}
+
+/**
+ * Count the subproblems listed in `path', as printed by -S, and print the
+ * total.
+ */
+static void print_count_subproblems(struct dlx_matrix *mat, const char *path)
+{
+	FILE *in = strcmp(path, "-") == 0 ? stdin : fopen(path, "r");
+	if (in == 0) {
+		fprintf(stderr, "Can't open %s.\n", path);
+		exit(1);
+	}
+
+	/* Every row covers a different primary column. */
+	const size_t max_rows = dlx_matrix_num_primary_columns(mat);
+	size_t *rows = malloc(sizeof(*rows) * (max_rows + 1));
+	if (rows == 0) {
+		fprintf(stderr, "Out of memory.\n");
+		exit(1);
+	}
+
+	char *line = 0;
+	size_t line_size = 0;
+	struct dlx_count total = {0, 0};
+
+	for (size_t current_line = 1; getline(&line, &line_size, in) >= 0; ++current_line) {
+		size_t num_rows = 0;
+		char *p = line;
+		char *end;
+
+		for (;;) {
+			while (*p == ' ' || *p == '\t') {
+				++p;
+			}
+			if (*p == '\n' || *p == '\r' || *p == '\0') {
+				break;
+			}
+			const unsigned long long row = strtoull(p, &end, 10);
+			if (end == p || num_rows == max_rows || (*end != ',' && *end != '\n' && *end != '\r' &&
+								 *end != '\0')) {
+				fprintf(stderr, "Line %zu is not a list of rows.\n", current_line);
+				exit(1);
+			}
+			rows[num_rows++] = (size_t)row;
+			p = *end == ',' ? end + 1 : end;
+		}
+
+		struct dlx_count count;
+		if (!dlx_recursive_solver_count_subproblem(mat, rows, num_rows, &count)) {
+			fprintf(stderr, "Line %zu is not a subproblem of the matrix.\n", current_line);
+			exit(1);
+		}
+		total = dlx_count_add(total, count);
+	}
+
+	if (ferror(in)) {
+		fprintf(stderr, "Input error.\n");
+		exit(1);
+	}
+
+	char buffer[DLX_COUNT_STRING_SIZE];
+	printf("%s\n", dlx_count_format(total, buffer));
+
+	free(line);
+	free(rows);
+	if (in != stdin) {
+		fclose(in);
+	}
+}
+
+/**
+ * Build the diagram of all solutions, exits if it can't.
+ */
+static struct dlx_zdd *build_zdd(struct dlx_matrix *mat)
+{
+	struct dlx_zdd *zdd = dlx_zdd_create(mat, 0);
+
+	if (zdd == 0) {
+		fprintf(stderr, "Can't build the diagram, the matrix has colors or memory ran out.\n");
+		exit(1);
+	}
+
+	return zdd;
+}
+
+/**
+ * Print `limit' solutions picked at random, with a fixed seed so that runs
+ * can be repeated.
+ */
+static void print_samples(struct dlx_zdd *zdd, size_t max_rows, struct printer *printer, size_t limit)
+{
+	const void **solution = malloc(sizeof(*solution) * (max_rows + 1));
+	uint64_t state = 1;
+	size_t num_rows;
+
+	if (solution == 0) {
+		fprintf(stderr, "Out of memory.\n");
+		exit(1);
+	}
+	for (size_t i = 0; i < limit && dlx_zdd_sample(zdd, &state, solution, &num_rows); ++i) {
+		print_solution(printer, solution, num_rows);
+	}
+	free(solution);
+}
+
+static void print_estimate(struct dlx_matrix *mat, size_t probes)
+{
+	struct dlx_estimate e;
+
+	if (!dlx_estimate_search(mat, probes, 0, &e)) {
+		fprintf(stderr, "Out of memory.\n");
+		exit(1);
+	}
+
+	const char *names[] = {"nodes", "solutions", "updates"};
+	const struct dlx_estimate_value *values[] = {&e.nodes, &e.solutions, &e.updates};
+	for (size_t i = 0; i < 3; ++i) {
+		printf("%-9s %.6g (95%% confidence interval %.6g - %.6g)\n", names[i], values[i]->mean, values[i]->low,
+		       values[i]->high);
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	enum mode mode = MODE_COUNT;
+	size_t limit = 0;
+	enum dlx_engine engine = DLX_ENGINE_LINKED;
+	size_t bitset_columns = DLX_BITSET_COLUMNS;
+	enum dlx_column_selection selection = DLX_SELECTION_SCAN;
+	bool preprocess = false;
+	bool zdd = false;
+	struct printer printer = {0, 0, 0};
+	const char *output = 0;
+	const char *input = 0;
+	size_t threads = 1;
+	size_t levels = 0;
+	uint64_t max_nodes = 0;
+	double seconds = 0;
+	int status = 0;
+
+	int opt;
+	while ((opt = getopt(argc, argv, "cb:1n:au:w:E:S:P:pe:s:t:N:T:z")) != -1) {
+		switch (opt) {
+		case 'c':
+			mode = MODE_COUNT;
+			break;
+		case 'b':
+			mode = MODE_COUNT;
+			levels = (size_t)parse_amount(argv[0], optarg, SIZE_MAX);
+			break;
+		case '1':
+			mode = MODE_ENUMERATE;
+			limit = 1;
+			break;
+		case 'n':
+			mode = MODE_ENUMERATE;
+			limit = (size_t)parse_amount(argv[0], optarg, SIZE_MAX);
+			if (limit == 0) {
+				usage(argv[0]);
+			}
+			break;
+		case 'a':
+			mode = MODE_ENUMERATE;
+			limit = 0;
+			break;
+		case 'u':
+			mode = MODE_SAMPLE;
+			limit = (size_t)parse_amount(argv[0], optarg, SIZE_MAX);
+			if (limit == 0) {
+				usage(argv[0]);
+			}
+			break;
+		case 'w':
+			mode = MODE_CONVERT;
+			output = optarg;
+			break;
+		case 'E':
+			mode = MODE_ESTIMATE;
+			limit = (size_t)parse_amount(argv[0], optarg, SIZE_MAX);
+			if (limit == 0) {
+				usage(argv[0]);
+			}
+			break;
+		case 'S':
+			mode = MODE_SPLIT;
+			levels = (size_t)parse_amount(argv[0], optarg, SIZE_MAX);
+			break;
+		case 'P':
+			mode = MODE_SUBPROBLEM;
+			input = optarg;
+			break;
+		case 'p':
+			preprocess = true;
+			break;
+		case 'e':
+			if (strcmp(optarg, "linked") == 0) {
+				engine = DLX_ENGINE_LINKED;
+				bitset_columns = 0;
+			} else if (strcmp(optarg, "bitset") == 0) {
+				engine = DLX_ENGINE_LINKED;
+				bitset_columns = SIZE_MAX;
+			} else if (strcmp(optarg, "cells") == 0) {
+				engine = DLX_ENGINE_CELLS;
+			} else {
+				usage(argv[0]);
+			}
+			break;
+		case 's':
+			if (strcmp(optarg, "scan") == 0) {
+				selection = DLX_SELECTION_SCAN;
+			} else if (strcmp(optarg, "buckets") == 0) {
+				selection = DLX_SELECTION_BUCKETS;
+			} else {
+				usage(argv[0]);
+			}
+			break;
+		case 't':
+			threads = (size_t)parse_amount(argv[0], optarg, SIZE_MAX);
+			break;
+		case 'N':
+			max_nodes = parse_amount(argv[0], optarg, UINT64_MAX);
+			break;
+		case 'T':
+			seconds = parse_seconds(argv[0], optarg);
+			break;
+		case 'z':
+			zdd = true;
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+
+	if (optind + 1 < argc) {
+		usage(argv[0]);
+	}
+
+	/* Solutions can be plentiful, don't flush every line. */
+	setvbuf(stdout, 0, _IOFBF, 1 << 16);
+
+	struct dlx_matrix *mat = optind < argc ? read_file(argv[optind]) : read_text(stdin);
+	dlx_matrix_set_engine(mat, engine);
+	dlx_matrix_set_bitset_columns(mat, bitset_columns);
+	dlx_matrix_set_column_selection(mat, selection);
+
+	if (preprocess) {
+		size_t *rows;
+		size_t num_rows;
+		struct dlx_matrix *reduced =
+			dlx_matrix_preprocess(mat, &printer.forced, &printer.num_forced, &rows, &num_rows);
+
+		if (reduced == 0) {
+			fprintf(stderr, "Out of memory.\n");
+			exit(1);
+		}
+		free(rows);
+		dlx_matrix_destroy(mat);
+		mat = reduced;
+	}
+
+	if (mode == MODE_CONVERT) {
+		if (!dlx_matrix_save(mat, output)) {
+			fprintf(stderr, "Can't write %s.\n", output);
+			exit(1);
+		}
+	} else if (mode == MODE_ESTIMATE) {
+		print_estimate(mat, limit);
+	} else if (mode == MODE_SPLIT) {
+		if (!dlx_recursive_solver_split(mat, levels, print_subproblem_callback, 0)) {
+			fprintf(stderr, "Out of memory.\n");
+			exit(1);
+		}
+	} else if (mode == MODE_SUBPROBLEM) {
+		print_count_subproblems(mat, input);
+	} else if (mode == MODE_SAMPLE || (zdd && (mode == MODE_COUNT || mode == MODE_ENUMERATE))) {
+		struct dlx_zdd *diagram = build_zdd(mat);
+		char buffer[DLX_COUNT_STRING_SIZE];
+
+		if (mode == MODE_SAMPLE) {
+			print_samples(diagram, dlx_matrix_num_primary_columns(mat), &printer, limit);
+		} else if (mode == MODE_COUNT) {
+			printf("%s\n", dlx_count_format(dlx_zdd_count(diagram), buffer));
+		} else {
+			printer.remaining = limit == 0 ? SIZE_MAX : limit;
+			dlx_zdd_enumerate(diagram, print_solution_callback, &printer);
+		}
+		dlx_zdd_destroy(diagram);
+	} else if (mode == MODE_COUNT && (max_nodes != 0 || seconds > 0)) {
+		status = print_count_budget(mat, max_nodes, seconds) ? 0 : 2;
+	} else if (mode == MODE_COUNT && threads != 1) {
+		char buffer[DLX_COUNT_STRING_SIZE];
+		printf("%s\n", dlx_count_format(dlx_recursive_solver_count_solutions_parallel(mat, threads), buffer));
+	} else if (mode == MODE_COUNT) {
+		print_count(mat, levels);
+	} else if (limit == 1 && threads != 1) {
+		const void **solution = malloc(sizeof(*solution) * (dlx_matrix_num_primary_columns(mat) + 1));
+		size_t num_rows;
+
+		if (solution == 0) {
+			fprintf(stderr, "Out of memory.\n");
+			exit(1);
+		}
+		if (dlx_iterative_solver_find_solution_portfolio(mat, threads, 0, solution, &num_rows)) {
+			print_solution(&printer, solution, num_rows);
+		}
+		free(solution);
+	} else {
+		printer.remaining = limit == 0 ? SIZE_MAX : limit;
+		dlx_recursive_solver_enumerate(mat, print_solution_callback, &printer);
+	}
+
+	free(printer.forced);
+	dlx_matrix_destroy(mat);
+	exit(status);
+}
@@ -0,0 +1,40 @@
+#!/usr/bin/env python3
+import os
+import resource
+import subprocess
+import sys
+
+"""
+This program compares the engines (see enum dlx_engine in
+libdlx/include/matrix.h) by counting the solutions of matrices with
+dlxsolve on each of them.  It prints the best user time out of a number
+of runs, in seconds.  The matrices default to the largest queens, latin
+square and sudoku test cases.
+
+For instance:
+$ ./benchmark-engines.py ../build/bin/dlxsolve
+$ ./benchmark-engines.py ../build/bin/dlxsolve 5 queens-14.dlxb
+"""
+
+if len(sys.argv) < 2:
+	sys.stderr.write('usage: %s dlxsolve [runs [file...]]\n' % sys.argv[0])
+	sys.exit(1)
+
+dlxsolve = sys.argv[1]
+runs = int(sys.argv[2]) if len(sys.argv) > 2 else 3
+cases = os.path.join(sys.path[0], '..', 'libdlx', 'test', 'cases')
+paths = sys.argv[3:] or [os.path.join(cases, case) for case in ['queens-12', 'latin-square-all-4x4', 'sudoku-all-4x4']]
+
+engines = ['linked', 'cells', 'bitset']
+
+
+def user_time(command):
+	before = resource.getrusage(resource.RUSAGE_CHILDREN).ru_utime
+	subprocess.run(command, stdout=subprocess.DEVNULL, check=True)
+	return resource.getrusage(resource.RUSAGE_CHILDREN).ru_utime - before
+
+
+print('%-30s %s' % ('matrix', ' '.join('%10s' % engine for engine in engines)))
+for path in paths:
+	times = [min(user_time([dlxsolve, '-e', engine, path]) for _ in range(runs)) for engine in engines]
+	print('%-30s %s' % (os.path.basename(path), ' '.join('%10.3f' % t for t in times)))
@@ -0,0 +1,62 @@
+#!/usr/bin/env python3
+import sys
+import struct
+from array import array
+
+"""
+This program converts an exact cover problem in the text format read by
+count-solutions.py to a binary matrix file (see
+libdlx/include/matrix_file.h) that libdlx can load without parsing.
+
+The i-th row (counting from 0) gets row id i.  A letter a-z is a one of
+color 1-26.  Reading stops at EOF or at a line reading "solutions", as
+found in the test cases.
+
+For instance:
+$ ./generate-n-queens-matrix.py 8 | ./convert-to-binary.py queens-8.dlxb
+"""
+
+if len(sys.argv) != 2:
+	sys.stderr.write('usage: %s output-file < matrix\n' % sys.argv[0])
+	sys.exit(1)
+
+# First read the metadata
+metadata = sys.stdin.readline()
+(num_primary_columns, num_secondary_columns) = eval(metadata)
+num_columns = num_primary_columns + num_secondary_columns
+
+column_counts = array('Q', [0] * num_columns)
+row_offsets = array('Q', [0])
+column_indices = array('I')
+colors = array('I')
+
+# Stream the rows, one at a time.
+for line in sys.stdin:
+	row = line.strip()
+	if row == 'solutions':
+		break
+	if len(row) != num_columns:
+		sys.stderr.write('row %d has %d columns, expected %d\n' % (len(row_offsets), len(row), num_columns))
+		sys.exit(1)
+	for i, x in enumerate(row):
+		if x != '0':
+			column_indices.append(i)
+			colors.append(0 if x == '1' else ord(x) - ord('a') + 1)
+			column_counts[i] += 1
+	row_offsets.append(len(column_indices))
+
+num_rows = len(row_offsets) - 1
+row_ids = array('Q', range(num_rows))
+
+# Arrays are written in native byte order, the byte order mark tells
+# libdlx which one that is.  Colors are only written if there are any.
+arrays = [column_counts, row_offsets, row_ids, column_indices]
+flags = 0
+if any(colors):
+	arrays.append(colors)
+	flags = 1
+with open(sys.argv[1], 'wb') as f:
+	f.write(struct.pack('=4sIII4Q', b'DLXB', 0x01020304, 1, flags,
+		num_primary_columns, num_secondary_columns, num_rows, len(column_indices)))
+	for a in arrays:
+		a.tofile(f)
@@ -0,0 +1,94 @@
+#ifndef LIBDLX_BUDGET_H
+#define LIBDLX_BUDGET_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @file
+ *
+ * Bound the work done by a call to a solver.
+ *
+ * A budget limits the nodes of the search tree a call visits, the updates
+ * it makes to the links (one for every column and every node taken out of
+ * a list, as counted by Knuth) and the time it takes.  Every call the
+ * budget is passed to starts from zero.  Any thread can cancel the calls
+ * running on a budget.
+ *
+ * A call that runs out of budget unwinds the search, so the matrix is in
+ * its initial state when it returns, and dlx_budget_status tells why it
+ * stopped.
+ *
+ * The time limit and cancellation are checked every 1024 nodes, the other
+ * limits at every node.
+ */
+
+/**
+ * Why the last call on a budget stopped.
+ */
+enum dlx_budget_status {
+	DLX_BUDGET_OK,       /**< It wasn't stopped. **/
+	DLX_BUDGET_NODES,    /**< It visited the maximum amount of nodes. **/
+	DLX_BUDGET_UPDATES,  /**< It made more than the maximum amount of updates. **/
+	DLX_BUDGET_TIME,     /**< It ran out of time. **/
+	DLX_BUDGET_CANCELLED /**< The budget was cancelled. **/
+};
+
+struct dlx_budget;
+
+/**
+ * Create a budget without any limits.
+ *
+ * @return the budget or 0 if memory could not be allocated.  It must be
+ *         freed using dlx_budget_destroy.
+ */
+struct dlx_budget *dlx_budget_create(void);
+
+/**
+ * Destroy a budget, no call may be running on it.
+ */
+void dlx_budget_destroy(struct dlx_budget *);
+
+/**
+ * @param max_nodes the most nodes a call may visit, 0 for no limit
+ */
+void dlx_budget_set_max_nodes(struct dlx_budget *, uint64_t max_nodes);
+
+/**
+ * @param max_updates the call stops as soon as it made more updates than
+ *        this, 0 for no limit
+ */
+void dlx_budget_set_max_updates(struct dlx_budget *, uint64_t max_updates);
+
+/**
+ * @param seconds the longest a call may run, 0 for no limit
+ */
+void dlx_budget_set_time_limit(struct dlx_budget *, double seconds);
+
+/**
+ * Stop the calls running on the budget, and all later ones until
+ * dlx_budget_reset is called.  Can be called from any thread.
+ */
+void dlx_budget_cancel(struct dlx_budget *);
+
+/**
+ * Undo dlx_budget_cancel.
+ */
+void dlx_budget_reset(struct dlx_budget *);
+
+/**
+ * @return why the last call on the budget stopped
+ */
+enum dlx_budget_status dlx_budget_status(const struct dlx_budget *);
+
+/**
+ * @return the nodes visited by the last call on the budget
+ */
+uint64_t dlx_budget_nodes(const struct dlx_budget *);
+
+/**
+ * @return the updates made by the last call on the budget
+ */
+uint64_t dlx_budget_updates(const struct dlx_budget *);
+
+#endif /* #ifndef LIBDLX_BUDGET_H */
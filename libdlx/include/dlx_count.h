@@ -0,0 +1,55 @@
+#ifndef LIBDLX_COUNT_H
+#define LIBDLX_COUNT_H
+
+#include <stdint.h>
+
+/**
+ * @file
+ *
+ * 128-bit solution counts.
+ *
+ * Counts like the number of latin squares of order 6 and up don't fit
+ * a size_t, these are kept in two 64-bit halves instead.
+ */
+
+/**
+ * An unsigned 128-bit count, \c high * 2^64 + \c low.
+ */
+struct dlx_count {
+	uint64_t low;
+	uint64_t high;
+};
+
+/**
+ * Size of the buffer dlx_count_format needs: 39 digits and a '\0'.
+ */
+#define DLX_COUNT_STRING_SIZE 40
+
+/**
+ * @return a + b, modulo 2^128
+ */
+static inline struct dlx_count dlx_count_add(struct dlx_count a, struct dlx_count b)
+{
+	const struct dlx_count sum = {a.low + b.low, a.high + b.high + (a.low + b.low < a.low)};
+	return sum;
+}
+
+/**
+ * @return a - b, modulo 2^128
+ */
+static inline struct dlx_count dlx_count_subtract(struct dlx_count a, struct dlx_count b)
+{
+	const struct dlx_count difference = {a.low - b.low, a.high - b.high - (a.low < b.low)};
+	return difference;
+}
+
+/**
+ * Write a count in decimal.
+ *
+ * @param count the count
+ * @param buffer room for DLX_COUNT_STRING_SIZE characters
+ * @return \c buffer
+ */
+char *dlx_count_format(struct dlx_count, char *buffer);
+
+#endif /* #ifndef LIBDLX_COUNT_H */
@@ -0,0 +1,64 @@
+#ifndef LIBDLX_ESTIMATOR_H
+#define LIBDLX_ESTIMATOR_H
+
+#include "matrix.h"
+
+#include <stdbool.h>
+
+/**
+ * @file
+ *
+ * Estimate the size of a search before running it.
+ *
+ * Implements Knuth's estimator (see "Estimating the efficiency of
+ * backtrack programs", 1975): a probe walks from the root of the search
+ * tree to a leaf, choosing a random row in every column it covers.  A
+ * node at which there were d_1, d_2, .., d_k choices on the way down
+ * stands in for d_1 * d_2 * .. * d_k nodes.  The sum over the nodes of a
+ * probe is an unbiased estimate of the size of the tree, averaging over
+ * many probes narrows it down.
+ *
+ * The estimates are often far too low on most probes and far too high on
+ * a few, so the confidence intervals are only trustworthy after many
+ * probes.
+ */
+
+/**
+ * One estimated quantity.
+ */
+struct dlx_estimate_value {
+	double mean;           /**< Estimate, the mean over all probes. **/
+	double standard_error; /**< Standard deviation of the mean. **/
+	double low;            /**< Bounds of the 95% confidence interval, **/
+	double high;           /**< mean -/+ 1.96 standard errors, low is at least 0. **/
+};
+
+/**
+ * Estimates for a complete search of a matrix.
+ */
+struct dlx_estimate {
+	size_t probes;                       /**< Amount of probes run. **/
+	struct dlx_estimate_value nodes;     /**< Nodes in the search tree, including the root. **/
+	struct dlx_estimate_value solutions; /**< Solutions, leaves of the search tree. **/
+	struct dlx_estimate_value updates;   /**< Nodes removed from a column by covering. **/
+};
+
+/**
+ * Estimate the size of the search for all solutions of a matrix.
+ *
+ * The probes choose columns the same way the solvers do, so the estimate
+ * is for the tree the solvers would search, on either engine.  The probes
+ * run on the matrix itself, which is back in its initial state when this
+ * returns and can be solved right away.
+ *
+ * @param the matrix
+ * @param probes amount of probes to run, at least 1
+ * @param seed seed for the random choices, the same seed gives the same
+ *        estimate
+ * @param estimate receives the estimate
+ * @return false if the matrix has multiplicities or memory could not be
+ *         allocated
+ */
+bool dlx_estimate_search(struct dlx_matrix *, size_t probes, unsigned int seed, struct dlx_estimate *estimate);
+
+#endif /* #ifndef LIBDLX_ESTIMATOR_H */
@@ -0,0 +1,103 @@
+#ifndef LIBDLX_INCREMENTAL_SOLVER_H
+#define LIBDLX_INCREMENTAL_SOLVER_H
+
+#include "matrix.h"
+
+#include <stdbool.h>
+
+/**
+ * @file
+ *
+ * Incremental solver: solves a matrix under a stack of assumptions, and
+ * remembers what it found out for the next call.
+ *
+ * An assumption either forces a row into every solution or hides a row.
+ * They are pushed and popped like the rows of a search, so asking the
+ * same question about many nearly identical matrices (as a puzzle
+ * generator does when it takes the givens away one by one) only changes
+ * the links the assumptions touch.
+ *
+ * Once a count found at most one solution, the solver knows every
+ * solution there is.  Popping a hidden row only adds solutions that take
+ * that row, so the next count leaves every branch of the search where
+ * none of the rows unhidden since is left.  Forcing or hiding rows only
+ * takes solutions away, so that keeps what the solver knows; popping a
+ * forced row makes it start over from the whole matrix.
+ *
+ * The search runs on the linked toroid whatever the engine.  The matrix
+ * may not be changed while the solver exists, other than through it.
+ */
+
+struct dlx_incremental_solver;
+
+/**
+ * Create an incremental solver.
+ *
+ * @param the matrix, rows hidden at this point can't be pushed
+ * @return the solver, or 0 if the matrix has colors or multiplicities or
+ *         if memory could not be allocated.  It must be freed using
+ *         dlx_incremental_solver_destroy.
+ */
+struct dlx_incremental_solver *dlx_incremental_solver_create(struct dlx_matrix *);
+
+/**
+ * Destroy a solver, popping all its assumptions.
+ */
+void dlx_incremental_solver_destroy(struct dlx_incremental_solver *);
+
+/**
+ * Assume a row is in every solution.
+ *
+ * @param the solver
+ * @param row index of the row, rows are numbered in the order they were
+ *        added
+ * @return false if the row is not in the matrix as the assumptions leave
+ *         it: it's hidden or shares a column with a forced row
+ */
+bool dlx_incremental_solver_push_forced_row(struct dlx_incremental_solver *, size_t row);
+
+/**
+ * Assume a row is in no solution, as dlx_matrix_hide_row.
+ *
+ * @param the solver
+ * @param row index of the row
+ * @return false if the row is not in the matrix as the assumptions leave
+ *         it
+ */
+bool dlx_incremental_solver_push_hidden_row(struct dlx_incremental_solver *, size_t row);
+
+/**
+ * Take back the assumption pushed last.
+ *
+ * @pre dlx_incremental_solver_num_assumptions returns more than 0
+ */
+void dlx_incremental_solver_pop(struct dlx_incremental_solver *);
+
+size_t dlx_incremental_solver_num_assumptions(const struct dlx_incremental_solver *);
+
+/**
+ * Count the solutions under the assumptions, stopping as soon as \c limit
+ * of them are found.
+ *
+ * @param the solver
+ * @param limit the most solutions to count, 0 for no limit
+ * @param solution if not 0, receives the user_data of the rows of a
+ *        solution, forced ones included.  That is not necessarily the
+ *        first one dlx_recursive_solver_count_solutions_up_to would find.
+ *        It must have room for a row per primary column and per forced
+ *        row.
+ * @param num_rows if not 0, receives the number of rows in the solution.
+ *        Not touched if there is no solution.
+ * @return the amount of solutions, at most \c limit
+ */
+size_t dlx_incremental_solver_count_solutions_up_to(struct dlx_incremental_solver *, size_t limit,
+						    const void **solution, size_t *num_rows);
+
+/**
+ * Whether there is exactly one solution under the assumptions.
+ *
+ * Same as dlx_incremental_solver_count_solutions_up_to with a limit of 2.
+ */
+bool dlx_incremental_solver_is_unique(struct dlx_incremental_solver *, const void **solution, size_t *num_rows);
+
+#endif /* #ifndef LIBDLX_INCREMENTAL_SOLVER_H */
@@ -1,6 +1,7 @@
 #ifndef LIBDLX_ITERATIVE_SOLVER_H
 #define LIBDLX_ITERATIVE_SOLVER_H
 
+#include "dlx_budget.h"
 #include "matrix.h"
 
 #include <stdbool.h>
@@ -22,7 +23,8 @@ struct dlx_solver;
  * Note: dlx_matrix* is not affected in any way.
  *
  * @param dlx_matrix* the matrix for which to construct the solver
- * @return pointer to the solver structure
+ * @return pointer to the solver structure, or 0 if the matrix has
+ *         multiplicities or memory could not be allocated
  */
 struct dlx_solver *dlx_iterative_solver_create(struct dlx_matrix *);
 
@@ -46,6 +48,44 @@ void dlx_iterative_solver_destroy(struct dlx_solver *);
  */
 bool dlx_iterative_solver_find_solution(struct dlx_solver *);
 
+/**
+ * Bound every later call to dlx_iterative_solver_find_solution.
+ *
+ * A call that runs out of budget unwinds the search, so the matrix is in
+ * its initial state, and returns false.  Tell this apart from running out
+ * of solutions with dlx_budget_status.  The solver remembers where the
+ * search stopped: the next call continues from there, unless the solver
+ * is reset.
+ *
+ * @param dlx_solver structure
+ * @param budget the budget, 0 for none
+ */
+void dlx_iterative_solver_set_budget(struct dlx_solver *, struct dlx_budget *budget);
+
+/**
+ * Find a single solution with a portfolio of searches.
+ *
+ * Runs several searches on their own threads, one in the same order as
+ * dlx_iterative_solver_find_solution and the others on clones of the
+ * matrix, each breaking ties between equally small columns in its own
+ * random order.  The first search to find a solution stops the others.
+ * This cuts the time taken by the unlucky orders that a single search
+ * sometimes gets stuck in.
+ *
+ * Which solution is found depends on which search wins the race.
+ *
+ * @param dlx_matrix* the matrix, it's back in its initial state on return
+ * @param num_searches amount of searches, 0 for one per online CPU
+ * @param seed seed for the random orders
+ * @param solution receives the user_data of the rows of the solution,
+ *        must have room for dlx_matrix_num_primary_columns rows
+ * @param num_rows receives the number of rows in the solution
+ * @return true iff a solution was found, always false if the matrix has
+ *         multiplicities
+ */
+bool dlx_iterative_solver_find_solution_portfolio(struct dlx_matrix *, size_t num_searches, unsigned int seed,
+						  const void **solution, size_t *num_rows);
+
 /**
  * Reset the solver.
  *
@@ -54,6 +94,54 @@ bool dlx_iterative_solver_find_solution(struct dlx_solver *);
  */
 void dlx_iterative_solver_reset(struct dlx_solver *);
 
+/**
+ * Save the position of the search to a checkpoint file.
+ *
+ * The position is stored as the indices of the rows on the path from the
+ * root of the search to where it is, so it doesn't depend on where the
+ * matrix is in memory.  Saving takes time proportional to the depth of
+ * the search.  The file is replaced atomically: if the machine goes down
+ * while saving the previous checkpoint is still there.
+ *
+ * \code{.unparsed}
+ * offset  type       field
+ *      0  char[4]    magic, "DLXC"
+ *      4  uint32     byte order mark, 0x01020304
+ *      8  uint32     version, 1
+ *     12  uint32     1 if the search below the path is done, else 0
+ *     16  uint64     amount of primary columns of the matrix
+ *     24  uint64     amount of secondary columns of the matrix
+ *     32  uint64     amount of rows of the matrix
+ *     40  uint64     amount of ones of the matrix
+ *     48  uint64     D, length of the path
+ *     56  uint64[D]  index of the row chosen at every level, rows are
+ *                    numbered in the order they were added
+ * \endcode
+ *
+ * @param dlx_solver structure, between calls to
+ *        dlx_iterative_solver_find_solution
+ * @param path path of the file
+ * @return false if the file could not be written
+ */
+bool dlx_iterative_solver_save(struct dlx_solver *, const char *path);
+
+/**
+ * Continue a search from a checkpoint file.
+ *
+ * The solver's matrix has to be built the same way as the one the
+ * checkpoint was saved for, then the next call to
+ * dlx_iterative_solver_find_solution continues exactly where that search
+ * was saved.  The search is taken back to the position right away, which
+ * takes time proportional to the depth of the search.
+ *
+ * @param dlx_solver structure
+ * @param path path of the file
+ * @return false if the file could not be read, is not a valid checkpoint
+ *         for the matrix or memory could not be allocated.  The solver is
+ *         reset then.
+ */
+bool dlx_iterative_solver_load(struct dlx_solver *, const char *path);
+
 /**
  * Find out how many rows of the matrix are included in the solution.
  *
@@ -1,8 +1,12 @@
 #ifndef LIBDLX_RECURSIVE_SOLVER_H
 #define LIBDLX_RECURSIVE_SOLVER_H
 
+#include "dlx_budget.h"
+#include "dlx_count.h"
 #include "matrix.h"
 
+#include <stdbool.h>
+
 /**
  * @file
  *
@@ -10,13 +14,235 @@
  *
  * When compared to the iterative solver the implementation
  * of the recursive solver is orders of magnitude more elegant,
- * it's disadvantage is that it only permits *counting* the solutions.
+ * it's disadvantage is that it can't be paused: solutions are either
+ * counted or handed to a callback, all from within a single call.
+ */
+
+/**
+ * Called by dlx_recursive_solver_enumerate for every solution.
+ *
+ * @param rows the user_data of the rows in the solution, only valid
+ *        during the call
+ * @param num_rows the number of rows in the solution
+ * @param ctx the \c ctx passed to dlx_recursive_solver_enumerate
+ * @return true to continue the search, false to stop it
+ */
+typedef bool (*dlx_solution_callback)(const void *const *rows, size_t num_rows, void *ctx);
+
+/**
+ * Called by dlx_recursive_solver_enumerate_up_to_symmetry for every
+ * solution it finds.
+ *
+ * @param rows the user_data of the rows in the solution, only valid
+ *        during the call
+ * @param num_rows the number of rows in the solution
+ * @param weight the number of solutions this one stands for, modulo 2^64
+ *        on 64-bit machines
+ * @param ctx the \c ctx passed to
+ *        dlx_recursive_solver_enumerate_up_to_symmetry
+ * @return true to continue the search, false to stop it
  */
+typedef bool (*dlx_weighted_solution_callback)(const void *const *rows, size_t num_rows, size_t weight, void *ctx);
+
+/**
+ * Called by dlx_recursive_solver_split for every subproblem.
+ *
+ * @param rows the indices of the rows chosen on the way to the
+ *        subproblem, rows are numbered in the order they were added.  Only
+ *        valid during the call.
+ * @param num_rows the number of rows chosen
+ * @param ctx the \c ctx passed to dlx_recursive_solver_split
+ * @return true to continue, false to stop
+ */
+typedef bool (*dlx_subproblem_callback)(const size_t *rows, size_t num_rows, void *ctx);
+
+/**
+ * The solutions under one choice of row at one level of the search, see
+ * dlx_recursive_solver_count_solutions_breakdown.
+ */
+struct dlx_branch_count {
+	size_t level;           /**< Depth of the choice, 0 for the first row chosen. **/
+	const void *user_data;  /**< The row chosen. **/
+	struct dlx_count count; /**< Solutions with that row chosen at that depth. **/
+};
 
 /**
  * @param the matrix to count solutions for
- * @return the amount of solutions
+ * @return the amount of solutions, modulo 2^64 on 64-bit machines, see
+ *         dlx_recursive_solver_count_solutions_wide
  */
 size_t dlx_recursive_solver_count_solutions(struct dlx_matrix *);
 
+/**
+ * Count the solutions, within a budget.
+ *
+ * @param the matrix to count solutions for
+ * @param budget the budget, if the call runs out of it the count is cut
+ *        short, see dlx_budget_status
+ * @return the amount of solutions found, 0 if memory could not be
+ *         allocated for the cells engine
+ */
+size_t dlx_recursive_solver_count_solutions_budget(struct dlx_matrix *, struct dlx_budget *budget);
+
+/**
+ * Count the solutions without overflowing.
+ *
+ * @param the matrix to count solutions for
+ * @return the amount of solutions, 0 if memory could not be allocated for
+ *         the cells engine
+ */
+struct dlx_count dlx_recursive_solver_count_solutions_wide(struct dlx_matrix *);
+
+/**
+ * Count the solutions without overflowing, and break the count down by the
+ * rows chosen at the first \c levels levels of the search.
+ *
+ * There is a branch for every row that was chosen at a level, holding the
+ * solutions found below it.  A row chosen at the same level on different
+ * paths (e.g. at level 1 after different rows at level 0) has a single
+ * branch with the sum of the counts.  All branches of a level add up to
+ * the solutions with more than that many rows.  The counts come out of a
+ * single search, which is a lot cheaper than counting every subtree on
+ * its own.
+ *
+ * @param the matrix to count solutions for
+ * @param levels levels to break the count down for, may be 0
+ * @param total receives the amount of solutions
+ * @param branches receives an array of the branches, ordered by level and
+ *        then by the order the rows were added in.  Free it with free().
+ *        Not touched if \c levels is 0.
+ * @param num_branches receives the amount of branches
+ * @return false if memory could not be allocated
+ */
+bool dlx_recursive_solver_count_solutions_breakdown(struct dlx_matrix *, size_t levels, struct dlx_count *total,
+						     struct dlx_branch_count **branches, size_t *num_branches);
+
+/**
+ * Enumerate the solutions, in the same order as the iterative solver.
+ *
+ * This avoids the iterative solver's state machine and the call per
+ * solution, which makes it the faster choice for visiting every solution.
+ * The matrix is back in its initial state on return, also when the
+ * callback stopped the search.
+ *
+ * @param the matrix to enumerate solutions for
+ * @param callback called for every solution
+ * @param ctx passed to the callback as is
+ * @return the number of solutions passed to the callback, 0 if memory
+ *         could not be allocated
+ */
+size_t dlx_recursive_solver_enumerate(struct dlx_matrix *, dlx_solution_callback callback, void *ctx);
+
+/**
+ * Enumerate the solutions that are left after breaking symmetries, see
+ * dlx_matrix_add_symmetry.
+ *
+ * Every solution is mapped by some symmetry to one of those found, and
+ * their weights add up to the amount of solutions.  Solutions are found
+ * in the same order as by dlx_recursive_solver_enumerate, leaving out
+ * the ones below rows that aren't the first of their orbit.  Without
+ * symmetries that's every solution, with a weight of 1.  The search runs
+ * on the linked toroid whatever the engine.
+ *
+ * @param the matrix to enumerate solutions for
+ * @param callback called for every solution found
+ * @param ctx passed to the callback as is
+ * @return the number of solutions passed to the callback, 0 if memory
+ *         could not be allocated
+ */
+size_t dlx_recursive_solver_enumerate_up_to_symmetry(struct dlx_matrix *, dlx_weighted_solution_callback callback,
+						     void *ctx);
+
+/**
+ * Count the solutions, stopping as soon as \c limit of them are found.
+ *
+ * Once the limit is reached the search unwinds without trying any more
+ * rows, so this only does the work needed to reach the limit.  With a
+ * limit of 2 it tells apart matrices without a solution, with a unique
+ * one and with several, see dlx_recursive_solver_is_unique.
+ *
+ * @param the matrix to count solutions for
+ * @param limit the most solutions to count, 0 for no limit
+ * @param solution if not 0, receives the user_data of the rows of the
+ *        first solution.  It must have room for a row per primary column,
+ *        or per row if a column has a multiplicity other than 1.
+ * @param num_rows if not 0, receives the number of rows in the first
+ *        solution.  Not touched if there is no solution.
+ * @return the amount of solutions, at most \c limit.  0 if memory could
+ *         not be allocated.
+ */
+size_t dlx_recursive_solver_count_solutions_up_to(struct dlx_matrix *, size_t limit, const void **solution,
+						  size_t *num_rows);
+
+/**
+ * Whether the matrix has exactly one solution.
+ *
+ * Same as dlx_recursive_solver_count_solutions_up_to with a limit of 2.
+ *
+ * @param the matrix
+ * @param solution as for dlx_recursive_solver_count_solutions_up_to, set
+ *        if there is at least one solution
+ * @param num_rows as for dlx_recursive_solver_count_solutions_up_to
+ * @return true if there is one solution, false if there are none or more
+ *         than one
+ */
+bool dlx_recursive_solver_is_unique(struct dlx_matrix *, const void **solution, size_t *num_rows);
+
+/**
+ * Split the search into subproblems that can be counted independently,
+ * e.g. by other processes or on other machines.
+ *
+ * Walks the search tree down to \c depth levels and hands every node it
+ * reaches to the callback as the rows chosen on the way there.  Solutions
+ * found above that depth are handed over as well (as subproblems with one
+ * solution), dead ends are left out.  The counts of all subproblems, see
+ * dlx_recursive_solver_count_subproblem, add up to the count of the
+ * matrix.
+ *
+ * @param the matrix to split
+ * @param depth levels to walk down, 0 hands over the matrix as it is
+ * @param callback called for every subproblem
+ * @param ctx passed to the callback as is
+ * @return false if the matrix has multiplicities or memory could not be
+ *         allocated
+ */
+bool dlx_recursive_solver_split(struct dlx_matrix *, size_t depth, dlx_subproblem_callback callback, void *ctx);
+
+/**
+ * Count the solutions of a subproblem found by dlx_recursive_solver_split.
+ *
+ * The matrix has to be built the same way as the one that was split.  The
+ * rows are chosen the way the search chooses them, the solutions below
+ * them are counted and then the matrix is put back in its initial state.
+ *
+ * @param the matrix
+ * @param rows the rows of the subproblem
+ * @param num_rows the number of rows
+ * @param count receives the amount of solutions of the subproblem
+ * @return false if the rows are not a subproblem of the matrix, the
+ *         matrix has multiplicities or memory could not be allocated
+ */
+bool dlx_recursive_solver_count_subproblem(struct dlx_matrix *, const size_t *rows, size_t num_rows,
+					   struct dlx_count *count);
+
+/**
+ * Count the solutions using several threads.
+ *
+ * The search tree is split into subtrees at shallow depths, which are
+ * counted on per-thread copies of the matrix.  Threads that run out of
+ * subtrees steal them from the others, so a few huge subtrees don't leave
+ * the other threads idle.  The result is the same as that of
+ * dlx_recursive_solver_count_solutions_wide.
+ *
+ * The matrix itself is not modified.  If the matrix has multiplicities or
+ * there is not enough memory for the copies the solutions are counted on
+ * the calling thread instead.
+ *
+ * @param the matrix to count solutions for
+ * @param num_threads amount of threads to use, 0 for one per online CPU
+ * @return the amount of solutions, without overflowing as in
+ *         dlx_recursive_solver_count_solutions_wide
+ */
+struct dlx_count dlx_recursive_solver_count_solutions_parallel(struct dlx_matrix *, size_t num_threads);
+
 #endif /* #ifndef LIBDLX_RECURSIVE_SOLVER_H */
@@ -0,0 +1,112 @@
+#ifndef LIBDLX_ZDD_H
+#define LIBDLX_ZDD_H
+
+#include "dlx_count.h"
+#include "dlx_recursive_solver.h"
+#include "matrix.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @file
+ *
+ * All solutions of a matrix as a zero-suppressed decision diagram (ZDD).
+ *
+ * Implements Knuth's DXZ: the search is the one of the recursive solver,
+ * except that every subproblem it solves is remembered by the set of
+ * columns covered on the way to it.  Different paths that cover the
+ * same columns leave the same rows, so when the search runs into a
+ * subproblem it has seen before it reuses the diagram it built for it
+ * rather than searching it again.
+ *
+ * A node of the diagram stands for the solutions of a subproblem that
+ * take one of the rows from some point on in the column the search
+ * branched on.  It holds the first of those rows, the node for the
+ * solutions that take that row (\c hi) and the one for the solutions
+ * that take a later row (\c lo).  Nodes are shared, every node exists
+ * once.  The diagram can be far smaller than the list of solutions,
+ * and counting, sampling or listing them only walks it.
+ *
+ * The subproblems are kept in a cache of a fixed size, a new one takes
+ * the place of whatever was in its entry.  A smaller cache means more
+ * searching, never a different diagram.
+ */
+
+/**
+ * Size in bytes of the cache dlx_zdd_create uses by default.  Every entry
+ * takes a bit per column and a word, so the wider the matrix the fewer
+ * entries fit.
+ */
+#define DLX_ZDD_CACHE_BYTES (1 << 22)
+
+struct dlx_zdd;
+
+/**
+ * Build the diagram of all solutions of a matrix.
+ *
+ * The search runs on the linked toroid whatever the engine.  The matrix
+ * is back in its initial state when this returns, the diagram doesn't
+ * refer to it: it keeps the user_data of the rows.
+ *
+ * @param the matrix
+ * @param cache_bytes size of the cache in bytes, 0 for
+ *        DLX_ZDD_CACHE_BYTES.  It holds at least one subproblem.
+ * @return the diagram, or 0 if the matrix has colors or multiplicities or
+ *         if memory could not be allocated.  It must be freed using
+ *         dlx_zdd_destroy.
+ */
+struct dlx_zdd *dlx_zdd_create(struct dlx_matrix *, size_t cache_bytes);
+
+void dlx_zdd_destroy(struct dlx_zdd *);
+
+/**
+ * @return the amount of nodes in the diagram, not counting the two
+ *         terminal ones
+ */
+size_t dlx_zdd_num_nodes(const struct dlx_zdd *);
+
+/**
+ * @return the amount of solutions
+ */
+struct dlx_count dlx_zdd_count(const struct dlx_zdd *);
+
+/**
+ * Find a solution by its position, in the order
+ * dlx_recursive_solver_enumerate finds them.
+ *
+ * @param the diagram
+ * @param index the position, from 0
+ * @param solution receives the user_data of the rows, room for as many as
+ *        the matrix has primary columns
+ * @param num_rows receives the amount of rows in the solution
+ * @return false if \c index isn't below the amount of solutions
+ */
+bool dlx_zdd_get_solution(const struct dlx_zdd *, struct dlx_count index, const void **solution, size_t *num_rows);
+
+/**
+ * Pick a solution uniformly at random.
+ *
+ * @param the diagram
+ * @param state state of the random number generator, seed it with any
+ *        value, it's updated on every call
+ * @param solution receives the user_data of the rows, room for as many as
+ *        the matrix has primary columns
+ * @param num_rows receives the amount of rows in the solution
+ * @return false if there are no solutions
+ */
+bool dlx_zdd_sample(const struct dlx_zdd *, uint64_t *state, const void **solution, size_t *num_rows);
+
+/**
+ * Enumerate the solutions, in the order dlx_recursive_solver_enumerate
+ * finds them.
+ *
+ * @param the diagram
+ * @param callback called for every solution
+ * @param ctx passed to the callback as is
+ * @return the number of solutions passed to the callback, 0 if memory
+ *         could not be allocated
+ */
+size_t dlx_zdd_enumerate(const struct dlx_zdd *, dlx_solution_callback callback, void *ctx);
+
+#endif /* #ifndef LIBDLX_ZDD_H */
@@ -18,8 +18,14 @@
  * https://en.wikipedia.org/wiki/Exact_cover
  */
 
+#include "dlx_budget.h"
+#include "dlx_count.h"
+#include "dlx_estimator.h"
+#include "dlx_incremental_solver.h"
 #include "dlx_iterative_solver.h"
 #include "dlx_recursive_solver.h"
+#include "dlx_zdd.h"
 #include "matrix.h"
+#include "matrix_file.h"
 
 #endif /* #ifndef LIBDLX_H */
@@ -1,6 +1,8 @@
 #ifndef LIBDLX_MATRIX_H
 #define LIBDLX_MATRIX_H
 
+#include <stdbool.h>
+#include <stdint.h>
 #include <stdlib.h>
 
 /**
@@ -88,9 +90,78 @@
  * - the '1' nodes are the ones in the matrix
  * - every line represents /two/ pointers, one
  *   in each direction
+ *
+ * Primary columns have to be covered by exactly one row of a solution,
+ * secondary columns by at most one.  The ones in a secondary column may
+ * also be given a color, see dlx_matrix_current_row_set_colored_one, and
+ * a primary column may be given other bounds, see
+ * dlx_matrix_set_column_multiplicity.
  */
 struct dlx_matrix;
 
+/**
+ * The largest color a one can have.
+ */
+#define DLX_MAX_COLOR INT32_MAX
+
+/**
+ * The most rows a matrix can have, a node keeps its row as a 32-bit
+ * index.
+ */
+#define DLX_MAX_ROWS UINT32_MAX
+
+/**
+ * The engines the solvers can run a matrix on.
+ *
+ * - \c DLX_ENGINE_LINKED searches the toroid of \c struct node's
+ *   directly, this is the default.  Small matrices are searched with
+ *   bitsets instead, see dlx_matrix_set_bitset_columns.
+ * - \c DLX_ENGINE_CELLS copies the matrix into sparse sets (Knuth's
+ *   ``dancing cells''): the rows of every column are kept in an array,
+ *   those still in the search in front.  Rows are taken out by swapping
+ *   them to the back and put back by restoring the column's size from a
+ *   trail, so there are no links to chase.  The recursive solver's
+ *   counts and enumeration run on it, the other solvers search the
+ *   toroid.  This engine is experimental: so far it is slower than the
+ *   linked one on every matrix measured, up to 2.6 times on 14 queens.
+ *
+ * The solutions are found in the same order on every engine.  If there's
+ * no memory for the copy of the cells engine, the toroid is
+ * searched instead.
+ */
+enum dlx_engine { DLX_ENGINE_LINKED, DLX_ENGINE_CELLS };
+
+/**
+ * How the solvers find the column with the fewest ones.
+ *
+ * - \c DLX_SELECTION_SCAN walks the list of uncovered columns at every
+ *   step of the search, this is the default.
+ * - \c DLX_SELECTION_BUCKETS keeps the uncovered primary columns in
+ *   buckets by size as they are covered and uncovered, so that finding
+ *   the smallest one takes (nearly) constant time.  Every change in size
+ *   costs a little extra, which pays off for matrices with thousands of
+ *   primary columns.  The linked engine supports this, the bitset and
+ *   cells engines always scan.  If there's no memory for the
+ *   buckets the columns are scanned.
+ *
+ * Either way the same column is picked: the leftmost column with at most
+ * one 1 if there is one, or else the leftmost smallest column.  Counts
+ * and the order of solutions don't depend on the selection.
+ */
+enum dlx_column_selection { DLX_SELECTION_SCAN, DLX_SELECTION_BUCKETS };
+
+/**
+ * Matrices with up to this many columns (primary and secondary) are
+ * searched with bitsets on the linked engine, see
+ * dlx_matrix_set_bitset_columns.  Beyond that, copying the matrix and
+ * AND-NOT'ing longer sets of rows takes longer than following the links
+ * (a 9x9 sudoku, 324 columns, is still solved faster on the toroid).
+ * Define it when building libdlx to change the default.
+ */
+#ifndef DLX_BITSET_COLUMNS
+#define DLX_BITSET_COLUMNS 128
+#endif
+
 /* Creates a struct dlx_matrix
  *
  * @param columns         Amount of primary columns in the matrix.
@@ -109,10 +180,43 @@ struct dlx_matrix;
  * This function creates a new matrix. The node_pool_size argument
  * specified the amount of nodes that will be available to use, *not* the
  * amount of rows. To calculate node_pool_size, multiply the amount of
- * rows you expect to add with the amount of nodes per row.
+ * rows you expect to add with the amount of nodes per row.  Once all
+ * nodes are in use dlx_matrix_begin_new_row and
+ * dlx_matrix_current_row_set_one fail, see dlx_matrix_create_growable
+ * if the amount of nodes isn't known up front.
  */
 struct dlx_matrix *dlx_matrix_create(size_t, size_t, size_t);
 
+/* Creates a struct dlx_matrix whose node pool grows on demand.
+ *
+ * @param columns         Amount of primary columns in the matrix.
+ * @param columns         Amount of secondary columns in the matrix.
+ *
+ * @return
+ * A pointer to the newly created matrix or 0, see dlx_matrix_create.
+ *
+ * Nodes are allocated in slabs of increasing size as rows are added.
+ * Existing nodes are never moved, so the \c struct node * returned by
+ * dlx_matrix_begin_new_row stays valid.
+ */
+struct dlx_matrix *dlx_matrix_create_growable(size_t, size_t);
+
+/* Creates a copy of a matrix.
+ *
+ * @param mat The matrix to copy.
+ * @return
+ * A pointer to the copy or 0 if sufficient memory could not be
+ * allocated or a link of the matrix points outside of it.  It must be
+ * freed using dlx_matrix_destroy.
+ *
+ * The copy is independent of the original, so both can be searched at
+ * the same time (e.g. by different threads).  Headers and nodes are
+ * copied with memcpy and their pointers are rebased, which is a lot
+ * cheaper than building the matrix again.  Hidden rows and covered
+ * columns are copied as they are.  The user_data pointers are shared.
+ */
+struct dlx_matrix *dlx_matrix_clone(const struct dlx_matrix *);
+
 /* Clean up and destroy matrix.
  *
  * @param mat The matrix to be `destroyed'.
@@ -133,7 +237,9 @@ void dlx_matrix_reset(struct dlx_matrix *);
  * @param mat The matrix to which to add the row.
  * @param user_data A user object (or an integer) that will be used to
  *        identify this row in a solution.
- * @return pointer to the first node of this row
+ * @return pointer to the first node of this row or 0 if the node pool
+ *         is exhausted, the matrix has DLX_MAX_ROWS rows already or
+ *         memory could not be allocated.
  */
 struct node *dlx_matrix_begin_new_row(struct dlx_matrix *, const void *);
 
@@ -142,8 +248,257 @@ struct node *dlx_matrix_begin_new_row(struct dlx_matrix *, const void *);
  * @param matrix The matrix in which to set the one.
  * @param index An index corresponding to the column in which to set the
  * one.
+ * @return false if \c index is out of range, the node pool is exhausted
+ *         or memory could not be allocated.
+ */
+bool dlx_matrix_current_row_set_one(struct dlx_matrix *, size_t);
+
+/* Flip a zero to a colored one in the sparse matrix.
+ *
+ * @param matrix The matrix in which to set the one.
+ * @param index An index corresponding to the column in which to set the
+ * one, a secondary column unless \c color is 0.
+ * @param color The color, from 1 up to DLX_MAX_COLOR, or 0 for none.
+ * @return false if \c index or \c color is out of range, the node pool
+ *         is exhausted or memory could not be allocated.
+ *
+ * Any number of rows of a solution may cover a secondary column, as long
+ * as they all give it the same color.  A row that covers it without a
+ * color excludes all other rows from it, as before.  This is exact cover
+ * with colors, solved with Knuth's Algorithm C: choosing a row with a
+ * colored one ``purifies'' the column, hiding the rows that give it
+ * another color rather than all rows that cover it.
+ */
+bool dlx_matrix_current_row_set_colored_one(struct dlx_matrix *, size_t, uint32_t);
+
+/* Add many rows at once.
+ *
+ * @param mat The matrix to which to add the rows.
+ * @param num_rows Amount of rows to add.
+ * @param row_offsets Array of \c num_rows + 1 offsets into
+ *        \c column_indices, row i consists of the columns in
+ *        column_indices[row_offsets[i]] up to (but not including)
+ *        column_indices[row_offsets[i + 1]].
+ * @param column_indices Column of every one in the rows.
+ * @param user_data Array of \c num_rows user objects, see
+ *        dlx_matrix_begin_new_row.  If this is 0 the index of each row
+ *        in the matrix is used instead.
+ * @param first_nodes Array of \c num_rows pointers that will be set to
+ *        the first node of every row (0 for an empty row), as would have
+ *        been returned by dlx_matrix_begin_new_row.  May be 0.
+ * @return false if an offset or column index is invalid, the node pool
+ *         is exhausted, the matrix would have more than DLX_MAX_ROWS
+ *         rows or memory could not be allocated.  No rows are added in
+ *         that case.
+ *
+ * This is equivalent to, but a lot faster than, calling
+ * dlx_matrix_begin_new_row and dlx_matrix_current_row_set_one for every
+ * row and every one (the input is in compressed sparse row format).
+ */
+bool dlx_matrix_add_rows(struct dlx_matrix *, size_t, const size_t *, const size_t *, const void *const *,
+			 struct node **);
+
+/* Add many rows at once, with colors.
+ *
+ * @param colors Color of every one, see
+ *        dlx_matrix_current_row_set_colored_one.  May be 0 if none of
+ *        the ones are colored.
+ * @return false if an offset, column index or color is invalid, the
+ *         node pool is exhausted or memory could not be allocated.  No
+ *         rows are added in that case.
+ *
+ * The other parameters are those of dlx_matrix_add_rows.
+ */
+bool dlx_matrix_add_colored_rows(struct dlx_matrix *, size_t, const size_t *, const size_t *, const uint32_t *,
+				 const void *const *, struct node **);
+
+/* Set how many rows of a solution have to cover a primary column.
+ *
+ * @param mat The matrix.
+ * @param column Index of a primary column.
+ * @param lo Least amount of rows that have to cover the column.
+ * @param hi Largest amount of rows that may cover the column, at least 1.
+ * @return false if \c column isn't a primary column, \c lo > \c hi or
+ *         \c hi is 0.
+ *
+ * Every primary column starts out with \c lo = \c hi = 1.  This is exact
+ * cover with multiplicities, solved with Knuth's Algorithm M.  Rather
+ * than making copies of the column, which would find every solution once
+ * for every way of assigning its rows to the copies, the search branches
+ * on a column once for every row it may add to it, and once for adding
+ * none at all.  The rows of a column are tried in order and a row that
+ * has been tried is left out of the branches after it, so every set of
+ * rows is found exactly once.  The column to branch on is the one with
+ * the fewest branches, which for an exact cover column is its size.
+ *
+ * The bounds are honoured by dlx_recursive_solver_count_solutions,
+ * dlx_recursive_solver_count_solutions_wide,
+ * dlx_recursive_solver_count_solutions_breakdown,
+ * dlx_recursive_solver_count_solutions_budget and
+ * dlx_recursive_solver_enumerate (and so by
+ * dlx_recursive_solver_count_solutions_up_to and
+ * dlx_recursive_solver_is_unique).  These search the linked toroid
+ * whatever the engine.  dlx_recursive_solver_count_solutions_parallel
+ * counts on the calling thread.  The iterative solver, the estimator and
+ * splitting the search refuse the matrix, as does dlx_matrix_save.
+ * dlx_matrix_reset puts them back to 1.
+ */
+bool dlx_matrix_set_column_multiplicity(struct dlx_matrix *, size_t, size_t, size_t);
+
+/* Select the engine the solvers use for this matrix.
+ *
+ * @param mat The matrix.
+ * @param engine One of the \c dlx_engine values.
+ *
+ * Takes effect the next time a solver starts searching the matrix.
+ */
+void dlx_matrix_set_engine(struct dlx_matrix *, enum dlx_engine);
+
+/* Select how the solvers find the smallest column.
+ *
+ * @param mat The matrix.
+ * @param selection One of the \c dlx_column_selection values.
+ *
+ * Takes effect the next time a solver starts searching the matrix.
+ */
+void dlx_matrix_set_column_selection(struct dlx_matrix *, enum dlx_column_selection);
+
+/* Set up to how many columns the linked engine searches with bitsets.
+ *
+ * @param mat The matrix.
+ * @param columns The most columns, primary and secondary, a matrix may
+ *        have for it, DLX_BITSET_COLUMNS by default.  0 turns it off.
+ *
+ * Small matrices are copied into a set of rows per column when a search
+ * starts.  Choosing a row then takes the rows of its columns out of the
+ * search with a few AND-NOT's over 64-bit words per column, instead of
+ * unlinking nodes one by one, and only the sizes of the columns of the
+ * rows taken out are updated.  The bitsets take a bit per column per
+ * row, and a set of rows and the primary column sizes per level of the
+ * search.
+ *
+ * dlx_recursive_solver_count_solutions,
+ * dlx_recursive_solver_count_solutions_wide,
+ * dlx_recursive_solver_count_solutions_breakdown and
+ * dlx_recursive_solver_enumerate (and so
+ * dlx_recursive_solver_count_solutions_up_to and
+ * dlx_recursive_solver_is_unique) use it.  Matrices with colors or
+ * multiplicities, or whose rows were unhidden out of order, are searched
+ * on the toroid.  The solutions are found in the same order either way.
+ *
+ * Takes effect the next time a solver starts searching the matrix.
+ */
+void dlx_matrix_set_bitset_columns(struct dlx_matrix *, size_t);
+
+/* Amount of primary columns in the matrix.
+ *
+ * This bounds the amount of rows in a solution.
+ */
+size_t dlx_matrix_num_primary_columns(const struct dlx_matrix *);
+
+/* Reorder the nodes of the matrix for locality.
+ *
+ * @param mat The matrix.
+ * @param handles Row handles, as returned by dlx_matrix_begin_new_row, to
+ *        update.  May be 0.
+ * @param num_handles Amount of handles.
+ * @return false if memory could not be allocated, the matrix is left
+ *         untouched in that case.
+ *
+ * Nodes are created in the order rows are added, but the solvers walk
+ * down columns before walking along rows.  This function moves the
+ * column headers and nodes into a single fresh block, grouping the rows
+ * of every column together, and keeps every row's nodes adjacent.  The
+ * order of the rows within each column doesn't change, so solutions are
+ * found in the same order as before.
+ *
+ * Every \c struct node * into the matrix is invalidated, pass the ones
+ * you intend to keep using (e.g. for dlx_matrix_hide_row) in \c handles
+ * to have them updated.  Rows can still be added afterwards.
+ *
+ * @pre no solver is in the middle of a search on the matrix
+ */
+bool dlx_matrix_finalize(struct dlx_matrix *, struct node **, size_t);
+
+/* Reduce a matrix before searching it, after Knuth's DLX preprocessor.
+ *
+ * @param mat The matrix.
+ * @param forced receives an array of the user_data of the rows that are
+ *        in every solution, in the order the rows were added.  Free it
+ *        with free().
+ * @param num_forced receives the amount of forced rows.
+ * @param rows receives an array with the index in \c mat of every row of
+ *        the reduced matrix.  Free it with free().
+ * @param num_rows receives the amount of rows of the reduced matrix.
+ * @return the reduced matrix, or 0 if memory could not be allocated.  It
+ *         must be freed using dlx_matrix_destroy.
+ *
+ * The following are applied until none of them applies anymore:
+ * - A row that takes out every row of some primary column it doesn't
+ *   have can't be in a solution, it's removed.
+ * - The only row of a primary column is in every solution.  It's taken
+ *   out along with its columns and every row it conflicts with.
+ * - A column whose rows are all in some other primary column is covered
+ *   at most once anyway.  It's removed if it's a secondary column, or a
+ *   primary one with the same rows.
+ *
+ * Every solution of \c mat consists of the forced rows and a solution of
+ * the reduced matrix, so the counts are the same.  The reduced matrix
+ * keeps the user_data of the rows and the settings of \c mat, its rows
+ * and columns are in the same order with the ones that were removed left
+ * out.  A matrix without solutions may be reduced to a single primary
+ * column without rows.  If the forced rows cover every primary column
+ * the reduced matrix has none, its only solution is the empty one.
+ * Hidden rows are left out.  Duplicate rows are kept, they are in
+ * different solutions.
+ *
+ * Matrices with multiplicities, see dlx_matrix_set_column_multiplicity,
+ * are copied without being reduced.
+ *
+ * @pre no solver is in the middle of a search on the matrix
+ */
+struct dlx_matrix *dlx_matrix_preprocess(const struct dlx_matrix *, const void ***, size_t *, size_t **, size_t *);
+
+/* Tell the solvers about a symmetry of the matrix.
+ *
+ * @param mat The matrix.
+ * @param rows The row every row is mapped to, by index (rows are numbered
+ *        in the order they were added).
+ * @param columns The column every column is mapped to.
+ * @return false if these aren't permutations, or if they don't map the
+ *         matrix onto itself: every row has to be mapped to a row with
+ *         the images of its columns, in the same colors.  Primary columns
+ *         have to be mapped to primary columns.  Also false if memory
+ *         could not be allocated.
+ *
+ * A symmetry maps every solution to a solution.  The symmetries added
+ * generate a group, the rows that some symmetry maps onto one another
+ * are in the same orbit.  Solutions that have one row of a column in
+ * common are mapped to solutions with any other row of its orbit in
+ * common, so there are as many of both.  The search makes use of that
+ * at the top levels: it only tries the first row of every orbit among
+ * the rows of a column, and counts its solutions once for every row of
+ * the column in the orbit.  Below a row it keeps the symmetries that map
+ * that row (and every row chosen before it) onto itself, and it goes on
+ * like this for as long as some orbit has more than one row of the
+ * column.  The rest of the search is the usual one.
+ *
+ * Which rows end up in the same orbits depends on the generators.  Small
+ * ones that map most rows onto themselves, like swapping two values or
+ * two adjacent rows of a latin square, stay around the longest.
+ *
+ * dlx_recursive_solver_count_solutions and
+ * dlx_recursive_solver_count_solutions_wide use the symmetries, as does
+ * dlx_recursive_solver_enumerate_up_to_symmetry.  Generators that don't
+ * map the rows that are hidden at the time onto themselves are left
+ * out.  The other solvers find every solution, as do matrices with
+ * multiplicities.  Adding rows to the matrix drops the symmetries, as
+ * does dlx_matrix_reset.  Clones keep them, dlx_matrix_preprocess and
+ * dlx_matrix_save don't.
+ *
+ * @pre no solver is in the middle of a search on the matrix
  */
-void dlx_matrix_current_row_set_one(struct dlx_matrix *, size_t);
+bool dlx_matrix_add_symmetry(struct dlx_matrix *, const size_t *, const size_t *);
 
 void dlx_matrix_hide_row(struct node *);
 
@@ -0,0 +1,78 @@
+#ifndef LIBDLX_MATRIX_FILE_H
+#define LIBDLX_MATRIX_FILE_H
+
+#include "matrix.h"
+
+#include <stdbool.h>
+
+/**
+ * @file
+ *
+ * Binary matrix files.
+ *
+ * A matrix file stores a matrix in compressed sparse row format so that
+ * it can be loaded without any parsing: the file is mapped into memory
+ * and the toroid is built straight from the mapped arrays.
+ *
+ * All fields are in the byte order of the machine that wrote the file,
+ * a file written on a machine with a different byte order is rejected.
+ *
+ * \code{.unparsed}
+ * offset  type        field
+ *      0  char[4]     magic, "DLXB"
+ *      4  uint32      byte order mark, 0x01020304
+ *      8  uint32      version, 1
+ *     12  uint32      flags, DLX_MATRIX_FILE_COLORS if the ones have colors
+ *     16  uint64      P, amount of primary columns
+ *     24  uint64      S, amount of secondary columns
+ *     32  uint64      R, amount of rows
+ *     40  uint64      N, amount of ones (nodes)
+ *     48  uint64[P+S] amount of ones in every column
+ *         uint64[R+1] offset of every row in the column indices, the
+ *                     last one is N
+ *         uint64[R]   id of every row, becomes its user_data
+ *         uint32[N]   column indices of the ones, row by row
+ *         uint32[N]   colors of the ones, row by row, only with
+ *                     DLX_MATRIX_FILE_COLORS
+ * \endcode
+ *
+ * `examples/convert-to-binary.py' converts the text format used by the
+ * other examples and the test cases to this format.
+ */
+
+/**
+ * Current version of the matrix file format.
+ */
+#define DLX_MATRIX_FILE_VERSION 1
+
+/**
+ * Flag set in files that store the color of every one.
+ */
+#define DLX_MATRIX_FILE_COLORS 1
+
+/* Load a matrix from a binary matrix file.
+ *
+ * @param path Path of the file.
+ * @return
+ * A pointer to the newly created matrix or 0 if the file could not be
+ * read, is not a valid matrix file or sufficient memory could not be
+ * allocated.  The matrix must be freed using dlx_matrix_destroy.
+ *
+ * The user_data of every row is its row id cast to \c void *.
+ */
+struct dlx_matrix *dlx_matrix_load(const char *);
+
+/* Save a matrix to a binary matrix file.
+ *
+ * @param mat The matrix.
+ * @param path Path of the file, it's overwritten if it exists.
+ * @return false if the matrix has multiplicities or the file could not be
+ * written.
+ *
+ * Every row that has at least one node is saved, hidden or not.  The
+ * user_data of the rows is saved as their row id, this is only
+ * meaningful if the user_data are integers.
+ */
+bool dlx_matrix_save(const struct dlx_matrix *, const char *);
+
+#endif /* #ifndef LIBDLX_MATRIX_FILE_H */
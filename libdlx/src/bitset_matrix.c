@@ -0,0 +1,239 @@
+#include "bitset_matrix.h"
+
+#include <string.h>
+
+static inline size_t words_for(size_t bits) { return (bits + 63) / 64; }
+
+struct dlx_bitset_matrix *dlx_bitset_matrix_create(const struct dlx_matrix *mat)
+{
+	const size_t num_items = mat->primary_cols + mat->secondary_cols;
+
+	if (mat->colored || mat->rows_in_mat > UINT32_MAX || num_items > UINT32_MAX) {
+		return 0;
+	}
+
+	/* Scratch space: number (in the bitset matrix) and a node (in the
+	   toroid) of every row that is still in the search. */
+	uint32_t *row_num = malloc(sizeof(*row_num) * (mat->rows_in_mat + 1));
+	const struct node **row_node = malloc(sizeof(*row_node) * (mat->rows_in_mat + 1));
+
+	if (row_num == 0 || row_node == 0) {
+		free(row_num);
+		free(row_node);
+		return 0;
+	}
+
+	for (size_t r = 0; r < mat->rows_in_mat; ++r) {
+		row_node[r] = 0;
+	}
+
+	/*
+	 * The rows still in the search are those in the uncovered primary
+	 * columns.  Every one of those has to list its rows in order.
+	 */
+	bool in_order = true;
+	size_t num_nodes = 0;
+	for (size_t c = 0; c < mat->primary_cols && in_order; ++c) {
+		const struct node *header = (const struct node *)&mat->column_list[c];
+
+		if (header->left->right != header) {
+			continue;
+		}
+
+		for (const struct node *v = header->down; v != header && in_order; v = v->down) {
+			in_order = v->down == header || v->row < v->down->row;
+
+			if (row_node[v->row] == 0) {
+				row_node[v->row] = v;
+				const struct node *h = v;
+				do {
+					++num_nodes;
+					h = h->right;
+				} while (h != v);
+			}
+		}
+	}
+
+	struct dlx_bitset_matrix *const cm = in_order ? calloc(1, sizeof(*cm)) : 0;
+
+	if (cm == 0) {
+		free(row_num);
+		free(row_node);
+		return 0;
+	}
+
+	size_t num_rows = 0;
+	for (size_t r = 0; r < mat->rows_in_mat; ++r) {
+		if (row_node[r] != 0) {
+			row_num[num_rows++] = (uint32_t)r;
+		}
+	}
+
+	const size_t num_words = words_for(num_rows);
+	const size_t num_item_words = words_for(mat->primary_cols);
+	const size_t num_primary = mat->primary_cols;
+	/* Every level chooses another row, and covers another column. */
+	const size_t num_levels = (num_primary < num_rows ? num_primary : num_rows) + 1;
+
+	/* uint64_t's and size_t's first, they have the strictest alignment. */
+	const size_t word_bytes = sizeof(uint64_t) * (num_items * num_words + num_levels * (num_words + num_item_words));
+	const size_t row_bytes = sizeof(*cm->rows) * num_rows;
+	const size_t index_bytes =
+		sizeof(uint32_t) * (2 * num_items + 2 * num_rows + 1 + num_nodes + num_levels * num_primary);
+
+	cm->pool = malloc(word_bytes + row_bytes + index_bytes);
+
+	if (cm->pool == 0) {
+		free(row_num);
+		free(row_node);
+		free(cm);
+		return 0;
+	}
+
+	cm->columns = cm->pool;
+	cm->active = cm->columns + num_items * num_words;
+	cm->uncovered = cm->active + num_levels * num_words;
+	cm->rows = (size_t *)(cm->uncovered + num_levels * num_item_words);
+	cm->lo = (uint32_t *)(cm->rows + num_rows);
+	cm->hi = cm->lo + num_items;
+	cm->first = cm->hi + num_items;
+	cm->primary_end = cm->first + num_rows + 1;
+	cm->items = cm->primary_end + num_rows;
+	cm->size = cm->items + num_nodes;
+
+	cm->num_items = (uint32_t)num_items;
+	cm->num_primary = (uint32_t)num_primary;
+	cm->num_rows = (uint32_t)num_rows;
+	cm->num_words = (uint32_t)num_words;
+	cm->num_item_words = (uint32_t)num_item_words;
+
+	/* The other levels are filled in by the search. */
+	memset(cm->columns, 0, sizeof(*cm->columns) * num_items * num_words);
+	memset(cm->active, 0, sizeof(*cm->active) * num_words);
+	memset(cm->uncovered, 0, sizeof(*cm->uncovered) * num_item_words);
+	memset(cm->lo, 0, sizeof(*cm->lo) * 2 * num_items);
+	memset(cm->size, 0, sizeof(*cm->size) * num_primary);
+
+	/* Every row goes in the sets of its columns and in level 0.  Rows
+	   are added in order, so the first and last words of a column are
+	   those of its first and last row.  The primary columns of a row
+	   are listed first, they're the ones with a size. */
+	uint32_t k = 0;
+	for (uint32_t r = 0; r < cm->num_rows; ++r) {
+		const struct node *v = row_node[row_num[r]];
+		const struct node *h = v;
+
+		cm->rows[r] = row_num[r];
+		cm->first[r] = k;
+		do {
+			const uint32_t i = (uint32_t)(h->head - mat->column_list);
+			cm->items[k++] = i;
+			cm->columns[(size_t)i * num_words + r / 64] |= UINT64_C(1) << r % 64;
+			if (cm->hi[i] == 0) {
+				cm->lo[i] = r / 64;
+			}
+			cm->hi[i] = r / 64 + 1;
+			h = h->right;
+		} while (h != v);
+
+		cm->primary_end[r] = cm->first[r];
+		for (uint32_t l = cm->first[r]; l < k; ++l) {
+			const uint32_t i = cm->items[l];
+
+			if (i < num_primary) {
+				cm->items[l] = cm->items[cm->primary_end[r]];
+				cm->items[cm->primary_end[r]++] = i;
+				++cm->size[i];
+			}
+		}
+
+		cm->active[r / 64] |= UINT64_C(1) << r % 64;
+	}
+	cm->first[cm->num_rows] = k;
+
+	for (uint32_t i = 0; i < cm->num_primary; ++i) {
+		const struct node *header = (const struct node *)&mat->column_list[i];
+
+		if (header->left->right == header) {
+			cm->uncovered[i / 64] |= UINT64_C(1) << i % 64;
+		}
+	}
+
+	free(row_num);
+	free(row_node);
+
+	return cm;
+}
+
+void dlx_bitset_matrix_destroy(struct dlx_bitset_matrix *cm)
+{
+	free(cm->pool);
+	free(cm);
+}
+
+/**
+ * Note: the column the row was chosen from is one of the row's columns,
+ *       so it is covered along with the others.  A row leaves the sizes
+ *       for the first of those columns it is in, the others find it gone.
+ */
+void dlx_bitset_dance_choose_row(struct dlx_bitset_matrix *cm, size_t depth, uint32_t r)
+{
+	const uint64_t *active = cm->active + depth * cm->num_words;
+	uint64_t *next = cm->active + (depth + 1) * cm->num_words;
+	const uint64_t *uncovered = cm->uncovered + depth * cm->num_item_words;
+	uint64_t *next_uncovered = cm->uncovered + (depth + 1) * cm->num_item_words;
+	const uint32_t *size = cm->size + depth * cm->num_primary;
+	uint32_t *next_size = cm->size + (depth + 1) * cm->num_primary;
+
+	memcpy(next, active, sizeof(*next) * cm->num_words);
+	memcpy(next_uncovered, uncovered, sizeof(*next_uncovered) * cm->num_item_words);
+	memcpy(next_size, size, sizeof(*next_size) * cm->num_primary);
+
+	for (uint32_t k = cm->first[r]; k < cm->first[r + 1]; ++k) {
+		const uint32_t i = cm->items[k];
+		const uint64_t *rows = cm->columns + (size_t)i * cm->num_words;
+
+		for (uint32_t w = cm->lo[i]; w < cm->hi[i]; ++w) {
+			for (uint64_t gone = next[w] & rows[w]; gone != 0; gone &= gone - 1) {
+				const uint32_t x = w * 64 + (uint32_t)__builtin_ctzll(gone);
+
+				for (uint32_t l = cm->first[x]; l < cm->primary_end[x]; ++l) {
+					--next_size[cm->items[l]];
+				}
+			}
+			next[w] &= ~rows[w];
+		}
+
+		if (i < cm->num_primary) {
+			next_uncovered[i / 64] &= ~(UINT64_C(1) << i % 64);
+		}
+	}
+}
+
+/**
+ * The uncovered columns are visited in order, so the first one with at
+ * most one row can be taken right away.
+ */
+uint32_t dlx_bitset_matrix_query_smallest_column(const struct dlx_bitset_matrix *cm, size_t depth)
+{
+	const uint64_t *uncovered = cm->uncovered + depth * cm->num_item_words;
+	const uint32_t *size = cm->size + depth * cm->num_primary;
+	uint32_t smallest = cm->num_primary;
+	uint32_t smallest_size = UINT32_MAX;
+
+	for (uint32_t u = 0; u < cm->num_item_words; ++u) {
+		for (uint64_t bits = uncovered[u]; bits != 0; bits &= bits - 1) {
+			const uint32_t i = u * 64 + (uint32_t)__builtin_ctzll(bits);
+
+			if (size[i] <= 1) {
+				return i;
+			}
+			if (size[i] < smallest_size) {
+				smallest = i;
+				smallest_size = size[i];
+			}
+		}
+	}
+
+	return smallest;
+}
@@ -0,0 +1,153 @@
+#ifndef LIBDLX_BITSET_MATRIX_H
+#define LIBDLX_BITSET_MATRIX_H
+
+#include "matrix_struct.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @file
+ *
+ * The bitset engine: a copy of a small matrix as a set of rows per
+ * column.
+ *
+ * Rows are numbered in the order of the source matrix, bit r of a set
+ * stands for row r.  \c columns holds the rows of every column, \c lo
+ * and \c hi the first and one past the last word of that set that isn't
+ * 0.  The search keeps a set of the rows still in it and a set of the
+ * uncovered primary columns for every level.  Choosing a row fills in
+ * the next level: the row's columns are taken out of the uncovered ones
+ * and every row of those columns out of the active ones.  That's a few
+ * AND-NOT's over the words between \c lo and \c hi per column, which the
+ * compiler vectorizes, and there is nothing to undo: going back a level
+ * is all it takes.
+ *
+ * The sizes of the primary columns are kept for every level as well.
+ * The rows an AND-NOT takes out are the bits the two words have in
+ * common, and those rows leave the sizes of their primary columns: the
+ * same updates unlinking them from the toroid makes.  Finding the
+ * smallest column then only reads sizes.
+ *
+ * \code{.unparsed}
+ * active    | level 0       | level 1       | ..  num_words words each
+ * uncovered | level 0 | level 1 | ..            num_item_words words each
+ * size      | level 0     | level 1     | ..      num_primary each
+ * \endcode
+ *
+ * The column picked is the one the scan on the other engines picks, and
+ * its rows are tried in order, so the solutions are found in the same
+ * order.  That depends on the rows of every primary column being in the
+ * order of their index, which holds unless rows were hidden and unhidden
+ * out of order.  Matrices with colors aren't supported either,
+ * dlx_bitset_matrix_create returns 0 for both.
+ */
+
+struct dlx_bitset_matrix {
+	uint32_t num_items;      /**< Number of columns, primary and secondary. **/
+	uint32_t num_primary;    /**< Columns 0 .. num_primary - 1 are primary. **/
+	uint32_t num_rows;       /**< Number of rows copied from the matrix. **/
+	uint32_t num_words;      /**< Words in a set of rows. **/
+	uint32_t num_item_words; /**< Words in a set of primary columns. **/
+
+	uint64_t *columns;     /**< The rows of every column, num_words words each. **/
+	uint32_t *lo;          /**< First word of every column that isn't 0. **/
+	uint32_t *hi;          /**< One past the last word of every column that isn't 0. **/
+	uint32_t *first;       /**< First column of every row in items, and one past the last. **/
+	uint32_t *primary_end; /**< One past the last primary column of every row in items. **/
+	uint32_t *items;       /**< The columns of every row, primary ones first. **/
+
+	/**
+	 * Index in the source matrix of every copied row.
+	 */
+	size_t *rows;
+
+	uint64_t *active;    /**< The rows still in the search at every level. **/
+	uint64_t *uncovered; /**< The uncovered primary columns at every level. **/
+	uint32_t *size;      /**< Active rows of every primary column at every level. **/
+
+	void *pool; /**< Single allocation backing all of the above. **/
+};
+
+/**
+ * Copy the active part of a matrix into a new bitset matrix.
+ *
+ * Hidden rows are left out, covered columns are covered in the copy as
+ * well.
+ *
+ * @return the bitset matrix or 0 if the matrix has colors, its rows are
+ *         out of order or memory could not be allocated
+ */
+struct dlx_bitset_matrix *dlx_bitset_matrix_create(const struct dlx_matrix *);
+
+void dlx_bitset_matrix_destroy(struct dlx_bitset_matrix *);
+
+/**
+ * The rows still in the search at level \c depth and the rows of column
+ * \c i, to be AND'ed word by word from cm->lo[i] up to (but not
+ * including) cm->hi[i].
+ */
+static inline const uint64_t *dlx_bitset_matrix_active(const struct dlx_bitset_matrix *cm, size_t depth)
+{
+	return cm->active + depth * cm->num_words;
+}
+
+static inline const uint64_t *dlx_bitset_matrix_column(const struct dlx_bitset_matrix *cm, uint32_t i)
+{
+	return cm->columns + (size_t)i * cm->num_words;
+}
+
+/**
+ * The first row of column \c i from row \c r on that is still in the
+ * search at level \c depth.
+ *
+ * @return the row, or num_rows if there is none
+ */
+static inline uint32_t dlx_bitset_matrix_next_row(const struct dlx_bitset_matrix *cm, size_t depth, uint32_t i,
+						  uint32_t r)
+{
+	const uint64_t *active = dlx_bitset_matrix_active(cm, depth);
+	const uint64_t *rows = dlx_bitset_matrix_column(cm, i);
+	uint32_t w = r / 64;
+	uint64_t bits = w < cm->hi[i] ? rows[w] & active[w] & (~UINT64_C(0) << (r % 64)) : 0;
+
+	while (bits == 0) {
+		if (++w >= cm->hi[i]) {
+			return cm->num_rows;
+		}
+		bits = rows[w] & active[w];
+	}
+
+	return w * 64 + (uint32_t)__builtin_ctzll(bits);
+}
+
+/**
+ * Is every primary column covered at level \c depth?
+ */
+static inline bool dlx_bitset_matrix_is_empty(const struct dlx_bitset_matrix *cm, size_t depth)
+{
+	const uint64_t *uncovered = cm->uncovered + depth * cm->num_item_words;
+
+	for (uint32_t u = 0; u < cm->num_item_words; ++u) {
+		if (uncovered[u] != 0) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/**
+ * Choose row \c r at level \c depth: fill in level depth + 1.
+ */
+void dlx_bitset_dance_choose_row(struct dlx_bitset_matrix *, size_t depth, uint32_t r);
+
+/**
+ * The column the search branches on at level \c depth, see
+ * dlx_matrix_query_smallest_column.
+ *
+ * @return the column, or num_primary if every primary column is covered
+ */
+uint32_t dlx_bitset_matrix_query_smallest_column(const struct dlx_bitset_matrix *, size_t depth);
+
+#endif /* #ifndef LIBDLX_BITSET_MATRIX_H */
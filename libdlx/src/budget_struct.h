@@ -0,0 +1,88 @@
+#ifndef LIBDLX_BUDGET_STRUCT_H
+#define LIBDLX_BUDGET_STRUCT_H
+
+#include "dlx_budget.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @file
+ * Budget data structure, and how the solvers spend a budget.
+ */
+
+/**
+ * How many nodes a call visits between checks of the time limit and
+ * cancellation.
+ */
+#define BUDGET_POLL_INTERVAL 1024
+
+struct dlx_budget {
+	/* Limits, 0 for none. */
+	uint64_t max_nodes;
+	uint64_t max_updates;
+	double time_limit;
+
+	/* Set by dlx_budget_cancel, on any thread.  Only ever accessed
+	 * atomically. */
+	bool cancelled;
+
+	/* State of the current or last call. */
+	enum dlx_budget_status status;
+	uint64_t nodes;
+	uint64_t updates;
+	double deadline; /* On the monotonic clock, in seconds. */
+	unsigned int steps;
+};
+
+/**
+ * Start a call on the budget.
+ */
+void dlx_budget_begin(struct dlx_budget *);
+
+/**
+ * Check the time limit and cancellation.
+ *
+ * @return true if the call has to stop
+ */
+bool dlx_budget_poll(struct dlx_budget *);
+
+/**
+ * Charge a call for visiting \c nodes nodes (0 or 1) and making \c updates
+ * updates.
+ *
+ * @return true if the call has to stop, it has to stop before visiting
+ *         the node
+ */
+static inline bool dlx_budget_spend(struct dlx_budget *budget, unsigned int nodes, size_t updates)
+{
+	if (budget->status != DLX_BUDGET_OK) {
+		return true;
+	}
+
+	budget->updates += updates;
+	if (budget->max_updates != 0 && budget->updates > budget->max_updates) {
+		budget->status = DLX_BUDGET_UPDATES;
+		return true;
+	}
+
+	if (nodes == 0) {
+		return false;
+	}
+
+	if (budget->max_nodes != 0 && budget->nodes == budget->max_nodes) {
+		budget->status = DLX_BUDGET_NODES;
+		return true;
+	}
+	++budget->nodes;
+
+	if (++budget->steps == BUDGET_POLL_INTERVAL) {
+		budget->steps = 0;
+		return dlx_budget_poll(budget);
+	}
+
+	return false;
+}
+
+#endif /* #ifndef LIBDLX_BUDGET_STRUCT_H */
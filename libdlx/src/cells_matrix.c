@@ -0,0 +1,429 @@
+#include "cells_matrix.h"
+
+#include <stdint.h>
+
+static size_t cover(struct dlx_cells_matrix *, uint32_t);
+static void uncover(struct dlx_cells_matrix *, uint32_t);
+static size_t hide(struct dlx_cells_matrix *, uint32_t, uint64_t);
+static inline void remove_node(struct dlx_cells_matrix *, uint32_t, uint64_t);
+static void restore(struct dlx_cells_matrix *);
+static void sort_column(struct dlx_cells_matrix *, uint32_t);
+static size_t commit_row(struct dlx_cells_matrix *, uint32_t);
+static void uncommit_row(struct dlx_cells_matrix *, uint32_t);
+static size_t purify(struct dlx_cells_matrix *, uint32_t);
+static void unpurify(struct dlx_cells_matrix *, uint32_t);
+
+struct dlx_cells_matrix *dlx_cells_matrix_create(const struct dlx_matrix *mat)
+{
+	const size_t num_items = mat->primary_cols + mat->secondary_cols;
+	const size_t num_nodes = mat->nodes_in_mat;
+	const size_t num_rows = mat->rows_in_mat;
+
+	/* Every node taken out of a column is on the trail at most once, and
+	   so is the marker of every covered or purified column. */
+	const size_t trail_size = num_nodes + num_items + 1;
+
+	if (num_nodes + num_items + 1 > INT32_MAX || num_rows + 1 > INT32_MAX) {
+		return 0;
+	}
+
+	struct dlx_cells_matrix *const cm = calloc(1, sizeof(*cm));
+
+	if (cm == 0) {
+		return 0;
+	}
+
+	/* Scratch space: first node (in the toroid) and first node (in the
+	   copy) of every row that has been laid out, plus one. */
+	const struct node **row_first = calloc(num_rows + 1, sizeof(*row_first));
+	uint32_t *row_pos = calloc(num_rows + 1, sizeof(*row_pos));
+
+	/* Wide types first, they have the strictest alignment. */
+	const size_t wide_bytes = sizeof(*cm->rows) * (num_rows + 1) + sizeof(*cm->stamp) * (num_items + 1) +
+				  sizeof(*cm->trail) * trail_size;
+	const size_t item_bytes = sizeof(uint32_t) * (2 * mat->primary_cols + 2 * num_items + 1);
+	const size_t node_bytes = sizeof(uint32_t) * num_nodes * (mat->colored ? 6 : 5);
+
+	cm->pool = malloc(wide_bytes + item_bytes + node_bytes + sizeof(uint32_t) * (num_rows + 1));
+
+	if (row_first == 0 || row_pos == 0 || cm->pool == 0) {
+		free(row_first);
+		free(row_pos);
+		free(cm->pool);
+		free(cm);
+		return 0;
+	}
+
+	cm->rows = cm->pool;
+	cm->stamp = (uint64_t *)(cm->rows + num_rows + 1);
+	cm->trail = (struct trail_entry *)(cm->stamp + num_items + 1);
+	cm->active = (uint32_t *)(cm->trail + trail_size);
+	cm->active_pos = cm->active + mat->primary_cols;
+	cm->start = cm->active_pos + mat->primary_cols;
+	cm->size = cm->start + num_items + 1;
+	cm->set = cm->size + num_items;
+	cm->pos = cm->set + num_nodes;
+	cm->rank = cm->pos + num_nodes;
+	cm->item = cm->rank + num_nodes;
+	cm->row = cm->item + num_nodes;
+	cm->first = cm->row + num_nodes;
+	cm->color = mat->colored ? (int32_t *)(cm->first + num_rows + 1) : 0;
+
+	cm->num_items = (uint32_t)num_items;
+	cm->num_primary = (uint32_t)mat->primary_cols;
+
+	/*
+	 * Lay out the rows, in the order they are first encountered in a
+	 * column.  Hidden rows aren't in any
+	 * column and are skipped automatically.
+	 */
+	uint32_t next = 0;
+	for (size_t c = 0; c < num_items; ++c) {
+		const struct node *header = (const struct node *)&mat->column_list[c];
+		for (const struct node *v = header->down; v != header; v = v->down) {
+			if (row_first[v->row] != 0) {
+				continue;
+			}
+
+			row_first[v->row] = v;
+			row_pos[v->row] = next;
+			cm->first[cm->num_rows] = next;
+			cm->rows[cm->num_rows] = v->row;
+
+			const struct node *h = v;
+			do {
+				if (cm->color != 0) {
+					cm->color[next] = node_color(h);
+				}
+				cm->item[next] = (uint32_t)(h->head - mat->column_list);
+				cm->row[next++] = cm->num_rows;
+				h = h->right;
+			} while (h != v);
+
+			++cm->num_rows;
+		}
+	}
+	cm->first[cm->num_rows] = next;
+
+	/* Now put every node in its column, in toroid order. */
+	uint32_t k = 0;
+	for (size_t c = 0; c < num_items; ++c) {
+		const struct node *header = (const struct node *)&mat->column_list[c];
+
+		cm->start[c] = k;
+		for (const struct node *v = header->down; v != header; v = v->down) {
+			uint32_t x = row_pos[v->row];
+			for (const struct node *h = row_first[v->row]; h != v; h = h->right) {
+				++x;
+			}
+
+			cm->set[k] = x;
+			cm->pos[x] = cm->rank[x] = k++;
+		}
+		cm->size[c] = k - cm->start[c];
+		cm->stamp[c] = 0;
+	}
+	cm->start[num_items] = k;
+
+	/* The uncovered primary columns in the order of the root list, then
+	   the covered ones. */
+	const struct node *root = (const struct node *)&mat->root;
+	for (const struct node *h = root->right; h != root; h = h->right) {
+		const uint32_t i = (uint32_t)((const struct header *)h - mat->column_list);
+		cm->active_pos[i] = cm->num_active;
+		cm->active[cm->num_active++] = i;
+	}
+	for (uint32_t i = 0, covered = cm->num_active; i < cm->num_primary; ++i) {
+		const struct node *h = (const struct node *)&mat->column_list[i];
+		if (h->left->right != h) {
+			cm->active_pos[i] = covered;
+			cm->active[covered++] = i;
+		}
+	}
+
+	free(row_first);
+	free(row_pos);
+
+	return cm;
+}
+
+void dlx_cells_matrix_destroy(struct dlx_cells_matrix *cm)
+{
+	free(cm->pool);
+	free(cm);
+}
+
+size_t dlx_cells_dance_cover_column(struct dlx_cells_matrix *cm, uint32_t i)
+{
+	sort_column(cm, i);
+	return cover(cm, i);
+}
+
+/**
+ * Note: the column of x is not covered, see
+ *       dlx_dance_cover_all_columns_in_row.
+ */
+size_t dlx_cells_dance_cover_all_columns_in_row(struct dlx_cells_matrix *cm, uint32_t x)
+{
+	if (cm->color != 0) {
+		return commit_row(cm, x);
+	}
+
+	const uint32_t end = cm->first[cm->row[x] + 1];
+	size_t updates = 0;
+
+	for (uint32_t y = cm->first[cm->row[x]]; y < end; ++y) {
+		if (y != x) {
+			updates += cover(cm, cm->item[y]);
+		}
+	}
+
+	return updates;
+}
+
+void dlx_cells_dance_uncover_column(struct dlx_cells_matrix *cm, uint32_t i) { uncover(cm, i); }
+
+void dlx_cells_dance_uncover_all_columns_in_row(struct dlx_cells_matrix *cm, uint32_t x)
+{
+	if (cm->color != 0) {
+		uncommit_row(cm, x);
+		return;
+	}
+
+	const uint32_t begin = cm->first[cm->row[x]];
+
+	for (uint32_t y = cm->first[cm->row[x] + 1]; y-- > begin;) {
+		if (y != x) {
+			uncover(cm, cm->item[y]);
+		}
+	}
+}
+
+/**
+ * The uncovered columns aren't in order, so there's no bailing early:
+ * the whole set is searched for the column the scan on the other
+ * engines picks, which is the one with the lowest index among those
+ * with at most one row, or else among the smallest.
+ */
+uint32_t dlx_cells_matrix_query_smallest_column(const struct dlx_cells_matrix *cm)
+{
+	uint32_t smallest = cm->active[0];
+	uint32_t smallest_size = cm->size[smallest] > 1 ? cm->size[smallest] : 1;
+
+	for (uint32_t k = 1; k < cm->num_active; ++k) {
+		const uint32_t i = cm->active[k];
+		const uint32_t size = cm->size[i] > 1 ? cm->size[i] : 1;
+
+		if (size < smallest_size || (size == smallest_size && i < smallest)) {
+			smallest = i;
+			smallest_size = size;
+		}
+	}
+
+	return smallest;
+}
+
+/** Unexposed functions **/
+
+/**
+ * Take column i out of the uncovered columns and hide all of its rows.
+ */
+static size_t cover(struct dlx_cells_matrix *cm, uint32_t i)
+{
+	const uint32_t mark = (uint32_t)cm->trail_size;
+	const uint64_t stamp = ++cm->covers;
+	const uint32_t end = cm->start[i] + cm->size[i];
+	size_t updates = 1;
+
+	if (i < cm->num_primary) {
+		const uint32_t p = cm->active_pos[i];
+		const uint32_t j = cm->active[--cm->num_active];
+
+		cm->active[p] = j;
+		cm->active_pos[j] = p;
+		cm->active[cm->num_active] = i;
+		cm->active_pos[i] = cm->num_active;
+	}
+
+	for (uint32_t k = cm->start[i]; k < end; ++k) {
+		updates += hide(cm, cm->set[k], stamp);
+	}
+
+	cm->trail[cm->trail_size++] = (struct trail_entry){i, mark};
+	return updates;
+}
+
+/**
+ * Put column i back, it's right behind the uncovered columns.
+ */
+static void uncover(struct dlx_cells_matrix *cm, uint32_t i)
+{
+	restore(cm);
+
+	if (i < cm->num_primary) {
+		++cm->num_active;
+	}
+}
+
+/**
+ * Take all the other nodes in the row of x out of their columns.
+ * Purified nodes stay where they are, as in dlx_dance.c.
+ */
+static size_t hide(struct dlx_cells_matrix *cm, uint32_t x, uint64_t stamp)
+{
+	const uint32_t end = cm->first[cm->row[x] + 1];
+	size_t updates = 0;
+
+	for (uint32_t y = cm->first[cm->row[x]]; y < end; ++y) {
+		if (y != x && (cm->color == 0 || cm->color[y] >= 0)) {
+			remove_node(cm, y, stamp);
+			++updates;
+		}
+	}
+
+	return updates;
+}
+
+/**
+ * Swap node x with the last node still in its column and shrink the
+ * column.  Its old size goes on the trail if this is the first time the
+ * current cover shrinks it.
+ */
+static inline void remove_node(struct dlx_cells_matrix *cm, uint32_t x, uint64_t stamp)
+{
+	const uint32_t i = cm->item[x];
+
+	if (cm->stamp[i] != stamp) {
+		cm->stamp[i] = stamp;
+		cm->trail[cm->trail_size++] = (struct trail_entry){i, cm->size[i]};
+	}
+
+	const uint32_t last = cm->start[i] + --cm->size[i];
+	const uint32_t p = cm->pos[x];
+	const uint32_t y = cm->set[last];
+
+	cm->set[p] = y;
+	cm->pos[y] = p;
+	cm->set[last] = x;
+	cm->pos[x] = last;
+}
+
+/**
+ * Pop the trail back to the last marker, restoring the sizes on it.
+ */
+static void restore(struct dlx_cells_matrix *cm)
+{
+	const uint32_t mark = cm->trail[--cm->trail_size].size;
+
+	while (cm->trail_size > mark) {
+		const struct trail_entry e = cm->trail[--cm->trail_size];
+		cm->size[e.item] = e.size;
+	}
+}
+
+/**
+ * Put the rows still in column i in their original order.  There are
+ * few of them in the column the search branches on, and they are mostly
+ * in order, so an insertion sort does.
+ */
+static void sort_column(struct dlx_cells_matrix *cm, uint32_t i)
+{
+	const uint32_t begin = cm->start[i];
+	const uint32_t end = begin + cm->size[i];
+
+	for (uint32_t k = begin + 1; k < end; ++k) {
+		const uint32_t x = cm->set[k];
+		uint32_t p = k;
+
+		while (p > begin && cm->rank[cm->set[p - 1]] > cm->rank[x]) {
+			cm->set[p] = cm->set[p - 1];
+			cm->pos[cm->set[p]] = p;
+			--p;
+		}
+
+		cm->set[p] = x;
+		cm->pos[x] = p;
+	}
+}
+
+/**
+ * dlx_cells_dance_cover_all_columns_in_row for a matrix with colors: a
+ * colored one purifies its column instead of covering it, a purified one
+ * is left alone.
+ */
+static size_t commit_row(struct dlx_cells_matrix *cm, uint32_t x)
+{
+	const uint32_t end = cm->first[cm->row[x] + 1];
+	size_t updates = 0;
+
+	for (uint32_t y = cm->first[cm->row[x]]; y < end; ++y) {
+		if (y == x) {
+			continue;
+		}
+
+		if (cm->color[y] == 0) {
+			updates += cover(cm, cm->item[y]);
+		} else if (cm->color[y] > 0) {
+			updates += purify(cm, y);
+		}
+	}
+
+	return updates;
+}
+
+static void uncommit_row(struct dlx_cells_matrix *cm, uint32_t x)
+{
+	const uint32_t begin = cm->first[cm->row[x]];
+
+	for (uint32_t y = cm->first[cm->row[x] + 1]; y-- > begin;) {
+		if (y == x) {
+			continue;
+		}
+
+		if (cm->color[y] == 0) {
+			uncover(cm, cm->item[y]);
+		} else if (cm->color[y] > 0) {
+			unpurify(cm, y);
+		}
+	}
+}
+
+/**
+ * Same as purify in dlx_dance.c, recorded on the trail like a cover.
+ */
+static size_t purify(struct dlx_cells_matrix *cm, uint32_t x)
+{
+	const uint32_t i = cm->item[x];
+	const uint32_t mark = (uint32_t)cm->trail_size;
+	const uint64_t stamp = ++cm->covers;
+	const uint32_t end = cm->start[i] + cm->size[i];
+	const int32_t color = cm->color[x];
+	size_t updates = 0;
+
+	for (uint32_t k = cm->start[i]; k < end; ++k) {
+		const uint32_t y = cm->set[k];
+
+		if (cm->color[y] != color) {
+			updates += hide(cm, y, stamp);
+		} else if (y != x) {
+			cm->color[y] = -1;
+		}
+	}
+
+	cm->trail[cm->trail_size++] = (struct trail_entry){i, mark};
+	return updates;
+}
+
+static void unpurify(struct dlx_cells_matrix *cm, uint32_t x)
+{
+	const uint32_t i = cm->item[x];
+	const uint32_t end = cm->start[i] + cm->size[i];
+
+	restore(cm);
+
+	for (uint32_t k = cm->start[i]; k < end; ++k) {
+		if (cm->color[cm->set[k]] < 0) {
+			cm->color[cm->set[k]] = cm->color[x];
+		}
+	}
+}
@@ -0,0 +1,134 @@
+#ifndef LIBDLX_CELLS_MATRIX_H
+#define LIBDLX_CELLS_MATRIX_H
+
+#include "matrix_struct.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @file
+ *
+ * The cells engine: a copy of the matrix kept in sparse sets, after
+ * Knuth's ``dancing cells''.
+ *
+ * There are no links to follow.  The rows of every column are stored
+ * next to each other in \c set, the column's first \c size of them are
+ * still in the search.  A row is taken out of a column by swapping it
+ * with the last one still in and decreasing the size, so it ends up
+ * right behind them.  Putting it back is a matter of restoring the
+ * size: whatever was taken out since is behind it, in whatever order.
+ * The uncovered primary columns are a sparse set in \c active the same
+ * way.
+ *
+ * \code{.unparsed}
+ * set     | column 0        | column 1     | ..
+ *         | in      | out   | in  | out    |
+ *         ^ start[0]        ^ start[1]
+ *                   ^ start[0] + size[0]
+ * \endcode
+ *
+ * Every cover (or purification, see dlx_dance.c) records the old size of
+ * every column it shrinks on the trail, once, followed by a marker.
+ * Undoing it pops the trail back to the marker.  That's a write per
+ * column touched rather than one per node.
+ *
+ * The nodes of a row are numbered consecutively, \c first holds the
+ * first node of every row.  Swapping rows around does change their
+ * order, so the rows of the column the search branches on are sorted by
+ * their original position (\c rank) first.  Together with the choice of
+ * column, which is the same as on the other engines, that makes the
+ * search visit solutions in the same order.
+ */
+
+/**
+ * An entry on the trail: the size column \c item had before it was
+ * shrunk, or (for a marker) where the trail stood before the cover.
+ */
+struct trail_entry {
+	uint32_t item;
+	uint32_t size;
+};
+
+struct dlx_cells_matrix {
+	uint32_t num_items;   /**< Number of columns, primary and secondary. **/
+	uint32_t num_primary; /**< Columns 0 .. num_primary - 1 are primary. **/
+	uint32_t num_rows;    /**< Number of rows copied from the matrix. **/
+	uint32_t num_active;  /**< Number of uncovered primary columns. **/
+
+	uint32_t *active;     /**< Uncovered primary columns, then the covered ones. **/
+	uint32_t *active_pos; /**< Position of every primary column in active. **/
+	uint32_t *start;      /**< Where every column's rows start in set. **/
+	uint32_t *size;       /**< Number of rows still in every column. **/
+	uint64_t *stamp;      /**< Cover that last recorded every column on the trail. **/
+
+	uint32_t *set;    /**< The nodes of every column. **/
+	uint32_t *pos;    /**< Position of every node in set. **/
+	uint32_t *rank;   /**< Original position of every node in set. **/
+	uint32_t *item;   /**< Column of every node. **/
+	uint32_t *row;    /**< Row of every node. **/
+	uint32_t *first;  /**< First node of every row, and one past the last node. **/
+	int32_t *color;   /**< Color of every node, see struct node_slab.  0 if nothing is colored. **/
+
+	/**
+	 * Index in the source matrix of every copied row, in the order
+	 * the rows are laid out.
+	 */
+	size_t *rows;
+
+	struct trail_entry *trail;
+	size_t trail_size;
+	uint64_t covers; /**< Number of covers so far, tells them apart in stamp. **/
+
+	void *pool; /**< Single allocation backing all of the above. **/
+};
+
+/**
+ * Copy the active part of a matrix into a new cells matrix.
+ *
+ * Hidden rows are left out, covered columns are covered in the copy as
+ * well.
+ *
+ * @return the cells matrix or 0 if memory could not be allocated
+ */
+struct dlx_cells_matrix *dlx_cells_matrix_create(const struct dlx_matrix *);
+
+void dlx_cells_matrix_destroy(struct dlx_cells_matrix *);
+
+/**
+ * Index in the source matrix of the row node \c x belongs to.
+ */
+static inline size_t dlx_cells_matrix_row(const struct dlx_cells_matrix *cm, uint32_t x)
+{
+	return cm->rows[cm->row[x]];
+}
+
+/**
+ * The rows of column \c i that are still in the search are the nodes
+ * cm->set[dlx_cells_matrix_begin(cm, i)] up to (but not including)
+ * cm->set[dlx_cells_matrix_end(cm, i)].
+ */
+static inline uint32_t dlx_cells_matrix_begin(const struct dlx_cells_matrix *cm, uint32_t i) { return cm->start[i]; }
+
+static inline uint32_t dlx_cells_matrix_end(const struct dlx_cells_matrix *cm, uint32_t i)
+{
+	return cm->start[i] + cm->size[i];
+}
+
+/**
+ * The counterparts of the functions in dlx_dance.h and matrix_query.h.
+ *
+ * Covering a column puts its rows in their original order, so that they
+ * can be tried in that order.  Uncovering has to happen in the reverse
+ * order of covering, as with the other engines.
+ */
+size_t dlx_cells_dance_cover_column(struct dlx_cells_matrix *, uint32_t);
+size_t dlx_cells_dance_cover_all_columns_in_row(struct dlx_cells_matrix *, uint32_t);
+void dlx_cells_dance_uncover_column(struct dlx_cells_matrix *, uint32_t);
+void dlx_cells_dance_uncover_all_columns_in_row(struct dlx_cells_matrix *, uint32_t);
+
+uint32_t dlx_cells_matrix_query_smallest_column(const struct dlx_cells_matrix *);
+
+static inline bool dlx_cells_matrix_is_empty(const struct dlx_cells_matrix *cm) { return cm->num_active == 0; }
+
+#endif /* #ifndef LIBDLX_CELLS_MATRIX_H */
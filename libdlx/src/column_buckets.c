@@ -0,0 +1,82 @@
+#include "column_buckets.h"
+
+static size_t leftmost(const struct column_buckets *, size_t);
+
+struct column_buckets *dlx_column_buckets_create(const struct dlx_matrix *mat)
+{
+	struct column_buckets *b = calloc(1, sizeof(*b));
+
+	if (b == 0) {
+		return 0;
+	}
+
+	b->columns = mat->column_list;
+	b->num_primary = mat->primary_cols;
+	b->num_words = (mat->primary_cols + 63) / 64;
+	b->num_summary = (b->num_words + 63) / 64;
+	b->words = calloc(NUM_BUCKETS * (b->num_words + b->num_summary), sizeof(*b->words));
+
+	if (b->words == 0 && b->num_words != 0) {
+		free(b);
+		return 0;
+	}
+
+	b->summary = b->words + NUM_BUCKETS * b->num_words;
+
+	const struct node *root = &mat->root.node;
+	for (const struct node *h = root->right; h != root; h = h->right) {
+		const struct header *col = (const struct header *)h;
+		column_buckets_insert(b, (size_t)(col - b->columns), column_bucket(col->size));
+	}
+
+	return b;
+}
+
+void dlx_column_buckets_destroy(struct column_buckets *b)
+{
+	if (b != 0) {
+		free(b->words);
+		free(b);
+	}
+}
+
+struct header *dlx_column_buckets_query(const struct column_buckets *b)
+{
+	size_t i = SIZE_MAX;
+
+	/* The scan stops at the first column of size 1 but not at one of
+	   size 0, so the leftmost of both wins. */
+	if ((b->nonempty & 3) != 0) {
+		const size_t empty = (b->nonempty & 1) != 0 ? leftmost(b, 0) : SIZE_MAX;
+		const size_t single = (b->nonempty & 2) != 0 ? leftmost(b, 1) : SIZE_MAX;
+		i = empty < single ? empty : single;
+	} else {
+		const uint64_t sized = b->nonempty & ~(UINT64_C(1) << (NUM_BUCKETS - 1));
+		if (sized != 0) {
+			i = leftmost(b, (size_t)__builtin_ctzll(sized));
+		}
+	}
+
+	return i != SIZE_MAX ? &b->columns[i] : 0;
+}
+
+/** Unexposed functions **/
+
+/**
+ * The leftmost column in a bucket.
+ *
+ * @pre the bucket is not empty
+ */
+static size_t leftmost(const struct column_buckets *b, size_t k)
+{
+	const uint64_t *summary = b->summary + k * b->num_summary;
+	const uint64_t *words = b->words + k * b->num_words;
+
+	size_t s = 0;
+	while (summary[s] == 0) {
+		++s;
+	}
+
+	const size_t w = s * 64 + (size_t)__builtin_ctzll(summary[s]);
+	return w * 64 + (size_t)__builtin_ctzll(words[w]);
+}
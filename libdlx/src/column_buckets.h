@@ -0,0 +1,144 @@
+#ifndef LIBDLX_COLUMN_BUCKETS_H
+#define LIBDLX_COLUMN_BUCKETS_H
+
+#include "matrix_struct.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @file
+ *
+ * The uncovered primary columns of a matrix by size, for
+ * DLX_SELECTION_BUCKETS.
+ *
+ * Every column of the matrix leads to the buckets (see struct header).
+ * The uncovered primary columns are kept in a bitset per size (sizes of
+ * 63 and up share one), each with a summary bitset on top.  Covering,
+ * uncovering and every change in size move a column between bitsets,
+ * and the smallest column is the first bit of the first non-empty
+ * bitset.  Primary columns are in the list of columns in the order of
+ * their index, so the first bit is the leftmost column.
+ */
+
+/**
+ * Bitsets for sizes 0 .. NUM_BUCKETS - 2, and one for all larger sizes.
+ */
+#define NUM_BUCKETS 64
+
+struct column_buckets {
+	struct header *columns;    /**< The column_list of the matrix, column i is bit i. **/
+	size_t num_primary;        /**< Only primary columns are kept. **/
+	size_t num_words;          /**< Words in the bitset of a bucket. **/
+	size_t num_summary;        /**< Words in the summary of a bucket, bit w is set iff word w is not 0. **/
+	uint64_t nonempty;         /**< Bit b is set iff bucket b holds a column. **/
+	size_t count[NUM_BUCKETS]; /**< Columns in every bucket. **/
+	uint64_t *words;           /**< NUM_BUCKETS bitsets of num_words words. **/
+	uint64_t *summary;         /**< NUM_BUCKETS summaries of num_summary words. **/
+};
+
+/**
+ * Put every uncovered primary column of the matrix in the bucket of its
+ * size.
+ *
+ * @return the buckets or 0 if memory could not be allocated
+ */
+struct column_buckets *dlx_column_buckets_create(const struct dlx_matrix *);
+
+void dlx_column_buckets_destroy(struct column_buckets *);
+
+/**
+ * The same column as the scan in dlx_matrix_query_smallest_column picks,
+ * or 0 if all uncovered columns are in the last bucket and only a scan
+ * can tell them apart.
+ */
+struct header *dlx_column_buckets_query(const struct column_buckets *);
+
+static inline size_t column_bucket(size_t size) { return size < NUM_BUCKETS - 1 ? size : NUM_BUCKETS - 1; }
+
+static inline void column_buckets_insert(struct column_buckets *b, size_t i, size_t k)
+{
+	const size_t w = i / 64;
+	uint64_t *word = &b->words[k * b->num_words + w];
+
+	if (*word == 0) {
+		b->summary[k * b->num_summary + w / 64] |= UINT64_C(1) << (w % 64);
+	}
+	*word |= UINT64_C(1) << (i % 64);
+
+	if (b->count[k]++ == 0) {
+		b->nonempty |= UINT64_C(1) << k;
+	}
+}
+
+/**
+ * Take column \c i out of bucket \c k.
+ *
+ * @return false if it wasn't in there: it's covered (its size may still
+ *         change while it is, e.g. as the incremental solver takes out
+ *         rows) or not primary
+ */
+static inline bool column_buckets_remove(struct column_buckets *b, size_t i, size_t k)
+{
+	if (i >= b->num_primary) {
+		return false;
+	}
+
+	const size_t w = i / 64;
+	uint64_t *word = &b->words[k * b->num_words + w];
+	const uint64_t bit = UINT64_C(1) << (i % 64);
+
+	if ((*word & bit) == 0) {
+		return false;
+	}
+
+	*word &= ~bit;
+	if (*word == 0) {
+		b->summary[k * b->num_summary + w / 64] &= ~(UINT64_C(1) << (w % 64));
+	}
+
+	if (--b->count[k] == 0) {
+		b->nonempty &= ~(UINT64_C(1) << k);
+	}
+
+	return true;
+}
+
+/**
+ * Take \c col out of its bucket, it's being covered.
+ */
+static inline void column_buckets_cover(struct header *col)
+{
+	struct column_buckets *b = col->matrix->buckets;
+	column_buckets_remove(b, (size_t)(col - b->columns), column_bucket(col->size));
+}
+
+/**
+ * Put \c col back in the bucket of its size, it's being uncovered.
+ */
+static inline void column_buckets_uncover(struct header *col)
+{
+	struct column_buckets *b = col->matrix->buckets;
+	const size_t i = (size_t)(col - b->columns);
+
+	if (i < b->num_primary) {
+		column_buckets_insert(b, i, column_bucket(col->size));
+	}
+}
+
+/**
+ * Move \c col to the bucket of its size if that changed, it was
+ * \c old_size.
+ */
+static inline void column_buckets_resize(struct header *col, size_t old_size)
+{
+	struct column_buckets *b = col->matrix->buckets;
+	const size_t from = column_bucket(old_size);
+	const size_t to = column_bucket(col->size);
+
+	if (from != to && column_buckets_remove(b, (size_t)(col - b->columns), from)) {
+		column_buckets_insert(b, (size_t)(col - b->columns), to);
+	}
+}
+
+#endif /* #ifndef LIBDLX_COLUMN_BUCKETS_H */
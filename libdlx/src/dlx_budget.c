@@ -0,0 +1,83 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "budget_struct.h"
+
+#include <stdlib.h>
+#include <time.h>
+
+static double now(void);
+
+struct dlx_budget *dlx_budget_create(void)
+{
+	struct dlx_budget *budget = calloc(1, sizeof(*budget));
+
+	if (budget == 0) {
+		return 0;
+	}
+
+	budget->status = DLX_BUDGET_OK;
+	return budget;
+}
+
+void dlx_budget_destroy(struct dlx_budget *budget) { free(budget); }
+
+void dlx_budget_set_max_nodes(struct dlx_budget *budget, uint64_t max_nodes) { budget->max_nodes = max_nodes; }
+
+void dlx_budget_set_max_updates(struct dlx_budget *budget, uint64_t max_updates)
+{
+	budget->max_updates = max_updates;
+}
+
+void dlx_budget_set_time_limit(struct dlx_budget *budget, double seconds) { budget->time_limit = seconds; }
+
+void dlx_budget_cancel(struct dlx_budget *budget)
+{
+	__atomic_store_n(&budget->cancelled, true, __ATOMIC_RELAXED);
+}
+
+void dlx_budget_reset(struct dlx_budget *budget)
+{
+	__atomic_store_n(&budget->cancelled, false, __ATOMIC_RELAXED);
+}
+
+enum dlx_budget_status dlx_budget_status(const struct dlx_budget *budget) { return budget->status; }
+
+uint64_t dlx_budget_nodes(const struct dlx_budget *budget) { return budget->nodes; }
+
+uint64_t dlx_budget_updates(const struct dlx_budget *budget) { return budget->updates; }
+
+void dlx_budget_begin(struct dlx_budget *budget)
+{
+	budget->status = DLX_BUDGET_OK;
+	budget->nodes = 0;
+	budget->updates = 0;
+	budget->deadline = budget->time_limit > 0 ? now() + budget->time_limit : 0;
+	budget->steps = 0;
+
+	/* Don't even start if the budget was cancelled already. */
+	dlx_budget_poll(budget);
+}
+
+bool dlx_budget_poll(struct dlx_budget *budget)
+{
+	if (__atomic_load_n(&budget->cancelled, __ATOMIC_RELAXED)) {
+		budget->status = DLX_BUDGET_CANCELLED;
+	} else if (budget->time_limit > 0 && now() >= budget->deadline) {
+		budget->status = DLX_BUDGET_TIME;
+	}
+
+	return budget->status != DLX_BUDGET_OK;
+}
+
+/** Unexposed functions **/
+
+/**
+ * Seconds on the monotonic clock.
+ */
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
@@ -0,0 +1,33 @@
+#include "dlx_count.h"
+
+#include <stddef.h>
+
+char *dlx_count_format(struct dlx_count count, char *buffer)
+{
+	char digits[DLX_COUNT_STRING_SIZE];
+	size_t n = 0;
+
+	/* Long division by 10, 32 bits at a time so that nothing overflows. */
+	do {
+		uint32_t parts[4] = {(uint32_t)(count.high >> 32), (uint32_t)count.high, (uint32_t)(count.low >> 32),
+				     (uint32_t)count.low};
+		uint64_t remainder = 0;
+
+		for (size_t i = 0; i < 4; ++i) {
+			const uint64_t part = remainder << 32 | parts[i];
+			parts[i] = (uint32_t)(part / 10);
+			remainder = part % 10;
+		}
+
+		digits[n++] = (char)('0' + remainder);
+		count.high = (uint64_t)parts[0] << 32 | parts[1];
+		count.low = (uint64_t)parts[2] << 32 | parts[3];
+	} while (count.high != 0 || count.low != 0);
+
+	for (size_t i = 0; i < n; ++i) {
+		buffer[i] = digits[n - 1 - i];
+	}
+	buffer[n] = '\0';
+
+	return buffer;
+}
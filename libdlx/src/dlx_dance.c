@@ -1,31 +1,44 @@
 #include "dlx_dance.h"
 
-void dlx_dance_cover_column(struct header *col)
-{
-	struct node *header = (struct node *)col;
+#include "column_buckets.h"
 
-	header->right->left = header->left;
-	header->left->right = header->right;
+static inline size_t cover(struct header *, bool, bool);
+static inline void uncover(struct header *, bool, bool);
+static inline size_t use(struct header *, bool, bool);
+static inline void unuse(struct header *, bool, bool);
+static inline size_t cover_row(struct node *, bool);
+static inline void uncover_row(struct node *, bool);
+static inline size_t use_row(struct node *, bool);
+static inline void unuse_row(struct node *, bool);
+static inline size_t hide(struct node *, bool);
+static inline void unhide(struct node *, bool);
+static size_t hide_colored(struct node *, bool);
+static void unhide_colored(struct node *, bool);
+static size_t commit_colored_row(struct node *, bool, bool);
+static void uncommit_colored_row(struct node *, bool, bool);
+static size_t purify(struct node *, bool);
+static void unpurify(struct node *, bool);
 
-	for (struct node *v = header->down; v != header; v = v->down) {
-		for (struct node *h = v->right; h != v; h = h->right) {
-			h->down->up = h->up;
-			h->up->down = h->down;
-			--h->head->size;
-		}
-	}
+size_t dlx_dance_cover_column(struct header *col)
+{
+	return header_buckets(col) != 0 ? cover(col, header_colored(col), true) : cover(col, header_colored(col), false);
 }
 
 /**
  * Note: v->head is not covered.  The algorithm calls
  *       dlx_dance_cover_column on v->head and this function
  *       on the row that is included in a solution.
+ *
+ *       A colored one purifies its column instead of covering it, a
+ *       purified one is left alone (its column already has that color).
  */
-void dlx_dance_cover_all_columns_in_row(struct node *v)
+size_t dlx_dance_cover_all_columns_in_row(struct node *v)
 {
-	for (struct node *h = v->right; h != v; h = h->right) {
-		dlx_dance_cover_column(h->head);
+	if (header_colored(v->head)) {
+		return commit_colored_row(v, false, header_buckets(v->head) != 0);
 	}
+
+	return header_buckets(v->head) != 0 ? cover_row(v, true) : cover_row(v, false);
 }
 
 /**
@@ -33,29 +46,372 @@ void dlx_dance_cover_all_columns_in_row(struct node *v)
  *       of dlx_dance_cover_column.
  */
 void dlx_dance_uncover_column(struct header *col)
+{
+	if (header_buckets(col) != 0) {
+		uncover(col, header_colored(col), true);
+	} else {
+		uncover(col, header_colored(col), false);
+	}
+}
+
+/**
+ * Note: v->head is not uncovered.  The algorithm calls
+ *       this function on the row that is excluded from the
+ *       solution and then dlx_dance_uncover_column on v->head.
+ */
+void dlx_dance_uncover_all_columns_in_row(struct node *v)
+{
+	if (header_colored(v->head)) {
+		uncommit_colored_row(v, false, header_buckets(v->head) != 0);
+	} else if (header_buckets(v->head) != 0) {
+		uncover_row(v, true);
+	} else {
+		uncover_row(v, false);
+	}
+}
+
+size_t dlx_dance_use_column(struct header *col)
+{
+	return header_buckets(col) != 0 ? use(col, header_colored(col), true) : use(col, header_colored(col), false);
+}
+
+/**
+ * Same as dlx_dance_cover_all_columns_in_row, but an uncolored one uses
+ * its column rather than covering it.
+ */
+size_t dlx_dance_use_all_columns_in_row(struct node *v)
+{
+	if (header_colored(v->head)) {
+		return commit_colored_row(v, true, header_buckets(v->head) != 0);
+	}
+
+	return header_buckets(v->head) != 0 ? use_row(v, true) : use_row(v, false);
+}
+
+/**
+ * Note: v has to be the first node of its column.  It's taken out of the
+ *       column and its row is hidden, so that neither this column nor
+ *       any other column offers it again.
+ */
+size_t dlx_dance_tweak(struct node *v)
+{
+	struct header *col = v->head;
+
+	const bool bucketed = header_buckets(col) != 0;
+
+	v->down->up = v->up;
+	v->up->down = v->down;
+	--col->size;
+	if (bucketed) {
+		column_buckets_resize(col, col->size + 1);
+	}
+
+	if (header_colored(col)) {
+		return 1 + hide_colored(v, bucketed);
+	}
+
+	return 1 + (bucketed ? hide(v, true) : hide(v, false));
+}
+
+void dlx_dance_unuse_column(struct header *col)
+{
+	if (header_buckets(col) != 0) {
+		unuse(col, header_colored(col), true);
+	} else {
+		unuse(col, header_colored(col), false);
+	}
+}
+
+void dlx_dance_unuse_all_columns_in_row(struct node *v)
+{
+	if (header_colored(v->head)) {
+		uncommit_colored_row(v, true, header_buckets(v->head) != 0);
+	} else if (header_buckets(v->head) != 0) {
+		unuse_row(v, true);
+	} else {
+		unuse_row(v, false);
+	}
+}
+
+/**
+ * Note: this reverses all the tweaks made to the column since its first
+ *       node was \c first.  The tweaked nodes still point down to one
+ *       another, which puts them back in the column in one go.  Their rows
+ *       are then unhidden in the reverse order.
+ */
+void dlx_dance_untweak(struct header *col, struct node *first)
+{
+	struct node *header = (struct node *)col;
+	struct node *rest = header->down;
+	struct node *last = header;
+	const size_t old_size = col->size;
+	const bool bucketed = header_buckets(col) != 0;
+
+	header->down = first;
+	for (struct node *v = first; v != rest; v = v->down) {
+		v->up = last;
+		last = v;
+		++col->size;
+	}
+	rest->up = last;
+	if (bucketed) {
+		column_buckets_resize(col, old_size);
+	}
+
+	for (struct node *v = last; v != header; v = v->up) {
+		if (header_colored(col)) {
+			unhide_colored(v, bucketed);
+		} else if (bucketed) {
+			unhide(v, true);
+		} else {
+			unhide(v, false);
+		}
+	}
+}
+
+/** Unexposed functions **/
+
+/**
+ * The column operations, \c colored tells whether the matrix has colors
+ * and \c bucketed whether its columns are kept in buckets (see
+ * column_buckets.h), so that the ones without them can be inlined
+ * without looking.
+ */
+static inline size_t cover(struct header *col, bool colored, bool bucketed)
+{
+	struct node *header = (struct node *)col;
+	size_t updates = 1;
+
+	header->right->left = header->left;
+	header->left->right = header->right;
+	if (bucketed) {
+		column_buckets_cover(col);
+	}
+
+	for (struct node *v = header->down; v != header; v = v->down) {
+		updates += colored ? hide_colored(v, bucketed) : hide(v, bucketed);
+	}
+
+	return updates;
+}
+
+static inline void uncover(struct header *col, bool colored, bool bucketed)
 {
 	struct node *header = (struct node *)col;
 
 	for (struct node *v = header->up; v != header; v = v->up) {
-		for (struct node *h = v->left; h != v; h = h->left) {
-			++h->head->size;
-			h->up->down = h;
-			h->down->up = h;
+		if (colored) {
+			unhide_colored(v, bucketed);
+		} else {
+			unhide(v, bucketed);
 		}
 	}
 
 	header->left->right = header;
 	header->right->left = header;
+	if (bucketed) {
+		column_buckets_uncover(col);
+	}
+}
+
+static inline size_t use(struct header *col, bool colored, bool bucketed)
+{
+	if (--col->bound == 0) {
+		return cover(col, colored, bucketed);
+	}
+
+	return 0;
+}
+
+static inline void unuse(struct header *col, bool colored, bool bucketed)
+{
+	if (col->bound++ == 0) {
+		uncover(col, colored, bucketed);
+	}
 }
 
 /**
- * Note: v->head is not uncovered.  The algorithm calls
- *       this function on the row that is excluded from the
- *       solution and then dlx_dance_uncover_column on v->head.
+ * The row operations for a matrix without colors.
  */
-void dlx_dance_uncover_all_columns_in_row(struct node *v)
+static inline size_t cover_row(struct node *v, bool bucketed)
+{
+	size_t updates = 0;
+
+	for (struct node *h = v->right; h != v; h = h->right) {
+		updates += cover(h->head, false, bucketed);
+	}
+
+	return updates;
+}
+
+static inline void uncover_row(struct node *v, bool bucketed)
 {
 	for (struct node *h = v->left; h != v; h = h->left) {
-		dlx_dance_uncover_column(h->head);
+		uncover(h->head, false, bucketed);
+	}
+}
+
+static inline size_t use_row(struct node *v, bool bucketed)
+{
+	size_t updates = 0;
+
+	for (struct node *h = v->right; h != v; h = h->right) {
+		updates += use(h->head, false, bucketed);
+	}
+
+	return updates;
+}
+
+static inline void unuse_row(struct node *v, bool bucketed)
+{
+	for (struct node *h = v->left; h != v; h = h->left) {
+		unuse(h->head, false, bucketed);
+	}
+}
+
+/**
+ * Remove all the other nodes in the row of v from their columns.
+ */
+static inline size_t hide(struct node *v, bool bucketed)
+{
+	size_t updates = 0;
+
+	for (struct node *h = v->right; h != v; h = h->right) {
+		h->down->up = h->up;
+		h->up->down = h->down;
+		--h->head->size;
+		if (bucketed) {
+			column_buckets_resize(h->head, h->head->size + 1);
+		}
+		++updates;
+	}
+
+	return updates;
+}
+
+static inline void unhide(struct node *v, bool bucketed)
+{
+	for (struct node *h = v->left; h != v; h = h->left) {
+		++h->head->size;
+		if (bucketed) {
+			column_buckets_resize(h->head, h->head->size - 1);
+		}
+		h->up->down = h;
+		h->down->up = h;
+	}
+}
+
+/**
+ * Same as hide for a matrix with colors: purified nodes stay, their
+ * columns are never searched.
+ */
+static size_t hide_colored(struct node *v, bool bucketed)
+{
+	size_t updates = 0;
+
+	for (struct node *h = v->right; h != v; h = h->right) {
+		if (node_color(h) >= 0) {
+			h->down->up = h->up;
+			h->up->down = h->down;
+			--h->head->size;
+			if (bucketed) {
+				column_buckets_resize(h->head, h->head->size + 1);
+			}
+			++updates;
+		}
+	}
+
+	return updates;
+}
+
+static void unhide_colored(struct node *v, bool bucketed)
+{
+	for (struct node *h = v->left; h != v; h = h->left) {
+		if (node_color(h) >= 0) {
+			++h->head->size;
+			if (bucketed) {
+				column_buckets_resize(h->head, h->head->size - 1);
+			}
+			h->up->down = h;
+			h->down->up = h;
+		}
+	}
+}
+
+/**
+ * dlx_dance_cover_all_columns_in_row (or with \c use_column set,
+ * dlx_dance_use_all_columns_in_row) for a matrix with colors: a colored
+ * one purifies its column instead, a purified one is left alone.
+ */
+static size_t commit_colored_row(struct node *v, bool use_column, bool bucketed)
+{
+	size_t updates = 0;
+
+	for (struct node *h = v->right; h != v; h = h->right) {
+		const int32_t color = node_color(h);
+
+		if (color == 0) {
+			updates += use_column ? use(h->head, true, bucketed) : cover(h->head, true, bucketed);
+		} else if (color > 0) {
+			updates += purify(h, bucketed);
+		}
+	}
+
+	return updates;
+}
+
+static void uncommit_colored_row(struct node *v, bool use_column, bool bucketed)
+{
+	for (struct node *h = v->left; h != v; h = h->left) {
+		const int32_t color = node_color(h);
+
+		if (color == 0) {
+			if (use_column) {
+				unuse(h->head, true, bucketed);
+			} else {
+				uncover(h->head, true, bucketed);
+			}
+		} else if (color > 0) {
+			unpurify(h, bucketed);
+		}
+	}
+}
+
+/**
+ * Commit the column of p to the color of p: hide the rows that give it
+ * another color and mark the ones that give it the same color.
+ */
+static size_t purify(struct node *p, bool bucketed)
+{
+	struct node *header = (struct node *)p->head;
+	const int32_t color = node_color(p);
+	size_t updates = 0;
+
+	for (struct node *v = header->down; v != header; v = v->down) {
+		int32_t *v_color = node_color_slot(v);
+
+		if (v_color == 0 || *v_color != color) {
+			updates += hide_colored(v, bucketed);
+		} else if (v != p) {
+			*v_color = -1;
+		}
+	}
+
+	return updates;
+}
+
+static void unpurify(struct node *p, bool bucketed)
+{
+	struct node *header = (struct node *)p->head;
+	const int32_t color = node_color(p);
+
+	for (struct node *v = header->up; v != header; v = v->up) {
+		int32_t *v_color = node_color_slot(v);
+
+		if (v_color != 0 && *v_color < 0) {
+			*v_color = color;
+		} else if (v != p) {
+			unhide_colored(v, bucketed);
+		}
 	}
 }
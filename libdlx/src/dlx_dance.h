@@ -9,10 +9,28 @@
  * Contains functions to make the links ``dance''.
  */
 
-void dlx_dance_cover_column(struct header *);
-void dlx_dance_cover_all_columns_in_row(struct node *);
+/*
+ * The cover functions return the amount of updates they made, as counted
+ * by Knuth: one for every column taken out of the list of columns and
+ * one for every node taken out of its column.
+ */
+size_t dlx_dance_cover_column(struct header *);
+size_t dlx_dance_cover_all_columns_in_row(struct node *);
 
 void dlx_dance_uncover_column(struct header *);
 void dlx_dance_uncover_all_columns_in_row(struct node *);
 
+/*
+ * Algorithm M, for columns with multiplicities.  Using a column lowers
+ * its bound and only covers it once that runs out, tweaking a row takes
+ * it out of the search while its column is being branched on.
+ */
+size_t dlx_dance_use_column(struct header *);
+size_t dlx_dance_use_all_columns_in_row(struct node *);
+size_t dlx_dance_tweak(struct node *);
+
+void dlx_dance_unuse_column(struct header *);
+void dlx_dance_unuse_all_columns_in_row(struct node *);
+void dlx_dance_untweak(struct header *, struct node *);
+
 #endif /* #ifndef LIBDLX_DANCE_H */
@@ -0,0 +1,135 @@
+#include "dlx_estimator.h"
+
+#include "dlx_dance.h"
+#include "matrix_query.h"
+#include "matrix_struct.h"
+
+#include <math.h>
+
+/**
+ * Running mean and variance of one quantity (Welford's method).
+ */
+struct running_stats {
+	double mean;
+	double m2; /* Sum of squared differences from the mean. */
+};
+
+static void probe(struct dlx_matrix *, struct node **, uint64_t *, double *, double *, double *);
+static void add_sample(struct running_stats *, size_t, double);
+static struct dlx_estimate_value estimate_value(const struct running_stats *, size_t);
+
+bool dlx_estimate_search(struct dlx_matrix *mat, size_t probes, unsigned int seed, struct dlx_estimate *estimate)
+{
+	if (mat->multiplicities) {
+		return false;
+	}
+
+	/* Every row on the path covers a different primary column. */
+	struct node **path = malloc(sizeof(*path) * (mat->primary_cols + 1));
+
+	if (path == 0) {
+		return false;
+	}
+
+	/* One round of splitmix64 turns small seeds into a usable state. */
+	uint64_t state = (uint64_t)seed + UINT64_C(0x9e3779b97f4a7c15);
+	state = (state ^ (state >> 30)) * UINT64_C(0xbf58476d1ce4e5b9);
+	state = (state ^ (state >> 27)) * UINT64_C(0x94d049bb133111eb);
+	state = (state ^ (state >> 31)) | 1;
+
+	struct running_stats nodes = {0, 0}, solutions = {0, 0}, updates = {0, 0};
+
+	for (size_t i = 0; i < probes; ++i) {
+		double probe_nodes, probe_solutions, probe_updates;
+
+		probe(mat, path, &state, &probe_nodes, &probe_solutions, &probe_updates);
+		add_sample(&nodes, i + 1, probe_nodes);
+		add_sample(&solutions, i + 1, probe_solutions);
+		add_sample(&updates, i + 1, probe_updates);
+	}
+
+	free(path);
+
+	estimate->probes = probes;
+	estimate->nodes = estimate_value(&nodes, probes);
+	estimate->solutions = estimate_value(&solutions, probes);
+	estimate->updates = estimate_value(&updates, probes);
+
+	return true;
+}
+
+/** Unexposed functions **/
+
+/**
+ * Walk down to a leaf choosing random rows, then back up again.
+ *
+ * At a node that stands in for \c weight nodes the search covers the
+ * smallest column c and then, for each of its d rows, the other columns
+ * of that row.  The updates of the one row the probe covers, times d,
+ * estimate those of all d rows.
+ */
+static void probe(struct dlx_matrix *mat, struct node **path, uint64_t *state, double *nodes, double *solutions,
+		  double *updates)
+{
+	double weight = 1;
+	size_t depth = 0;
+
+	*nodes = 0;
+	*solutions = 0;
+	*updates = 0;
+
+	for (;;) {
+		*nodes += weight;
+
+		if (dlx_matrix_is_empty(mat)) {
+			*solutions = weight;
+			break;
+		}
+
+		struct header *column = dlx_matrix_query_smallest_column(mat);
+		const size_t choices = column->size;
+		const size_t column_updates = dlx_dance_cover_column(column);
+
+		if (choices == 0) {
+			*updates += weight * (double)column_updates;
+			dlx_dance_uncover_column(column);
+			break;
+		}
+
+		struct node *row = ((struct node *)column)->down;
+		for (uint64_t skip = dlx_random_next(state) % choices; skip > 0; --skip) {
+			row = row->down;
+		}
+
+		const size_t row_updates = dlx_dance_cover_all_columns_in_row(row);
+		*updates += weight * ((double)column_updates + (double)choices * (double)row_updates);
+
+		path[depth++] = row;
+		weight *= (double)choices;
+	}
+
+	while (depth-- > 0) {
+		dlx_dance_uncover_all_columns_in_row(path[depth]);
+		dlx_dance_uncover_column(path[depth]->head);
+	}
+}
+
+static void add_sample(struct running_stats *stats, size_t n, double x)
+{
+	const double delta = x - stats->mean;
+
+	stats->mean += delta / (double)n;
+	stats->m2 += delta * (x - stats->mean);
+}
+
+static struct dlx_estimate_value estimate_value(const struct running_stats *stats, size_t n)
+{
+	struct dlx_estimate_value value;
+
+	value.mean = stats->mean;
+	value.standard_error = n > 1 ? sqrt(stats->m2 / (double)(n - 1) / (double)n) : 0;
+	value.low = fmax(0, value.mean - 1.96 * value.standard_error);
+	value.high = value.mean + 1.96 * value.standard_error;
+
+	return value;
+}
@@ -0,0 +1,415 @@
+#include "dlx_incremental_solver.h"
+
+#include "column_buckets.h"
+#include "dlx_dance.h"
+#include "matrix_query.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+struct assumption {
+	struct node *row;
+	bool forced; /**< Forced, or else hidden. **/
+};
+
+struct dlx_incremental_solver {
+	struct dlx_matrix *matrix;
+	struct node **row_node;         /**< A node of every row by index, 0 if it was hidden. **/
+	bool *covered;                  /**< Whether a forced row covers every column. **/
+	struct assumption *assumptions; /**< Room for every row, a row is pushed at most once. **/
+	size_t num_assumptions;
+
+	/**
+	 * What the counts found out.  If \c known, every solution other than
+	 * \c solution (if \c has_solution) takes one of the rows in
+	 * \c unhidden.
+	 */
+	bool known;
+	bool has_solution;
+	struct node **solution;
+	size_t solution_rows;
+	bool *in_solution;       /**< Whether every row is in solution. **/
+	struct node **unhidden;
+	size_t num_unhidden;
+	size_t *unhidden_index;  /**< Where every row is in unhidden, SIZE_MAX if it isn't. **/
+
+	/* State of a count. */
+	size_t limit;
+	size_t found;
+	struct node **path;      /**< Rows chosen by the search so far. **/
+	size_t depth;
+	size_t unhidden_chosen;  /**< Unhidden rows in path. **/
+	struct node **first;     /**< The first solution found, forced rows first. **/
+	size_t first_rows;
+};
+
+static bool available(const struct dlx_incremental_solver *, const struct node *);
+static void force(struct dlx_incremental_solver *, struct node *);
+static void hide(struct dlx_incremental_solver *, struct node *);
+static void undo(struct dlx_incremental_solver *);
+static void unlink_row(struct node *);
+static void relink_row(struct node *);
+static bool unhidden_left(const struct dlx_incremental_solver *);
+static void search(struct dlx_incremental_solver *);
+static void learn(struct dlx_incremental_solver *);
+static void forget_unhidden(struct dlx_incremental_solver *, size_t);
+
+struct dlx_incremental_solver *dlx_incremental_solver_create(struct dlx_matrix *matrix)
+{
+	if (matrix->colored || matrix->multiplicities) {
+		return 0;
+	}
+
+	struct dlx_incremental_solver *s = calloc(1, sizeof(*s));
+
+	if (s == 0) {
+		return 0;
+	}
+
+	const size_t num_rows = matrix->rows_in_mat + 1;
+	const size_t num_cols = matrix->primary_cols + matrix->secondary_cols;
+
+	s->matrix = matrix;
+	s->row_node = calloc(num_rows, sizeof(*s->row_node));
+	s->covered = calloc(num_cols + 1, sizeof(*s->covered));
+	s->assumptions = malloc(sizeof(*s->assumptions) * num_rows);
+	s->solution = malloc(sizeof(*s->solution) * num_rows);
+	s->in_solution = calloc(num_rows, sizeof(*s->in_solution));
+	s->unhidden = malloc(sizeof(*s->unhidden) * num_rows);
+	s->unhidden_index = malloc(sizeof(*s->unhidden_index) * num_rows);
+	s->path = malloc(sizeof(*s->path) * (matrix->primary_cols + 1));
+	s->first = malloc(sizeof(*s->first) * num_rows);
+
+	if (s->row_node == 0 || s->covered == 0 || s->assumptions == 0 || s->solution == 0 || s->in_solution == 0 ||
+	    s->unhidden == 0 || s->unhidden_index == 0 || s->path == 0 || s->first == 0) {
+		dlx_incremental_solver_destroy(s);
+		return 0;
+	}
+
+	for (size_t r = 0; r < num_rows; ++r) {
+		s->unhidden_index[r] = SIZE_MAX;
+	}
+
+	for (size_t c = 0; c < num_cols; ++c) {
+		struct node *header = (struct node *)&matrix->column_list[c];
+		for (struct node *v = header->down; v != header; v = v->down) {
+			s->row_node[v->row] = v;
+		}
+	}
+
+	return s;
+}
+
+void dlx_incremental_solver_destroy(struct dlx_incremental_solver *s)
+{
+	while (s->num_assumptions > 0) {
+		undo(s);
+	}
+
+	free(s->row_node);
+	free(s->covered);
+	free(s->assumptions);
+	free(s->solution);
+	free(s->in_solution);
+	free(s->unhidden);
+	free(s->unhidden_index);
+	free(s->path);
+	free(s->first);
+	free(s);
+}
+
+bool dlx_incremental_solver_push_forced_row(struct dlx_incremental_solver *s, size_t row)
+{
+	if (row >= s->matrix->rows_in_mat || s->row_node[row] == 0 || !available(s, s->row_node[row])) {
+		return false;
+	}
+
+	/* A count skips the unhidden rows that are forced. */
+	if (s->unhidden_index[row] != SIZE_MAX) {
+		s->known = false;
+	}
+	s->has_solution = s->has_solution && s->in_solution[row];
+
+	force(s, s->row_node[row]);
+	return true;
+}
+
+bool dlx_incremental_solver_push_hidden_row(struct dlx_incremental_solver *s, size_t row)
+{
+	if (row >= s->matrix->rows_in_mat || s->row_node[row] == 0 || !available(s, s->row_node[row])) {
+		return false;
+	}
+
+	s->has_solution = s->has_solution && !s->in_solution[row];
+	forget_unhidden(s, row);
+
+	hide(s, s->row_node[row]);
+	return true;
+}
+
+void dlx_incremental_solver_pop(struct dlx_incremental_solver *s)
+{
+	const struct assumption a = s->assumptions[s->num_assumptions - 1];
+
+	undo(s);
+
+	if (a.forced) {
+		s->known = false;
+	} else if (s->known) {
+		s->unhidden_index[a.row->row] = s->num_unhidden;
+		s->unhidden[s->num_unhidden++] = a.row;
+	}
+}
+
+size_t dlx_incremental_solver_num_assumptions(const struct dlx_incremental_solver *s)
+{
+	return s->num_assumptions;
+}
+
+size_t dlx_incremental_solver_count_solutions_up_to(struct dlx_incremental_solver *s, size_t limit,
+						    const void **solution, size_t *num_rows)
+{
+	s->limit = limit == 0 ? SIZE_MAX : limit;
+	s->found = 0;
+
+	if (s->known && s->has_solution) {
+		s->found = 1;
+		s->first_rows = s->solution_rows;
+		memcpy(s->first, s->solution, sizeof(*s->first) * s->solution_rows);
+	}
+	if (s->found < s->limit) {
+		search(s);
+	}
+
+	/* A count that wasn't cut short is exact, the solver can only hold on
+	   to a single solution though. */
+	if (s->found < s->limit && s->found <= 1) {
+		learn(s);
+	}
+
+	if (s->found > 0) {
+		for (size_t i = 0; i < s->first_rows && solution != 0; ++i) {
+			solution[i] = s->matrix->row_data[s->first[i]->row];
+		}
+		if (num_rows != 0) {
+			*num_rows = s->first_rows;
+		}
+	}
+
+	return s->found;
+}
+
+bool dlx_incremental_solver_is_unique(struct dlx_incremental_solver *s, const void **solution, size_t *num_rows)
+{
+	return dlx_incremental_solver_count_solutions_up_to(s, 2, solution, num_rows) == 1;
+}
+
+/** Unexposed functions **/
+
+/**
+ * Is the row in the matrix as the assumptions leave it?  A row that
+ * shares a column with a forced row is still linked into that column, it
+ * has been taken out of its other columns.
+ */
+static bool available(const struct dlx_incremental_solver *s, const struct node *row)
+{
+	const struct node *h = row;
+
+	do {
+		if (h->up->down != h || s->covered[h->head - s->matrix->column_list]) {
+			return false;
+		}
+		h = h->right;
+	} while (h != row);
+
+	return true;
+}
+
+/**
+ * Cover the columns of a row, the way the search chooses it.
+ */
+static void force(struct dlx_incremental_solver *s, struct node *row)
+{
+	const struct node *h = row;
+
+	dlx_dance_cover_column(row->head);
+	dlx_dance_cover_all_columns_in_row(row);
+	do {
+		s->covered[h->head - s->matrix->column_list] = true;
+		h = h->right;
+	} while (h != row);
+
+	s->assumptions[s->num_assumptions++] = (struct assumption){row, true};
+}
+
+static void hide(struct dlx_incremental_solver *s, struct node *row)
+{
+	unlink_row(row);
+	s->assumptions[s->num_assumptions++] = (struct assumption){row, false};
+}
+
+/**
+ * Take back the last assumption, leaving what the solver knows alone.
+ */
+static void undo(struct dlx_incremental_solver *s)
+{
+	const struct assumption a = s->assumptions[--s->num_assumptions];
+
+	if (!a.forced) {
+		relink_row(a.row);
+		return;
+	}
+
+	const struct node *h = a.row;
+	do {
+		s->covered[h->head - s->matrix->column_list] = false;
+		h = h->right;
+	} while (h != a.row);
+
+	dlx_dance_uncover_all_columns_in_row(a.row);
+	dlx_dance_uncover_column(a.row->head);
+}
+
+/**
+ * Same as dlx_matrix_hide_row.
+ */
+static void unlink_row(struct node *row)
+{
+	struct node *n = row;
+
+	do {
+		n->up->down = n->down;
+		n->down->up = n->up;
+		--n->head->size;
+		if (header_buckets(n->head) != 0) {
+			column_buckets_resize(n->head, n->head->size + 1);
+		}
+		n = n->right;
+	} while (n != row);
+}
+
+/**
+ * Undo unlink_row.  Unlike dlx_matrix_unhide_row this puts the row back
+ * where it was, which the links taken out by the assumptions pushed
+ * before it rely on.
+ */
+static void relink_row(struct node *row)
+{
+	struct node *n = row;
+
+	do {
+		n = n->left;
+		n->up->down = n;
+		n->down->up = n;
+		++n->head->size;
+		if (header_buckets(n->head) != 0) {
+			column_buckets_resize(n->head, n->head->size - 1);
+		}
+	} while (n != row);
+}
+
+/**
+ * Whether one of the rows unhidden since the solver knew all solutions is
+ * still in the matrix as the search leaves it.  A row of a single node
+ * whose column the search covered still looks available, which only
+ * spares the search less.
+ */
+static bool unhidden_left(const struct dlx_incremental_solver *s)
+{
+	for (size_t i = 0; i < s->num_unhidden; ++i) {
+		if (available(s, s->unhidden[i])) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/**
+ * Same as enumerate in dlx_recursive_solver.c, keeping the first solution
+ * and stopping at the limit.
+ *
+ * If the solver knows all solutions, those that take no unhidden row are
+ * counted already.  Until the search chooses an unhidden row it gives up
+ * on a branch as soon as none of them is left.
+ */
+static void search(struct dlx_incremental_solver *s)
+{
+	const bool counted = s->known && s->unhidden_chosen == 0;
+
+	if (dlx_matrix_is_empty(s->matrix)) {
+		if (counted || s->found++ > 0) {
+			return;
+		}
+
+		s->first_rows = 0;
+		for (size_t i = 0; i < s->num_assumptions; ++i) {
+			if (s->assumptions[i].forced) {
+				s->first[s->first_rows++] = s->assumptions[i].row;
+			}
+		}
+		memcpy(s->first + s->first_rows, s->path, sizeof(*s->path) * s->depth);
+		s->first_rows += s->depth;
+		return;
+	}
+
+	if (counted && !unhidden_left(s)) {
+		return;
+	}
+
+	struct header *column = dlx_matrix_query_smallest_column(s->matrix);
+	dlx_dance_cover_column(column);
+	for (struct node *vnode = ((struct node *)column)->down; vnode != (struct node *)column && s->found < s->limit;
+	     vnode = vnode->down) {
+		const bool unhidden = s->unhidden_index[vnode->row] != SIZE_MAX;
+
+		dlx_dance_cover_all_columns_in_row(vnode);
+		s->path[s->depth++] = vnode;
+		s->unhidden_chosen += unhidden;
+		search(s);
+		s->unhidden_chosen -= unhidden;
+		--s->depth;
+		dlx_dance_uncover_all_columns_in_row(vnode);
+	}
+	dlx_dance_uncover_column(column);
+}
+
+/**
+ * Remember the first solution found as the only one there is.
+ */
+static void learn(struct dlx_incremental_solver *s)
+{
+	for (size_t i = 0; i < s->solution_rows; ++i) {
+		s->in_solution[s->solution[i]->row] = false;
+	}
+	for (size_t i = 0; i < s->num_unhidden; ++i) {
+		s->unhidden_index[s->unhidden[i]->row] = SIZE_MAX;
+	}
+
+	s->known = true;
+	s->has_solution = s->found == 1;
+	s->solution_rows = s->has_solution ? s->first_rows : 0;
+	s->num_unhidden = 0;
+
+	memcpy(s->solution, s->first, sizeof(*s->solution) * s->solution_rows);
+	for (size_t i = 0; i < s->solution_rows; ++i) {
+		s->in_solution[s->solution[i]->row] = true;
+	}
+}
+
+/**
+ * A hidden row's solutions are gone, it no longer needs to be searched.
+ */
+static void forget_unhidden(struct dlx_incremental_solver *s, size_t row)
+{
+	const size_t i = s->unhidden_index[row];
+
+	if (i == SIZE_MAX) {
+		return;
+	}
+
+	struct node *last = s->unhidden[--s->num_unhidden];
+	s->unhidden[i] = last;
+	s->unhidden_index[last->row] = i;
+	s->unhidden_index[row] = SIZE_MAX;
+}
@@ -1,9 +1,70 @@
+#define _POSIX_C_SOURCE 200809L
+
 #include "dlx_iterative_solver.h"
 
+#include "budget_struct.h"
 #include "dlx_dance.h"
 #include "matrix_query.h"
 
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#define CHECKPOINT_MAGIC "DLXC"
+#define CHECKPOINT_BYTE_ORDER_MARK 0x01020304u
+#define CHECKPOINT_VERSION 1
+
+/**
+ * How many nodes a search in a portfolio visits between checks whether
+ * another search has already found a solution.
+ */
+#define PORTFOLIO_POLL_INTERVAL 1024
+
+/**
+ * State shared by the searches of a portfolio.
+ */
+struct portfolio {
+	pthread_mutex_t lock;
+	bool done;            /* A solution was found, the other searches stop. */
+	const void **solution;
+	size_t num_rows;
+};
+
+/**
+ * One search of a portfolio.
+ */
+struct portfolio_search {
+	struct portfolio *portfolio;
+	struct dlx_matrix *matrix; /* Private clone, or the caller's matrix. */
+	uint64_t random_state;
+	pthread_t thread;
+};
+
+/**
+ * The fixed size part at the start of every checkpoint file, see
+ * dlx_iterative_solver_save.
+ */
+struct checkpoint_header {
+	char magic[4];
+	uint32_t byte_order;
+	uint32_t version;
+	uint32_t explored;
+	uint64_t primary_cols;
+	uint64_t secondary_cols;
+	uint64_t num_rows;
+	uint64_t num_nodes;
+	uint64_t depth;
+};
+
 static bool dlx_iterative_solver_has_found_solution(const struct dlx_solver *);
+static bool dlx_iterative_solver_stopped(struct dlx_solver *);
+static bool dlx_iterative_solver_cancelled(struct dlx_solver *);
+static bool dlx_iterative_solver_out_of_budget(struct dlx_solver *);
+static void dlx_iterative_solver_capture(struct dlx_solver *, bool);
+static bool dlx_iterative_solver_resume(struct dlx_solver *);
+static bool dlx_iterative_solver_replay(struct dlx_solver *);
+static void *portfolio_search(void *);
 
 struct dlx_solver {
 	/**
@@ -33,10 +94,50 @@ struct dlx_solver {
 	 * call to dlx_iterative_solve_next).
 	 */
 	bool abort_search;
+
+	/**
+	 * State of the random number generator that breaks ties between
+	 * columns of the same size, 0 to always take the leftmost one.
+	 */
+	uint64_t random_state;
+
+	/**
+	 * The portfolio the search is part of, if any, and the steps taken
+	 * since last checking it.
+	 */
+	struct portfolio *portfolio;
+	unsigned int steps;
+
+	/**
+	 * Budget of every call to dlx_iterative_solver_find_solution, or 0.
+	 */
+	struct dlx_budget *budget;
+
+	/**
+	 * A position in the search: the indices of the rows on the path to
+	 * it and whether the search below it is done.  If pending, the next
+	 * call to dlx_iterative_solver_find_solution takes the search back
+	 * there first.  Room for max_node_stack_size rows.
+	 */
+	size_t *checkpoint;
+	size_t checkpoint_depth;
+	bool checkpoint_explored;
+	bool checkpoint_pending;
+
+	/**
+	 * Set when the search was taken back to a position that has yet to
+	 * be searched, so the next call mustn't move on from it the way it
+	 * does after a solution.
+	 */
+	bool paused;
 };
 
 struct dlx_solver *dlx_iterative_solver_create(struct dlx_matrix *mat)
 {
+	if (mat->multiplicities) {
+		return 0;
+	}
+
 	struct dlx_solver *const solver = calloc(1, sizeof(*solver));
 
 	if (solver == 0) {
@@ -59,8 +160,11 @@ struct dlx_solver *dlx_iterative_solver_create(struct dlx_matrix *mat)
 	 */
 	solver->max_node_stack_size = max_rows_in_solution + 1;
 	solver->stack = calloc(solver->max_node_stack_size, sizeof(*solver->stack));
+	solver->checkpoint = malloc(sizeof(*solver->checkpoint) * solver->max_node_stack_size);
 
-	if (solver->stack == 0) {
+	if (solver->stack == 0 || solver->checkpoint == 0) {
+		free(solver->stack);
+		free(solver->checkpoint);
 		free(solver);
 		return 0;
 	}
@@ -73,6 +177,9 @@ struct dlx_solver *dlx_iterative_solver_create(struct dlx_matrix *mat)
 
 void dlx_iterative_solver_reset(struct dlx_solver *solver)
 {
+	solver->checkpoint_pending = false;
+	solver->paused = false;
+
 	if (solver->depth > 0) {
 		solver->abort_search = true;
 		dlx_iterative_solver_find_solution(solver);
@@ -97,24 +204,49 @@ void dlx_iterative_solver_destroy(struct dlx_solver *solver)
 	dlx_iterative_solver_reset(solver);
 
 	free(solver->stack);
+	free(solver->checkpoint);
 	free(solver);
 }
 
+void dlx_iterative_solver_set_budget(struct dlx_solver *solver, struct dlx_budget *budget) { solver->budget = budget; }
+
 bool dlx_iterative_solver_find_solution(struct dlx_solver *solver)
 {
+	if (solver->checkpoint_pending && !dlx_iterative_solver_resume(solver)) {
+		return false;
+	}
+
+	if (solver->budget != 0 && !solver->abort_search) {
+		dlx_budget_begin(solver->budget);
+	}
+
 	/* If this is not the first solution */
-	if (solver->depth > 0) {
+	if (solver->paused) {
+		solver->paused = false;
+	} else if (solver->depth > 0) {
 		--solver->depth;
 	}
 
 	while (solver->depth >= 0) {
+		/* Only stop at a new node: nothing is covered at its level, so
+		 * unwinding starts from the level above like after a solution. */
+		if (solver->stack[solver->depth] == 0 && dlx_iterative_solver_stopped(solver)) {
+			return false;
+		}
+
 		if (solver->stack[solver->depth] == 0 && dlx_iterative_solver_has_found_solution(solver)) {
 			/* We have found a solution. */
 			return true;
 		} else if (solver->stack[solver->depth] == 0) {
 			/* No solution yet.  Cover a column. */
-			solver->stack[solver->depth] = (struct node *)dlx_matrix_query_smallest_column(solver->matrix);
-			dlx_dance_cover_column((struct header *)solver->stack[solver->depth]);
+			solver->stack[solver->depth] =
+			    (struct node *)(solver->random_state != 0
+						? dlx_matrix_query_smallest_column_random(solver->matrix, &solver->random_state)
+						: dlx_matrix_query_smallest_column(solver->matrix));
+			const size_t updates = dlx_dance_cover_column((struct header *)solver->stack[solver->depth]);
+			if (solver->budget != 0 && !solver->abort_search) {
+				dlx_budget_spend(solver->budget, 0, updates);
+			}
 		} else if (solver->stack[solver->depth]->down != (struct node *)solver->stack[solver->depth]->head) {
 			/**
 			 * We have covered a column but have not yet explored
@@ -133,7 +265,10 @@ bool dlx_iterative_solver_find_solution(struct dlx_solver *solver)
 
 			/* .. and then cover the next row down */
 			solver->stack[solver->depth] = solver->stack[solver->depth]->down;
-			dlx_dance_cover_all_columns_in_row(solver->stack[solver->depth]);
+			const size_t updates = dlx_dance_cover_all_columns_in_row(solver->stack[solver->depth]);
+			if (solver->budget != 0 && !solver->abort_search) {
+				dlx_budget_spend(solver->budget, 0, updates);
+			}
 
 			if (solver->abort_search) {
 				continue;
@@ -156,14 +291,330 @@ bool dlx_iterative_solver_find_solution(struct dlx_solver *solver)
 	return false;
 }
 
+bool dlx_iterative_solver_find_solution_portfolio(struct dlx_matrix *mat, size_t num_searches, unsigned int seed,
+						  const void **solution, size_t *num_rows)
+{
+	if (mat->multiplicities) {
+		return false;
+	}
+
+	if (num_searches == 0) {
+		const long online = sysconf(_SC_NPROCESSORS_ONLN);
+		num_searches = online > 0 ? (size_t)online : 1;
+	}
+
+	struct portfolio_search *searches = calloc(num_searches, sizeof(*searches));
+
+	if (searches == 0) {
+		return false;
+	}
+
+	struct portfolio portfolio = {.done = false, .solution = solution, .num_rows = 0};
+	pthread_mutex_init(&portfolio.lock, 0);
+
+	/*
+	 * The first search runs on the calling thread, in the usual order and
+	 * on the caller's matrix, so there is always at least one search.
+	 * The others each get a clone and their own seed, splitmix64 spreads
+	 * consecutive seeds over the state space.
+	 */
+	uint64_t splitmix = seed;
+	for (size_t i = 0; i < num_searches; ++i) {
+		struct portfolio_search *search = &searches[i];
+
+		search->portfolio = &portfolio;
+		if (i == 0) {
+			search->matrix = mat;
+			continue;
+		}
+
+		uint64_t z = (splitmix += UINT64_C(0x9e3779b97f4a7c15));
+		z = (z ^ (z >> 30)) * UINT64_C(0xbf58476d1ce4e5b9);
+		z = (z ^ (z >> 27)) * UINT64_C(0x94d049bb133111eb);
+		search->random_state = (z ^ (z >> 31)) | 1;
+
+		search->matrix = dlx_matrix_clone(mat);
+		if (search->matrix != 0 && pthread_create(&search->thread, 0, portfolio_search, search) != 0) {
+			dlx_matrix_destroy(search->matrix);
+			search->matrix = 0;
+		}
+	}
+
+	portfolio_search(&searches[0]);
+
+	for (size_t i = 1; i < num_searches; ++i) {
+		if (searches[i].matrix != 0) {
+			pthread_join(searches[i].thread, 0);
+			dlx_matrix_destroy(searches[i].matrix);
+		}
+	}
+
+	pthread_mutex_destroy(&portfolio.lock);
+	free(searches);
+
+	*num_rows = portfolio.num_rows;
+	return portfolio.done;
+}
+
+bool dlx_iterative_solver_save(struct dlx_solver *solver, const char *path)
+{
+	if (!solver->checkpoint_pending) {
+		dlx_iterative_solver_capture(solver, false);
+	}
+
+	const struct dlx_matrix *mat = solver->matrix;
+	const struct checkpoint_header header = {.magic = CHECKPOINT_MAGIC,
+						 .byte_order = CHECKPOINT_BYTE_ORDER_MARK,
+						 .version = CHECKPOINT_VERSION,
+						 .explored = solver->checkpoint_explored,
+						 .primary_cols = mat->primary_cols,
+						 .secondary_cols = mat->secondary_cols,
+						 .num_rows = mat->rows_in_mat,
+						 .num_nodes = mat->nodes_in_mat,
+						 .depth = solver->checkpoint_depth};
+
+	/* Write a new file and move it over the old one once it's complete. */
+	char *temporary = malloc(strlen(path) + sizeof(".tmp"));
+	if (temporary == 0) {
+		return false;
+	}
+	strcpy(temporary, path);
+	strcat(temporary, ".tmp");
+
+	FILE *f = fopen(temporary, "wb");
+	if (f == 0) {
+		free(temporary);
+		return false;
+	}
+
+	bool ok = fwrite(&header, sizeof(header), 1, f) == 1;
+	for (size_t i = 0; i < solver->checkpoint_depth && ok; ++i) {
+		const uint64_t row = solver->checkpoint[i];
+		ok = fwrite(&row, sizeof(row), 1, f) == 1;
+	}
+	ok = ok && fflush(f) == 0 && fsync(fileno(f)) == 0;
+	ok = fclose(f) == 0 && ok;
+	ok = ok && rename(temporary, path) == 0;
+
+	if (!ok) {
+		remove(temporary);
+	}
+	free(temporary);
+	return ok;
+}
+
+bool dlx_iterative_solver_load(struct dlx_solver *solver, const char *path)
+{
+	const struct dlx_matrix *mat = solver->matrix;
+
+	dlx_iterative_solver_reset(solver);
+
+	FILE *f = fopen(path, "rb");
+	if (f == 0) {
+		return false;
+	}
+
+	struct checkpoint_header header;
+	bool ok = fread(&header, sizeof(header), 1, f) == 1 &&
+		  memcmp(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic)) == 0 &&
+		  header.byte_order == CHECKPOINT_BYTE_ORDER_MARK && header.version == CHECKPOINT_VERSION &&
+		  header.explored <= 1 && header.primary_cols == mat->primary_cols &&
+		  header.secondary_cols == mat->secondary_cols && header.num_rows == mat->rows_in_mat &&
+		  header.num_nodes == mat->nodes_in_mat && header.depth < solver->max_node_stack_size;
+
+	for (size_t i = 0; ok && i < header.depth; ++i) {
+		uint64_t row;
+		ok = fread(&row, sizeof(row), 1, f) == 1 && row < mat->rows_in_mat;
+		solver->checkpoint[i] = (size_t)row;
+	}
+	fclose(f);
+
+	if (!ok) {
+		return false;
+	}
+
+	solver->checkpoint_depth = (size_t)header.depth;
+	solver->checkpoint_explored = header.explored != 0;
+	return dlx_iterative_solver_resume(solver);
+}
+
 size_t dlx_iterative_solver_num_solution_rows(struct dlx_solver *solver) { return (size_t)solver->depth; }
 
 const void *dlx_iterative_solver_get_solution_row(struct dlx_solver *solver, size_t index)
 {
-	return solver->stack[index]->user_data;
+	return solver->matrix->row_data[solver->stack[index]->row];
 }
 
 static bool dlx_iterative_solver_has_found_solution(const struct dlx_solver *solver)
 {
 	return dlx_matrix_is_empty(solver->matrix);
 }
+
+/**
+ * Does the search have to stop before visiting the next node?
+ */
+static bool dlx_iterative_solver_stopped(struct dlx_solver *solver)
+{
+	return (solver->portfolio != 0 && dlx_iterative_solver_cancelled(solver)) ||
+	       (solver->budget != 0 && dlx_iterative_solver_out_of_budget(solver));
+}
+
+/**
+ * Has another search of the portfolio found a solution?  Only actually
+ * checked every PORTFOLIO_POLL_INTERVAL nodes, and never while the
+ * search unwinds.
+ */
+static bool dlx_iterative_solver_cancelled(struct dlx_solver *solver)
+{
+	if (solver->abort_search || ++solver->steps < PORTFOLIO_POLL_INTERVAL) {
+		return false;
+	}
+	solver->steps = 0;
+
+	pthread_mutex_lock(&solver->portfolio->lock);
+	const bool done = solver->portfolio->done;
+	pthread_mutex_unlock(&solver->portfolio->lock);
+
+	return done;
+}
+
+/**
+ * Charge the budget for visiting the next node.  If the budget ran out,
+ * here or by the updates made since the last node, the matrix is
+ * unwound.  Never charged while the search unwinds.
+ *
+ * @return true if the search has to stop
+ */
+static bool dlx_iterative_solver_out_of_budget(struct dlx_solver *solver)
+{
+	if (solver->abort_search || !dlx_budget_spend(solver->budget, 1, 0)) {
+		return false;
+	}
+
+	/* Resume from here on the next call. */
+	dlx_iterative_solver_capture(solver, true);
+	dlx_iterative_solver_reset(solver);
+	solver->checkpoint_pending = true;
+	return true;
+}
+
+/**
+ * Store the position of the search as a checkpoint.
+ *
+ * Between calls the search is either where it found a solution, at a
+ * position it was taken back to but didn't search yet, at the start or
+ * done.  Inside a call (\c in_search) it's at a node it has yet to visit.
+ */
+static void dlx_iterative_solver_capture(struct dlx_solver *solver, bool in_search)
+{
+	if (solver->depth < 0) {
+		solver->checkpoint_depth = 0;
+		solver->checkpoint_explored = true;
+		return;
+	}
+
+	const size_t depth = (size_t)solver->depth;
+	const bool explored = !in_search && depth > 0 && !solver->paused;
+
+	for (size_t i = 0; i < depth; ++i) {
+		solver->checkpoint[i] = solver->stack[i]->row;
+	}
+	solver->checkpoint_depth = depth;
+	solver->checkpoint_explored = explored;
+}
+
+/**
+ * Take the search (which is at the start) back to the pending checkpoint.
+ *
+ * @return false if the checkpoint doesn't fit the matrix or memory could
+ *         not be allocated, the solver is reset then
+ */
+static bool dlx_iterative_solver_resume(struct dlx_solver *solver)
+{
+	solver->checkpoint_pending = false;
+
+	if (!dlx_iterative_solver_replay(solver)) {
+		dlx_iterative_solver_reset(solver);
+		return false;
+	}
+
+	if (solver->checkpoint_depth == 0 && solver->checkpoint_explored) {
+		/* The search is done. */
+		solver->depth = -1;
+	} else {
+		/* Either like right after a solution or at a new node. */
+		solver->paused = !solver->checkpoint_explored;
+	}
+
+	return true;
+}
+
+/**
+ * Choose the rows of the checkpoint the way the search does, leaving the
+ * search where it would be after finding a solution with those rows.
+ *
+ * @return false if a row of the checkpoint is not in the column the search
+ *         chooses, the search is left where it can be unwound from
+ */
+static bool dlx_iterative_solver_replay(struct dlx_solver *solver)
+{
+	for (size_t d = 0; d < solver->checkpoint_depth; ++d) {
+		if (dlx_matrix_is_empty(solver->matrix)) {
+			return false;
+		}
+
+		struct header *column = dlx_matrix_query_smallest_column(solver->matrix);
+		struct node *row = ((struct node *)column)->down;
+
+		while (row != (struct node *)column && row->row != solver->checkpoint[d]) {
+			row = row->down;
+		}
+		if (row == (struct node *)column) {
+			return false;
+		}
+
+		dlx_dance_cover_column(column);
+		dlx_dance_cover_all_columns_in_row(row);
+		solver->stack[d] = row;
+		solver->depth = (int)d + 1;
+		solver->stack[d + 1] = 0;
+	}
+
+	return true;
+}
+
+/**
+ * Run one search of a portfolio.  The first one to find a solution
+ * copies it out and stops the others.
+ */
+static void *portfolio_search(void *arg)
+{
+	struct portfolio_search *search = arg;
+	struct portfolio *portfolio = search->portfolio;
+	struct dlx_solver *solver = dlx_iterative_solver_create(search->matrix);
+
+	if (solver == 0) {
+		return 0;
+	}
+
+	solver->random_state = search->random_state;
+	solver->portfolio = portfolio;
+
+	if (dlx_iterative_solver_find_solution(solver)) {
+		pthread_mutex_lock(&portfolio->lock);
+		if (!portfolio->done) {
+			portfolio->done = true;
+			portfolio->num_rows = dlx_iterative_solver_num_solution_rows(solver);
+			for (size_t i = 0; i < portfolio->num_rows; ++i) {
+				portfolio->solution[i] = dlx_iterative_solver_get_solution_row(solver, i);
+			}
+		}
+		pthread_mutex_unlock(&portfolio->lock);
+	}
+
+	/* Unwinds the matrix, which matters for the caller's. */
+	solver->portfolio = 0;
+	dlx_iterative_solver_destroy(solver);
+
+	return 0;
+}
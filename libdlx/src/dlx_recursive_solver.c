@@ -1,27 +1,1231 @@
+#define _POSIX_C_SOURCE 200809L
+
 #include "dlx_recursive_solver.h"
 
+#include "bitset_matrix.h"
+#include "budget_struct.h"
+#include "cells_matrix.h"
 #include "dlx_dance.h"
 #include "matrix_query.h"
 
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/**
+ * Subtrees are only handed to other threads down to this depth.  Deeper
+ * than this they are small enough to not be worth the bookkeeping.
+ */
+#define MAX_SPLIT_DEPTH 8
+
+/**
+ * A subtree of the search: the nodes chosen on the path from the root.
+ * Nodes are identified by their index, which is the same in every copy of
+ * the matrix.
+ */
+struct task {
+	size_t depth;
+	size_t path[MAX_SPLIT_DEPTH];
+};
+
+/**
+ * A thread's tasks.  The owner pushes and pops at the bottom, other
+ * threads steal the oldest (and typically largest) subtrees from the top.
+ */
+struct deque {
+	pthread_mutex_t lock;
+	struct task *tasks;
+	size_t size;
+	size_t top;
+	size_t bottom;
+};
+
+struct worker {
+	struct parallel_count *pc;
+	struct dlx_matrix *matrix; /* Private clone. */
+	struct deque deque;
+	struct dlx_count solutions_found;
+	pthread_t thread;
+};
+
+struct parallel_count {
+	struct worker *workers;
+	size_t num_workers;
+
+	/* Protects the counters below, signalled when tasks are pushed or
+	   the last one is done. */
+	pthread_mutex_t lock;
+	pthread_cond_t changed;
+	size_t pending;     /* Tasks waiting in a deque. */
+	size_t outstanding; /* Tasks waiting or being worked on. */
+	size_t idle;        /* Threads waiting for a task. */
+};
+
+/**
+ * State of an enumeration, shared by all levels of the recursion.
+ */
+struct enumeration {
+	dlx_solution_callback callback;
+	void *ctx;
+	const struct dlx_matrix *matrix; /* Where the cells engine finds user_data. */
+	const void **rows;               /* user_data of the rows chosen so far. */
+	size_t depth;
+	size_t solutions_found;
+	bool stop;
+};
+
+/**
+ * State of dlx_recursive_solver_count_solutions_up_to, passed to
+ * keep_first_solution.
+ */
+struct limited_count {
+	size_t limit;
+	const void **solution;
+	size_t *num_rows;
+	size_t solutions_found;
+};
+
+/**
+ * State of dlx_recursive_solver_split, shared by all levels of the
+ * recursion.
+ */
+struct split {
+	dlx_subproblem_callback callback;
+	void *ctx;
+	size_t max_depth;
+	size_t *rows; /* Indices of the rows chosen so far. */
+	size_t depth;
+	bool stop;
+};
+
+/**
+ * State of a wide count, shared by all levels of the recursion.
+ */
+struct breakdown {
+	struct dlx_count total;
+	size_t depth;
+	size_t levels;             /* Branches are counted at depths below this. */
+	size_t num_rows;           /* Rows in the matrix. */
+	struct dlx_count *count;   /* Count under every row at every level, by row index. */
+	bool *chosen;              /* Whether every row was chosen at every level. */
+	struct dlx_budget *budget; /* Charged for every node and update, 0 for none. */
+};
+
+/**
+ * State of a search up to symmetry, shared by all levels of the
+ * recursion.  It counts the solutions if \c e is 0, and enumerates them
+ * otherwise.
+ */
+struct symmetric_search {
+	size_t stride;      /* Entries per generator in matrix->symmetries. */
+	size_t *parent;     /* Union-find forest over the rows. */
+	size_t *orbit_size; /* Rows of the column in the orbit of every root. */
+
+	struct enumeration *e;
+	dlx_weighted_solution_callback callback;
+	void *ctx;
+	size_t weight; /* Solutions the rows chosen so far stand for. */
+};
+
 /**
- * The algorithm below maps very closely to the approach described
- * by Knuth in doc/Donald E. Knuth - Dancing Links.pdf
+ * A row the search up to symmetry branches on, and the amount of rows of
+ * the column in its orbit.
  */
+struct orbit {
+	struct node *row;
+	size_t size;
+};
+
+static size_t count_solutions(struct dlx_matrix *, size_t);
+static size_t count_solutions_cells(struct dlx_cells_matrix *, size_t);
+static size_t count_solutions_bitset(struct dlx_bitset_matrix *, size_t);
+static size_t count_budget(struct dlx_matrix *, struct dlx_budget *, size_t);
+static size_t count_budget_cells(struct dlx_cells_matrix *, struct dlx_budget *, size_t);
+static void count_breakdown(struct dlx_matrix *, struct breakdown *);
+static void count_breakdown_cells(struct dlx_cells_matrix *, struct breakdown *);
+static void count_breakdown_bitset(struct dlx_bitset_matrix *, struct breakdown *);
+static void count_branch(struct breakdown *, size_t, struct dlx_count);
+static inline bool spend(struct breakdown *, unsigned int, size_t);
+static inline bool stopped(const struct breakdown *);
+static void count_multiplicities(struct dlx_matrix *, struct breakdown *);
+static void enumerate(struct dlx_matrix *, struct enumeration *);
+static void enumerate_cells(struct dlx_cells_matrix *, struct enumeration *);
+static void enumerate_bitset(struct dlx_bitset_matrix *, struct enumeration *);
+static struct dlx_bitset_matrix *create_bitset(const struct dlx_matrix *);
+static void enumerate_multiplicities(struct dlx_matrix *, struct enumeration *);
+static size_t *find_symmetries(const struct dlx_matrix *, size_t *);
+static struct dlx_count search_symmetric(struct dlx_matrix *, struct symmetric_search *, const size_t *, size_t);
+static struct dlx_count search_rest(struct dlx_matrix *, struct symmetric_search *);
+static size_t find_orbits(const struct dlx_matrix *, struct symmetric_search *, struct header *, const size_t *,
+			  size_t, struct orbit *);
+static size_t find_root(size_t *, size_t);
+static bool weigh_solution(const void *const *, size_t, void *);
+static bool keep_first_solution(const void *const *, size_t, void *);
+static void split(struct dlx_matrix *, struct split *);
+static bool create_workers(struct parallel_count *, struct dlx_matrix *);
+static void destroy_workers(struct parallel_count *);
+static void *work(void *);
+static bool take_task(struct worker *, struct task *);
+static void run_task(struct worker *, const struct task *);
+static void count_subtree(struct worker *, struct task *);
+static bool hungry(struct parallel_count *);
+static struct task *reserve_tasks(struct worker *, size_t);
+static void publish_tasks(struct worker *, size_t);
+
 size_t dlx_recursive_solver_count_solutions(struct dlx_matrix *matrix)
 {
+	if (matrix->multiplicities || matrix->num_symmetries > 0) {
+		return (size_t)dlx_recursive_solver_count_solutions_wide(matrix).low;
+	}
+
+	/* Without room for a copy the toroid is searched instead. */
+	struct dlx_cells_matrix *cells = matrix->engine == DLX_ENGINE_CELLS ? dlx_cells_matrix_create(matrix) : 0;
+
+	if (cells != 0) {
+		const size_t solutions_found = count_solutions_cells(cells, 0);
+		dlx_cells_matrix_destroy(cells);
+		return solutions_found;
+	}
+
+	struct dlx_bitset_matrix *cm = create_bitset(matrix);
+
+	if (cm != 0) {
+		const size_t solutions_found = count_solutions_bitset(cm, 0);
+		dlx_bitset_matrix_destroy(cm);
+		return solutions_found;
+	}
+
+	return count_solutions(matrix, 0);
+}
+
+size_t dlx_recursive_solver_count_solutions_budget(struct dlx_matrix *matrix, struct dlx_budget *budget)
+{
+	if (matrix->multiplicities) {
+		struct breakdown b = {{0, 0}, 0, 0, matrix->rows_in_mat, 0, 0, budget};
+
+		dlx_budget_begin(budget);
+		count_multiplicities(matrix, &b);
+		return (size_t)b.total.low;
+	}
+
+	struct dlx_cells_matrix *cells = matrix->engine == DLX_ENGINE_CELLS ? dlx_cells_matrix_create(matrix) : 0;
+
+	if (cells != 0) {
+		dlx_budget_begin(budget);
+		const size_t solutions_found = count_budget_cells(cells, budget, 0);
+		dlx_cells_matrix_destroy(cells);
+		return solutions_found;
+	}
+
+	dlx_budget_begin(budget);
+	return count_budget(matrix, budget, 0);
+}
+
+struct dlx_count dlx_recursive_solver_count_solutions_wide(struct dlx_matrix *matrix)
+{
+	struct dlx_count total = {0, 0};
+	size_t num_active = 0;
+	size_t *active = find_symmetries(matrix, &num_active);
+
+	if (num_active == 0) {
+		free(active);
+		dlx_recursive_solver_count_solutions_breakdown(matrix, 0, &total, 0, 0);
+		return total;
+	}
+
+	struct symmetric_search s = {0};
+	s.stride = matrix->rows_in_mat + matrix->primary_cols + matrix->secondary_cols;
+	s.weight = 1;
+	s.parent = malloc(sizeof(*s.parent) * (matrix->rows_in_mat + 1));
+	s.orbit_size = malloc(sizeof(*s.orbit_size) * (matrix->rows_in_mat + 1));
+
+	/* Without scratch space every row is an orbit of its own. */
+	total = search_symmetric(matrix, &s, active, s.parent != 0 && s.orbit_size != 0 ? num_active : 0);
+
+	free(s.parent);
+	free(s.orbit_size);
+	free(active);
+	return total;
+}
+
+bool dlx_recursive_solver_count_solutions_breakdown(struct dlx_matrix *matrix, size_t levels, struct dlx_count *total,
+						     struct dlx_branch_count **branches, size_t *num_branches)
+{
+	struct breakdown b = {{0, 0}, 0, levels, matrix->rows_in_mat, 0, 0, 0};
+
+	if (levels > 0) {
+		b.count = calloc(levels * b.num_rows, sizeof(*b.count));
+		b.chosen = calloc(levels * b.num_rows, sizeof(*b.chosen));
+
+		if (b.count == 0 || b.chosen == 0) {
+			free(b.count);
+			free(b.chosen);
+			return false;
+		}
+	}
+
+	struct dlx_cells_matrix *cells = 0;
+	struct dlx_bitset_matrix *bitset = 0;
+
+	if (matrix->multiplicities) {
+		count_multiplicities(matrix, &b);
+	} else if (matrix->engine == DLX_ENGINE_CELLS && (cells = dlx_cells_matrix_create(matrix)) != 0) {
+		count_breakdown_cells(cells, &b);
+		dlx_cells_matrix_destroy(cells);
+	} else if ((bitset = create_bitset(matrix)) != 0) {
+		count_breakdown_bitset(bitset, &b);
+		dlx_bitset_matrix_destroy(bitset);
+	} else {
+		count_breakdown(matrix, &b);
+	}
+
+	*total = b.total;
+
+	if (levels > 0) {
+		size_t n = 0;
+		for (size_t i = 0; i < levels * b.num_rows; ++i) {
+			n += b.chosen[i];
+		}
+
+		struct dlx_branch_count *result = malloc(sizeof(*result) * (n > 0 ? n : 1));
+		if (result == 0) {
+			free(b.count);
+			free(b.chosen);
+			return false;
+		}
+
+		n = 0;
+		for (size_t i = 0; i < levels * b.num_rows; ++i) {
+			if (b.chosen[i]) {
+				const struct dlx_branch_count branch = {i / b.num_rows, matrix->row_data[i % b.num_rows],
+									b.count[i]};
+				result[n++] = branch;
+			}
+		}
+
+		*branches = result;
+		*num_branches = n;
+	}
+
+	free(b.count);
+	free(b.chosen);
+	return true;
+}
+
+size_t dlx_recursive_solver_enumerate(struct dlx_matrix *matrix, dlx_solution_callback callback, void *ctx)
+{
+	/* Every row in a solution covers a different primary column, unless
+	   columns have multiplicities. */
+	struct enumeration e = {callback, ctx, matrix, 0, 0, 0, false};
+	e.rows = malloc(sizeof(*e.rows) * ((matrix->multiplicities ? matrix->rows_in_mat : matrix->primary_cols) + 1));
+
+	if (e.rows == 0) {
+		return 0;
+	}
+
+	struct dlx_cells_matrix *cells = 0;
+	struct dlx_bitset_matrix *bitset = 0;
+
+	if (matrix->multiplicities) {
+		enumerate_multiplicities(matrix, &e);
+	} else if (matrix->engine == DLX_ENGINE_CELLS && (cells = dlx_cells_matrix_create(matrix)) != 0) {
+		enumerate_cells(cells, &e);
+		dlx_cells_matrix_destroy(cells);
+	} else if ((bitset = create_bitset(matrix)) != 0) {
+		enumerate_bitset(bitset, &e);
+		dlx_bitset_matrix_destroy(bitset);
+	} else {
+		enumerate(matrix, &e);
+	}
+
+	free(e.rows);
+	return e.solutions_found;
+}
+
+size_t dlx_recursive_solver_enumerate_up_to_symmetry(struct dlx_matrix *matrix, dlx_weighted_solution_callback callback,
+						     void *ctx)
+{
+	struct enumeration e = {weigh_solution, 0, matrix, 0, 0, 0, false};
+	struct symmetric_search s = {0};
+	size_t num_active = 0;
+	size_t *active = find_symmetries(matrix, &num_active);
+
+	s.stride = matrix->rows_in_mat + matrix->primary_cols + matrix->secondary_cols;
+	s.e = &e;
+	s.callback = callback;
+	s.ctx = ctx;
+	s.weight = 1;
+	e.ctx = &s;
+	e.rows = malloc(sizeof(*e.rows) * ((matrix->multiplicities ? matrix->rows_in_mat : matrix->primary_cols) + 1));
+	s.parent = malloc(sizeof(*s.parent) * (matrix->rows_in_mat + 1));
+	s.orbit_size = malloc(sizeof(*s.orbit_size) * (matrix->rows_in_mat + 1));
+
+	if (e.rows != 0 && s.parent != 0 && s.orbit_size != 0) {
+		search_symmetric(matrix, &s, active, num_active);
+	}
+
+	free(e.rows);
+	free(s.parent);
+	free(s.orbit_size);
+	free(active);
+	return e.solutions_found;
+}
+
+size_t dlx_recursive_solver_count_solutions_up_to(struct dlx_matrix *matrix, size_t limit, const void **solution,
+						  size_t *num_rows)
+{
+	struct limited_count lc = {limit == 0 ? SIZE_MAX : limit, solution, num_rows, 0};
+
+	return dlx_recursive_solver_enumerate(matrix, keep_first_solution, &lc);
+}
+
+bool dlx_recursive_solver_is_unique(struct dlx_matrix *matrix, const void **solution, size_t *num_rows)
+{
+	return dlx_recursive_solver_count_solutions_up_to(matrix, 2, solution, num_rows) == 1;
+}
+
+bool dlx_recursive_solver_split(struct dlx_matrix *matrix, size_t depth, dlx_subproblem_callback callback, void *ctx)
+{
+	if (matrix->multiplicities) {
+		return false;
+	}
+
+	/* Every row chosen covers a different primary column. */
+	const size_t max_rows = depth < matrix->primary_cols ? depth : matrix->primary_cols;
+	struct split s = {callback, ctx, depth, 0, 0, false};
+	s.rows = malloc(sizeof(*s.rows) * (max_rows + 1));
+
+	if (s.rows == 0) {
+		return false;
+	}
+
+	split(matrix, &s);
+
+	free(s.rows);
+	return true;
+}
+
+bool dlx_recursive_solver_count_subproblem(struct dlx_matrix *matrix, const size_t *rows, size_t num_rows,
+					   struct dlx_count *count)
+{
+	if (matrix->multiplicities) {
+		return false;
+	}
+
+	struct node **path = malloc(sizeof(*path) * (num_rows + 1));
+
+	if (path == 0) {
+		return false;
+	}
+
+	/* Choose the rows, each from the column the search would cover. */
+	size_t depth = 0;
+	for (; depth < num_rows && !dlx_matrix_is_empty(matrix); ++depth) {
+		struct header *column = dlx_matrix_query_smallest_column(matrix);
+		struct node *vnode = ((struct node *)column)->down;
+
+		while (vnode != (struct node *)column && vnode->row != rows[depth]) {
+			vnode = vnode->down;
+		}
+		if (vnode == (struct node *)column) {
+			break;
+		}
+
+		dlx_dance_cover_column(column);
+		dlx_dance_cover_all_columns_in_row(vnode);
+		path[depth] = vnode;
+	}
+
+	/* The cells engine takes its copy of the matrix as it is now.  The
+	   symmetries are those of the whole matrix, not of the subproblem. */
+	const bool ok = depth == num_rows;
+	if (ok) {
+		*count = (struct dlx_count){0, 0};
+		dlx_recursive_solver_count_solutions_breakdown(matrix, 0, count, 0, 0);
+	}
+
+	while (depth-- > 0) {
+		dlx_dance_uncover_all_columns_in_row(path[depth]);
+		dlx_dance_uncover_column(path[depth]->head);
+	}
+
+	free(path);
+	return ok;
+}
+
+struct dlx_count dlx_recursive_solver_count_solutions_parallel(struct dlx_matrix *matrix, size_t num_threads)
+{
+	if (num_threads == 0) {
+		const long online = sysconf(_SC_NPROCESSORS_ONLN);
+		num_threads = online > 0 ? (size_t)online : 1;
+	}
+
+	struct parallel_count pc = {0};
+	pc.num_workers = num_threads;
+
+	/* The workers search without multiplicities. */
+	if (matrix->multiplicities || !create_workers(&pc, matrix)) {
+		return dlx_recursive_solver_count_solutions_wide(matrix);
+	}
+
+	/* The root of the search tree is the first task. */
+	struct worker *first = &pc.workers[0];
+	first->deque.tasks[first->deque.bottom++] = (struct task){0};
+	pc.pending = pc.outstanding = 1;
+
+	size_t started = 1;
+	for (; started < pc.num_workers; ++started) {
+		if (pthread_create(&pc.workers[started].thread, 0, work, &pc.workers[started]) != 0) {
+			break;
+		}
+	}
+	work(first);
+	for (size_t i = 1; i < started; ++i) {
+		pthread_join(pc.workers[i].thread, 0);
+	}
+
+	struct dlx_count solutions_found = {0, 0};
+	for (size_t i = 0; i < pc.num_workers; ++i) {
+		solutions_found = dlx_count_add(solutions_found, pc.workers[i].solutions_found);
+	}
+
+	destroy_workers(&pc);
+	return solutions_found;
+}
+
+/*
+ * The searches on the toroid.
+ */
+#define SEARCH(name) name
+#define SEARCH_MATRIX struct dlx_matrix
+#define SEARCH_COLUMN struct header *
+#define SEARCH_CURSOR struct node *
+#define SEARCH_IS_EMPTY(m, depth) dlx_matrix_is_empty(m)
+#define SEARCH_QUERY(m, depth) dlx_matrix_query_smallest_column(m)
+#define SEARCH_COVER(m, depth, column) dlx_dance_cover_column(column)
+#define SEARCH_UNCOVER(m, column) dlx_dance_uncover_column(column)
+#define SEARCH_FIRST(m, depth, column) (((struct node *)(column))->down)
+#define SEARCH_MORE(m, column, x) ((x) != (struct node *)(column))
+#define SEARCH_NEXT(m, depth, column, x) ((x)->down)
+#define SEARCH_CHOOSE(m, depth, x) dlx_dance_cover_all_columns_in_row(x)
+#define SEARCH_UNCHOOSE(m, x) dlx_dance_uncover_all_columns_in_row(x)
+#define SEARCH_ROW(m, x) ((x)->row)
+#define SEARCH_BUDGET
+#include "recursive_search.h"
+
+/*
+ * The searches on the cells engine, a row's place in a column is its
+ * position in the sparse set.
+ */
+#define SEARCH(name) name##_cells
+#define SEARCH_MATRIX struct dlx_cells_matrix
+#define SEARCH_COLUMN uint32_t
+#define SEARCH_CURSOR uint32_t
+#define SEARCH_IS_EMPTY(m, depth) dlx_cells_matrix_is_empty(m)
+#define SEARCH_QUERY(m, depth) dlx_cells_matrix_query_smallest_column(m)
+#define SEARCH_COVER(m, depth, column) dlx_cells_dance_cover_column(m, column)
+#define SEARCH_UNCOVER(m, column) dlx_cells_dance_uncover_column(m, column)
+#define SEARCH_FIRST(m, depth, column) dlx_cells_matrix_begin(m, column)
+#define SEARCH_MORE(m, column, x) ((x) < dlx_cells_matrix_end(m, column))
+#define SEARCH_NEXT(m, depth, column, x) ((x) + 1)
+#define SEARCH_CHOOSE(m, depth, x) dlx_cells_dance_cover_all_columns_in_row(m, (m)->set[x])
+#define SEARCH_UNCHOOSE(m, x) dlx_cells_dance_uncover_all_columns_in_row(m, (m)->set[x])
+#define SEARCH_ROW(m, x) dlx_cells_matrix_row(m, (m)->set[x])
+#define SEARCH_BUDGET
+#include "recursive_search.h"
+
+/*
+ * The searches on the bitset engine.  Choosing a row fills in the next
+ * level, which takes out its columns as well, and there is nothing to
+ * undo.  Budgets are only kept on the other engines.
+ */
+#define SEARCH(name) name##_bitset
+#define SEARCH_MATRIX struct dlx_bitset_matrix
+#define SEARCH_COLUMN uint32_t
+#define SEARCH_CURSOR uint32_t
+#define SEARCH_IS_EMPTY(m, depth) dlx_bitset_matrix_is_empty(m, depth)
+#define SEARCH_QUERY(m, depth) dlx_bitset_matrix_query_smallest_column(m, depth)
+#define SEARCH_COVER(m, depth, column) (void)0
+#define SEARCH_UNCOVER(m, column) (void)0
+#define SEARCH_FIRST(m, depth, column) dlx_bitset_matrix_next_row(m, depth, column, (m)->lo[column] * 64)
+#define SEARCH_MORE(m, column, x) ((x) < (m)->num_rows)
+#define SEARCH_NEXT(m, depth, column, x) dlx_bitset_matrix_next_row(m, depth, column, (x) + 1)
+#define SEARCH_CHOOSE(m, depth, x) dlx_bitset_dance_choose_row(m, depth, x)
+#define SEARCH_UNCHOOSE(m, x) (void)0
+#define SEARCH_ROW(m, x) ((m)->rows[x])
+#include "recursive_search.h"
+
+/**
+ * Record the solutions found since \c before under row \c row at the
+ * current depth.
+ */
+static void count_branch(struct breakdown *b, size_t row, struct dlx_count before)
+{
+	const size_t i = b->depth * b->num_rows + row;
+
+	b->count[i] = dlx_count_add(b->count[i], dlx_count_subtract(b->total, before));
+	b->chosen[i] = true;
+}
+
+/**
+ * Charge the budget of a count, if it has one.
+ *
+ * @return true if the count has to stop, see dlx_budget_spend
+ */
+static inline bool spend(struct breakdown *b, unsigned int nodes, size_t updates)
+{
+	return b->budget != 0 && dlx_budget_spend(b->budget, nodes, updates);
+}
+
+static inline bool stopped(const struct breakdown *b)
+{
+	return b->budget != 0 && b->budget->status != DLX_BUDGET_OK;
+}
+
+/**
+ * Same as count_breakdown, for a matrix with multiplicities (Knuth's
+ * Algorithm M).
+ *
+ * The column with the fewest branches is used once more.  If that covers
+ * it, which takes all of its rows out of the search, its rows are tried
+ * as usual.  Otherwise every row is tweaked before it's tried: taken out
+ * of the column and the search, so neither this nor any later choice in
+ * the subtree chooses it again, nor do the rows tried after it.  Rows are
+ * tried until there are too few left to reach the column's lower bound.
+ * Once that's been reached the column can also be left as it is, which
+ * takes it out of the list of columns.
+ *
+ * With a budget every node and update is charged to it, as in
+ * count_budget.
+ */
+static void count_multiplicities(struct dlx_matrix *matrix, struct breakdown *b)
+{
+	if (spend(b, 1, 0)) {
+		return;
+	}
+
+	if (dlx_matrix_is_empty(matrix)) {
+		b->total.high += ++b->total.low == 0;
+		return;
+	}
+
+	struct header *column = dlx_matrix_query_fewest_branches(matrix);
+	struct node *const first = ((struct node *)column)->down;
+	const size_t needed = column->bound > column->slack ? column->bound - column->slack : 0;
+
+	if (header_branches(column) == 0) {
+		return;
+	}
+
+	spend(b, 0, dlx_dance_use_column(column));
+	const bool covered = column->bound == 0;
+	for (struct node *vnode = first; vnode != (struct node *)column && column->size >= needed && !stopped(b);
+	     vnode = covered ? vnode->down : ((struct node *)column)->down) {
+		const struct dlx_count before = b->total;
+
+		if (!covered) {
+			spend(b, 0, dlx_dance_tweak(vnode));
+		}
+		spend(b, 0, dlx_dance_use_all_columns_in_row(vnode));
+		++b->depth;
+		count_multiplicities(matrix, b);
+		--b->depth;
+		dlx_dance_unuse_all_columns_in_row(vnode);
+
+		if (b->depth < b->levels) {
+			count_branch(b, vnode->row, before);
+		}
+	}
+
+	if (needed == 0 && !stopped(b)) {
+		/* All the rows are tweaked or hidden by now. */
+		if (!covered) {
+			spend(b, 0, dlx_dance_cover_column(column));
+		}
+		++b->depth;
+		count_multiplicities(matrix, b);
+		--b->depth;
+		if (!covered) {
+			dlx_dance_uncover_column(column);
+		}
+	}
+
+	if (!covered) {
+		dlx_dance_untweak(column, first);
+	}
+	dlx_dance_unuse_column(column);
+}
+
+/**
+ * Same as count_multiplicities, handing every solution to the callback.
+ */
+static void enumerate_multiplicities(struct dlx_matrix *matrix, struct enumeration *e)
+{
+	if (dlx_matrix_is_empty(matrix)) {
+		++e->solutions_found;
+		e->stop = !e->callback(e->rows, e->depth, e->ctx);
+		return;
+	}
+
+	struct header *column = dlx_matrix_query_fewest_branches(matrix);
+	struct node *const first = ((struct node *)column)->down;
+	const size_t needed = column->bound > column->slack ? column->bound - column->slack : 0;
+
+	if (header_branches(column) == 0) {
+		return;
+	}
+
+	dlx_dance_use_column(column);
+	const bool covered = column->bound == 0;
+	for (struct node *vnode = first; vnode != (struct node *)column && column->size >= needed && !e->stop;
+	     vnode = covered ? vnode->down : ((struct node *)column)->down) {
+		if (!covered) {
+			dlx_dance_tweak(vnode);
+		}
+		dlx_dance_use_all_columns_in_row(vnode);
+		e->rows[e->depth++] = matrix->row_data[vnode->row];
+		enumerate_multiplicities(matrix, e);
+		--e->depth;
+		dlx_dance_unuse_all_columns_in_row(vnode);
+	}
+
+	if (needed == 0 && !e->stop) {
+		if (!covered) {
+			dlx_dance_cover_column(column);
+		}
+		enumerate_multiplicities(matrix, e);
+		if (!covered) {
+			dlx_dance_uncover_column(column);
+		}
+	}
+
+	if (!covered) {
+		dlx_dance_untweak(column, first);
+	}
+	dlx_dance_unuse_column(column);
+}
+
+/**
+ * The generators of the symmetry group that map the matrix, as it is
+ * now, onto itself.  Hidden rows may break some of them.
+ *
+ * @return an array of their indices in matrix->symmetries, or 0 if there
+ *         are none, the matrix has multiplicities or memory could not be
+ *         allocated
+ */
+static size_t *find_symmetries(const struct dlx_matrix *matrix, size_t *num_active)
+{
+	const size_t stride = matrix->rows_in_mat + matrix->primary_cols + matrix->secondary_cols;
+
+	*num_active = 0;
+	if (matrix->multiplicities || matrix->num_symmetries == 0 || matrix->symmetry_rows != matrix->rows_in_mat) {
+		return 0;
+	}
+
+	size_t *active = malloc(sizeof(*active) * matrix->num_symmetries);
+
+	for (size_t g = 0; g < matrix->num_symmetries && active != 0; ++g) {
+		const size_t *symmetry = matrix->symmetries + g * stride;
+
+		if (dlx_matrix_is_symmetry(matrix, symmetry, symmetry + matrix->rows_in_mat)) {
+			active[(*num_active)++] = g;
+		}
+	}
+
+	return active;
+}
+
+/**
+ * Count or enumerate the solutions, see dlx_matrix_add_symmetry.
+ *
+ * \c active holds the generators that map every row chosen so far onto
+ * itself.  The search branches on the first row of every orbit of the
+ * rows of the column, and counts what it finds below it once for every
+ * row of the column in the orbit.  Once no generators are left, or none
+ * of them maps rows of the column onto one another, the rest of the
+ * search is the usual one.
+ */
+static struct dlx_count search_symmetric(struct dlx_matrix *matrix, struct symmetric_search *s, const size_t *active,
+					 size_t num_active)
+{
+	if (num_active == 0 || dlx_matrix_is_empty(matrix)) {
+		return search_rest(matrix, s);
+	}
+
+	struct header *column = dlx_matrix_query_smallest_column(matrix);
+	struct orbit *orbits = malloc(sizeof(*orbits) * (column->size + 1));
+	size_t *next = malloc(sizeof(*next) * num_active);
+	const size_t num_orbits = orbits != 0 && next != 0
+					  ? find_orbits(matrix, s, column, active, num_active, orbits)
+					  : column->size;
+
+	if (num_orbits == column->size) {
+		free(orbits);
+		free(next);
+		return search_rest(matrix, s);
+	}
+
+	struct dlx_count total = {0, 0};
+	const size_t weight = s->weight;
+
+	dlx_dance_cover_column(column);
+	for (size_t i = 0; i < num_orbits && (s->e == 0 || !s->e->stop); ++i) {
+		struct node *vnode = orbits[i].row;
+		size_t num_next = 0;
+
+		for (size_t g = 0; g < num_active; ++g) {
+			if (matrix->symmetries[active[g] * s->stride + vnode->row] == vnode->row) {
+				next[num_next++] = active[g];
+			}
+		}
+
+		dlx_dance_cover_all_columns_in_row(vnode);
+		if (s->e != 0) {
+			s->e->rows[s->e->depth++] = matrix->row_data[vnode->row];
+		}
+		s->weight = weight * orbits[i].size;
+		const struct dlx_count below = search_symmetric(matrix, s, next, num_next);
+		if (s->e != 0) {
+			--s->e->depth;
+		}
+		dlx_dance_uncover_all_columns_in_row(vnode);
+
+		for (size_t k = 0; k < orbits[i].size; ++k) {
+			total = dlx_count_add(total, below);
+		}
+	}
+	dlx_dance_uncover_column(column);
+
+	s->weight = weight;
+	free(orbits);
+	free(next);
+	return total;
+}
+
+/**
+ * Count or enumerate the solutions of what's left of the matrix, without
+ * symmetries.
+ */
+static struct dlx_count search_rest(struct dlx_matrix *matrix, struct symmetric_search *s)
+{
+	struct dlx_count total = {0, 0};
+
+	if (s->e == 0) {
+		dlx_recursive_solver_count_solutions_breakdown(matrix, 0, &total, 0, 0);
+	} else if (matrix->multiplicities) {
+		enumerate_multiplicities(matrix, s->e);
+	} else {
+		enumerate(matrix, s->e);
+	}
+
+	return total;
+}
+
+/**
+ * Find the orbits of the rows of \c column under the generators in
+ * \c active: the first row of every orbit in the column, and how many
+ * rows of the column the orbit holds.
+ *
+ * @return the amount of orbits
+ */
+static size_t find_orbits(const struct dlx_matrix *matrix, struct symmetric_search *s, struct header *column,
+			  const size_t *active, size_t num_active, struct orbit *orbits)
+{
+	for (size_t r = 0; r < matrix->rows_in_mat; ++r) {
+		s->parent[r] = r;
+	}
+
+	for (size_t g = 0; g < num_active; ++g) {
+		const size_t *symmetry = matrix->symmetries + active[g] * s->stride;
+
+		for (size_t r = 0; r < matrix->rows_in_mat; ++r) {
+			const size_t a = find_root(s->parent, r);
+			const size_t b = find_root(s->parent, symmetry[r]);
+
+			if (a < b) {
+				s->parent[b] = a;
+			} else {
+				s->parent[a] = b;
+			}
+		}
+	}
+
+	const struct node *const end = (const struct node *)column;
+	for (struct node *vnode = end->down; vnode != end; vnode = vnode->down) {
+		s->orbit_size[find_root(s->parent, vnode->row)] = 0;
+	}
+	for (struct node *vnode = end->down; vnode != end; vnode = vnode->down) {
+		++s->orbit_size[find_root(s->parent, vnode->row)];
+	}
+
+	size_t num_orbits = 0;
+	for (struct node *vnode = end->down; vnode != end; vnode = vnode->down) {
+		const size_t root = find_root(s->parent, vnode->row);
+
+		if (s->orbit_size[root] != 0) {
+			const struct orbit orbit = {vnode, s->orbit_size[root]};
+			orbits[num_orbits++] = orbit;
+			s->orbit_size[root] = 0;
+		}
+	}
+
+	return num_orbits;
+}
+
+/**
+ * Root of the tree of row \c r in the union-find forest, halving the
+ * path to it on the way.
+ */
+static size_t find_root(size_t *parent, size_t r)
+{
+	while (parent[r] != r) {
+		parent[r] = parent[parent[r]];
+		r = parent[r];
+	}
+
+	return r;
+}
+
+/**
+ * Callback of the enumeration below search_rest: hands the solution to
+ * the callback of dlx_recursive_solver_enumerate_up_to_symmetry, along
+ * with its weight.
+ */
+static bool weigh_solution(const void *const *rows, size_t num_rows, void *ctx)
+{
+	const struct symmetric_search *s = ctx;
+
+	return s->callback(rows, num_rows, s->weight, s->ctx);
+}
+
+/**
+ * A bitset copy of a matrix on the linked engine that has few enough
+ * columns, or 0 if it's searched on the toroid.
+ */
+static struct dlx_bitset_matrix *create_bitset(const struct dlx_matrix *matrix)
+{
+	if (matrix->engine != DLX_ENGINE_LINKED || matrix->primary_cols + matrix->secondary_cols > matrix->bitset_columns) {
+		return 0;
+	}
+
+	return dlx_bitset_matrix_create(matrix);
+}
+
+/**
+ * Callback of dlx_recursive_solver_count_solutions_up_to: copies out the
+ * first solution and stops the search at the limit.
+ */
+static bool keep_first_solution(const void *const *rows, size_t num_rows, void *ctx)
+{
+	struct limited_count *lc = ctx;
+
+	if (lc->solutions_found++ == 0) {
+		if (lc->solution != 0) {
+			memcpy(lc->solution, rows, sizeof(*rows) * num_rows);
+		}
+		if (lc->num_rows != 0) {
+			*lc->num_rows = num_rows;
+		}
+	}
+
+	return lc->solutions_found < lc->limit;
+}
+
+/**
+ * Same as count_solutions, handing every node at s->max_depth and every
+ * solution above it to the callback instead of searching below it.
+ */
+static void split(struct dlx_matrix *matrix, struct split *s)
+{
+	if (s->depth == s->max_depth || dlx_matrix_is_empty(matrix)) {
+		s->stop = !s->callback(s->rows, s->depth, s->ctx);
+		return;
+	}
+
+	struct header *column = dlx_matrix_query_smallest_column(matrix);
+	dlx_dance_cover_column(column);
+	for (struct node *vnode = ((struct node *)column)->down; vnode != (struct node *)column && !s->stop;
+	     vnode = vnode->down) {
+		dlx_dance_cover_all_columns_in_row(vnode);
+		s->rows[s->depth++] = vnode->row;
+		split(matrix, s);
+		--s->depth;
+		dlx_dance_uncover_all_columns_in_row(vnode);
+	}
+	dlx_dance_uncover_column(column);
+}
+
+/**
+ * Give every worker its own copy of the matrix and an empty deque.
+ *
+ * @return false if memory could not be allocated
+ */
+static bool create_workers(struct parallel_count *pc, struct dlx_matrix *matrix)
+{
+	pc->workers = calloc(pc->num_workers, sizeof(*pc->workers));
+
+	if (pc->workers == 0) {
+		return false;
+	}
+
+	pthread_mutex_init(&pc->lock, 0);
+	pthread_cond_init(&pc->changed, 0);
+
+	bool ok = true;
+	for (size_t i = 0; i < pc->num_workers; ++i) {
+		struct worker *w = &pc->workers[i];
+
+		w->pc = pc;
+		pthread_mutex_init(&w->deque.lock, 0);
+		w->deque.size = 64;
+		w->deque.tasks = malloc(sizeof(*w->deque.tasks) * w->deque.size);
+
+		w->matrix = dlx_matrix_clone(matrix);
+		ok = ok && w->deque.tasks != 0 && w->matrix != 0;
+	}
+
+	if (!ok) {
+		destroy_workers(pc);
+	}
+
+	return ok;
+}
+
+static void destroy_workers(struct parallel_count *pc)
+{
+	for (size_t i = 0; i < pc->num_workers; ++i) {
+		struct worker *w = &pc->workers[i];
+
+		if (w->matrix != 0) {
+			dlx_matrix_destroy(w->matrix);
+		}
+		free(w->deque.tasks);
+		pthread_mutex_destroy(&w->deque.lock);
+	}
+
+	pthread_cond_destroy(&pc->changed);
+	pthread_mutex_destroy(&pc->lock);
+	free(pc->workers);
+}
+
+/**
+ * Run tasks until every task of every worker is done.
+ */
+static void *work(void *arg)
+{
+	struct worker *w = arg;
+	struct parallel_count *pc = w->pc;
+	struct task task;
+
+	for (;;) {
+		if (take_task(w, &task)) {
+			run_task(w, &task);
+
+			pthread_mutex_lock(&pc->lock);
+			if (--pc->outstanding == 0) {
+				pthread_cond_broadcast(&pc->changed);
+			}
+			pthread_mutex_unlock(&pc->lock);
+			continue;
+		}
+
+		/* Nothing to take, wait for tasks to be pushed or for the
+		   last task to finish. */
+		pthread_mutex_lock(&pc->lock);
+		++pc->idle;
+		while (pc->pending == 0 && pc->outstanding > 0) {
+			pthread_cond_wait(&pc->changed, &pc->lock);
+		}
+		--pc->idle;
+		const bool done = pc->outstanding == 0;
+		pthread_mutex_unlock(&pc->lock);
+
+		if (done) {
+			return 0;
+		}
+	}
+}
+
+/**
+ * Pop a task from the worker's own deque or else steal one from the
+ * others.
+ *
+ * @return false if there was no task to take
+ */
+static bool take_task(struct worker *w, struct task *task)
+{
+	struct parallel_count *pc = w->pc;
+	bool found = false;
+
+	pthread_mutex_lock(&w->deque.lock);
+	if (w->deque.bottom > w->deque.top) {
+		*task = w->deque.tasks[--w->deque.bottom];
+		found = true;
+	}
+	pthread_mutex_unlock(&w->deque.lock);
+
+	const size_t self = (size_t)(w - pc->workers);
+	for (size_t i = 1; i < pc->num_workers && !found; ++i) {
+		struct deque *victim = &pc->workers[(self + i) % pc->num_workers].deque;
+
+		pthread_mutex_lock(&victim->lock);
+		if (victim->bottom > victim->top) {
+			*task = victim->tasks[victim->top++];
+			found = true;
+		}
+		pthread_mutex_unlock(&victim->lock);
+	}
+
+	if (found) {
+		pthread_mutex_lock(&pc->lock);
+		--pc->pending;
+		pthread_mutex_unlock(&pc->lock);
+	}
+
+	return found;
+}
+
+/**
+ * Descend into the subtree of a task and count its solutions.
+ */
+static void run_task(struct worker *w, const struct task *task)
+{
+	struct task path = *task;
+
+	for (size_t i = 0; i < task->depth; ++i) {
+		struct node *n = &w->matrix->node_pool[task->path[i]];
+		dlx_dance_cover_column(n->head);
+		dlx_dance_cover_all_columns_in_row(n);
+	}
+
+	count_subtree(w, &path);
+
+	for (size_t i = task->depth; i-- > 0;) {
+		struct node *n = &w->matrix->node_pool[task->path[i]];
+		dlx_dance_uncover_all_columns_in_row(n);
+		dlx_dance_uncover_column(n->head);
+	}
+}
+
+/**
+ * Same as count_breakdown, adding to the worker's count, except that near
+ * the root the rows that are yet to be tried are handed out as tasks
+ * whenever threads are idle.  \c path leads to the subtree the worker's
+ * matrix is at.
+ */
+static void count_subtree(struct worker *w, struct task *path)
+{
+	struct dlx_matrix *matrix = w->matrix;
+
+	if (path->depth == MAX_SPLIT_DEPTH) {
+		struct breakdown b = {w->solutions_found, 0, 0, matrix->rows_in_mat, 0, 0, 0};
+		count_breakdown(matrix, &b);
+		w->solutions_found = b.total;
+		return;
+	}
 	if (dlx_matrix_is_empty(matrix)) {
-		return 1;
+		w->solutions_found.high += ++w->solutions_found.low == 0;
+		return;
 	}
 
-	size_t solutions_found = 0;
 	struct header *column = dlx_matrix_query_smallest_column(matrix);
+	struct node *end = (struct node *)column;
 	dlx_dance_cover_column(column);
-	for (struct node *vnode = ((struct node *)column)->down; vnode != (struct node *)column; vnode = vnode->down) {
+	for (struct node *vnode = end->down; vnode != end; vnode = vnode->down) {
+		if (vnode->down != end && hungry(w->pc)) {
+			size_t num_tasks = 0;
+			for (struct node *n = vnode->down; n != end; n = n->down) {
+				++num_tasks;
+			}
+
+			struct task *tasks = reserve_tasks(w, num_tasks);
+			if (tasks != 0) {
+				for (struct node *n = vnode->down; n != end; n = n->down) {
+					*tasks = *path;
+					tasks->path[tasks->depth++] = (size_t)(n - matrix->node_pool);
+					++tasks;
+				}
+				publish_tasks(w, num_tasks);
+				end = vnode->down;
+			}
+		}
+
 		dlx_dance_cover_all_columns_in_row(vnode);
-		solutions_found += dlx_recursive_solver_count_solutions(matrix);
+		path->path[path->depth++] = (size_t)(vnode - matrix->node_pool);
+		count_subtree(w, path);
+		--path->depth;
 		dlx_dance_uncover_all_columns_in_row(vnode);
 	}
 	dlx_dance_uncover_column(column);
+}
 
-	return solutions_found;
+/**
+ * Are there more idle threads than tasks for them to take?
+ */
+static bool hungry(struct parallel_count *pc)
+{
+	pthread_mutex_lock(&pc->lock);
+	const bool result = pc->idle > pc->pending;
+	pthread_mutex_unlock(&pc->lock);
+
+	return result;
+}
+
+/**
+ * Make room for \c n tasks at the bottom of the worker's deque.  On
+ * success the deque stays locked until publish_tasks.
+ *
+ * @return where to write the tasks or 0 if the deque could not grow
+ */
+static struct task *reserve_tasks(struct worker *w, size_t n)
+{
+	struct deque *d = &w->deque;
+
+	pthread_mutex_lock(&d->lock);
+
+	/* Move the live tasks to the front before growing. */
+	if (d->bottom + n > d->size) {
+		memmove(d->tasks, d->tasks + d->top, sizeof(*d->tasks) * (d->bottom - d->top));
+		d->bottom -= d->top;
+		d->top = 0;
+	}
+	if (d->bottom + n > d->size) {
+		size_t new_size = d->size;
+		while (d->bottom + n > new_size) {
+			new_size *= 2;
+		}
+
+		struct task *tasks = realloc(d->tasks, sizeof(*d->tasks) * new_size);
+		if (tasks == 0) {
+			pthread_mutex_unlock(&d->lock);
+			return 0;
+		}
+		d->tasks = tasks;
+		d->size = new_size;
+	}
+
+	return &d->tasks[d->bottom];
+}
+
+/**
+ * Make the \c n tasks written after reserve_tasks available to all
+ * threads.
+ */
+static void publish_tasks(struct worker *w, size_t n)
+{
+	struct parallel_count *pc = w->pc;
+
+	w->deque.bottom += n;
+
+	/* The counters go up before any of the tasks can be taken. */
+	pthread_mutex_lock(&pc->lock);
+	pc->pending += n;
+	pc->outstanding += n;
+	pthread_cond_broadcast(&pc->changed);
+	pthread_mutex_unlock(&pc->lock);
+
+	pthread_mutex_unlock(&w->deque.lock);
 }
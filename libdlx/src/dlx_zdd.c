@@ -0,0 +1,414 @@
+#include "dlx_zdd.h"
+
+#include "dlx_dance.h"
+#include "matrix_query.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * The terminal nodes: no solutions, and the empty solution.
+ */
+#define ZDD_BOTTOM 0
+#define ZDD_TOP 1
+
+struct zdd_node {
+	const void *user_data; /**< The row. **/
+	size_t lo;             /**< The solutions that take a later row. **/
+	size_t hi;             /**< The solutions that take this row. **/
+};
+
+struct dlx_zdd {
+	struct zdd_node *nodes;   /**< By index, every node comes after its children. **/
+	size_t num_nodes;         /**< Including the terminal ones. **/
+	size_t nodes_size;        /**< Capacity of nodes. **/
+	struct dlx_count *counts; /**< Solutions below every node. **/
+	size_t root;
+	size_t num_primary;       /**< Bounds the amount of rows in a solution. **/
+};
+
+/**
+ * State of dlx_zdd_create, shared by all levels of the recursion.
+ *
+ * The cache maps the set of covered columns, \c num_words words, to the
+ * node for the subproblem plus 1 (0 for an empty entry).  The unique
+ * table holds every node but the terminal ones, plus 1, by its row and
+ * children, with open addressing.
+ */
+struct builder {
+	struct dlx_matrix *matrix;
+	struct dlx_zdd *zdd;
+
+	size_t num_words;
+	uint64_t *covered; /**< The columns covered so far. **/
+
+	size_t cache_entries;
+	uint64_t *cache_keys;
+	size_t *cache_nodes;
+
+	size_t unique_size; /**< A power of 2, at least twice the amount of nodes. **/
+	size_t *unique;
+
+	bool failed;
+};
+
+/**
+ * State of dlx_zdd_enumerate, shared by all levels of the recursion.
+ */
+struct walk {
+	dlx_solution_callback callback;
+	void *ctx;
+	const void **rows;
+	size_t depth;
+	size_t solutions_found;
+};
+
+static size_t search(struct builder *);
+static void choose_row(struct builder *, const struct node *, bool);
+static uint64_t hash_words(const uint64_t *, size_t);
+static uint64_t hash_node(const void *, size_t, size_t);
+static size_t make_node(struct builder *, const void *, size_t, size_t);
+static bool grow_unique(struct builder *);
+static bool walk(const struct dlx_zdd *, size_t, struct walk *);
+static inline bool count_less(struct dlx_count, struct dlx_count);
+
+struct dlx_zdd *dlx_zdd_create(struct dlx_matrix *matrix, size_t cache_bytes)
+{
+	if (matrix->colored || matrix->multiplicities) {
+		return 0;
+	}
+
+	struct builder b = {0};
+	b.matrix = matrix;
+	b.num_words = (matrix->primary_cols + matrix->secondary_cols) / 64 + 1;
+
+	const size_t entry_bytes = sizeof(*b.cache_keys) * b.num_words + sizeof(*b.cache_nodes);
+	b.cache_entries = (cache_bytes > 0 ? cache_bytes : DLX_ZDD_CACHE_BYTES) / entry_bytes;
+	if (b.cache_entries == 0) {
+		b.cache_entries = 1;
+	}
+	b.unique_size = 1024;
+
+	b.zdd = calloc(1, sizeof(*b.zdd));
+	b.covered = calloc(b.num_words, sizeof(*b.covered));
+	b.cache_keys = malloc(sizeof(*b.cache_keys) * b.num_words * b.cache_entries);
+	b.cache_nodes = calloc(b.cache_entries, sizeof(*b.cache_nodes));
+	b.unique = calloc(b.unique_size, sizeof(*b.unique));
+
+	struct dlx_zdd *zdd = b.zdd;
+
+	if (zdd != 0) {
+		zdd->nodes_size = 1024;
+		zdd->nodes = malloc(sizeof(*zdd->nodes) * zdd->nodes_size);
+		zdd->num_nodes = 2;
+		zdd->num_primary = matrix->primary_cols;
+	}
+
+	b.failed = zdd == 0 || zdd->nodes == 0 || b.covered == 0 || b.cache_keys == 0 || b.cache_nodes == 0 ||
+		   b.unique == 0;
+
+	if (!b.failed) {
+		zdd->root = search(&b);
+	}
+
+	if (!b.failed) {
+		zdd->counts = malloc(sizeof(*zdd->counts) * zdd->num_nodes);
+		b.failed = zdd->counts == 0;
+	}
+
+	/* Children come first, so one pass adds up the counts. */
+	if (!b.failed) {
+		const struct dlx_count none = {0, 0};
+		const struct dlx_count one = {1, 0};
+
+		zdd->counts[ZDD_BOTTOM] = none;
+		zdd->counts[ZDD_TOP] = one;
+		for (size_t i = 2; i < zdd->num_nodes; ++i) {
+			zdd->counts[i] = dlx_count_add(zdd->counts[zdd->nodes[i].lo], zdd->counts[zdd->nodes[i].hi]);
+		}
+	}
+
+	free(b.covered);
+	free(b.cache_keys);
+	free(b.cache_nodes);
+	free(b.unique);
+
+	if (b.failed && zdd != 0) {
+		dlx_zdd_destroy(zdd);
+		zdd = 0;
+	}
+
+	return zdd;
+}
+
+void dlx_zdd_destroy(struct dlx_zdd *zdd)
+{
+	free(zdd->nodes);
+	free(zdd->counts);
+	free(zdd);
+}
+
+size_t dlx_zdd_num_nodes(const struct dlx_zdd *zdd)
+{
+	return zdd->num_nodes - 2;
+}
+
+struct dlx_count dlx_zdd_count(const struct dlx_zdd *zdd)
+{
+	return zdd->counts[zdd->root];
+}
+
+/**
+ * Below every node the solutions that take its row come before the ones
+ * that take a later row, like in the search.
+ */
+bool dlx_zdd_get_solution(const struct dlx_zdd *zdd, struct dlx_count index, const void **solution, size_t *num_rows)
+{
+	if (!count_less(index, zdd->counts[zdd->root])) {
+		return false;
+	}
+
+	size_t n = 0;
+	for (size_t i = zdd->root; i != ZDD_TOP;) {
+		const struct zdd_node *node = &zdd->nodes[i];
+
+		if (count_less(index, zdd->counts[node->hi])) {
+			solution[n++] = node->user_data;
+			i = node->hi;
+		} else {
+			index = dlx_count_subtract(index, zdd->counts[node->hi]);
+			i = node->lo;
+		}
+	}
+
+	*num_rows = n;
+	return true;
+}
+
+/**
+ * Draws an index below the count, by rejection: a random number with as
+ * many bits as the count is below it at least half of the time.
+ */
+bool dlx_zdd_sample(const struct dlx_zdd *zdd, uint64_t *state, const void **solution, size_t *num_rows)
+{
+	const struct dlx_count count = zdd->counts[zdd->root];
+
+	if (count.low == 0 && count.high == 0) {
+		return false;
+	}
+
+	/* xorshift gets stuck at 0. */
+	if (*state == 0) {
+		*state = UINT64_C(0x9e3779b97f4a7c15);
+	}
+
+	uint64_t high_mask = count.high;
+	uint64_t low_mask = count.high != 0 ? UINT64_MAX : count.low;
+	for (unsigned shift = 1; shift < 64; shift *= 2) {
+		high_mask |= high_mask >> shift;
+		low_mask |= low_mask >> shift;
+	}
+
+	struct dlx_count index;
+	do {
+		index.low = dlx_random_next(state) & low_mask;
+		index.high = dlx_random_next(state) & high_mask;
+	} while (!count_less(index, count));
+
+	return dlx_zdd_get_solution(zdd, index, solution, num_rows);
+}
+
+size_t dlx_zdd_enumerate(const struct dlx_zdd *zdd, dlx_solution_callback callback, void *ctx)
+{
+	struct walk w = {callback, ctx, 0, 0, 0};
+	w.rows = malloc(sizeof(*w.rows) * (zdd->num_primary + 1));
+
+	if (w.rows == 0) {
+		return 0;
+	}
+
+	walk(zdd, zdd->root, &w);
+	free(w.rows);
+	return w.solutions_found;
+}
+
+/** Unexposed functions **/
+
+/**
+ * Build the node for the solutions of what's left of the matrix.
+ *
+ * The rows of the column are tried from the last one up, so that the
+ * node for the rows after a row is there by the time its node is made.
+ * Rows without solutions below them are left out of the diagram.
+ */
+static size_t search(struct builder *b)
+{
+	if (dlx_matrix_is_empty(b->matrix)) {
+		return ZDD_TOP;
+	}
+
+	const uint64_t hash = hash_words(b->covered, b->num_words);
+	const size_t entry = (size_t)(hash % b->cache_entries);
+	uint64_t *key = b->cache_keys + entry * b->num_words;
+
+	if (b->cache_nodes[entry] != 0 && memcmp(key, b->covered, sizeof(*key) * b->num_words) == 0) {
+		return b->cache_nodes[entry] - 1;
+	}
+
+	struct header *column = dlx_matrix_query_smallest_column(b->matrix);
+	struct node *const end = (struct node *)column;
+	size_t result = ZDD_BOTTOM;
+
+	dlx_dance_cover_column(column);
+	for (struct node *vnode = end->up; vnode != end && !b->failed; vnode = vnode->up) {
+		dlx_dance_cover_all_columns_in_row(vnode);
+		choose_row(b, vnode, true);
+		const size_t hi = search(b);
+		choose_row(b, vnode, false);
+		dlx_dance_uncover_all_columns_in_row(vnode);
+
+		if (hi != ZDD_BOTTOM) {
+			result = make_node(b, b->matrix->row_data[vnode->row], result, hi);
+		}
+	}
+	dlx_dance_uncover_column(column);
+
+	/* The search below may have taken the entry, the key is still the same. */
+	memcpy(key, b->covered, sizeof(*key) * b->num_words);
+	b->cache_nodes[entry] = result + 1;
+	return result;
+}
+
+/**
+ * Mark the columns of a row as covered, or as uncovered again.  The
+ * column the row was chosen from is one of them.
+ */
+static void choose_row(struct builder *b, const struct node *row, bool covered)
+{
+	const struct node *h = row;
+
+	do {
+		const size_t c = (size_t)(h->head - b->matrix->column_list);
+		const uint64_t bit = UINT64_C(1) << c % 64;
+
+		b->covered[c / 64] = covered ? b->covered[c / 64] | bit : b->covered[c / 64] & ~bit;
+		h = h->right;
+	} while (h != row);
+}
+
+static uint64_t hash_words(const uint64_t *words, size_t n)
+{
+	uint64_t hash = 0;
+
+	for (size_t i = 0; i < n; ++i) {
+		hash = (hash ^ words[i]) * UINT64_C(0x9e3779b97f4a7c15);
+		hash ^= hash >> 29;
+	}
+
+	return hash;
+}
+
+static uint64_t hash_node(const void *user_data, size_t lo, size_t hi)
+{
+	const uint64_t words[3] = {(uint64_t)(uintptr_t)user_data, lo, hi};
+
+	return hash_words(words, 3);
+}
+
+/**
+ * The node for a row and its children, made unless it exists already.
+ */
+static size_t make_node(struct builder *b, const void *user_data, size_t lo, size_t hi)
+{
+	struct dlx_zdd *zdd = b->zdd;
+
+	if (2 * zdd->num_nodes >= b->unique_size && !grow_unique(b)) {
+		b->failed = true;
+		return ZDD_BOTTOM;
+	}
+
+	size_t slot = (size_t)(hash_node(user_data, lo, hi) & (b->unique_size - 1));
+	for (; b->unique[slot] != 0; slot = (slot + 1) & (b->unique_size - 1)) {
+		const struct zdd_node *node = &zdd->nodes[b->unique[slot] - 1];
+
+		if (node->user_data == user_data && node->lo == lo && node->hi == hi) {
+			return b->unique[slot] - 1;
+		}
+	}
+
+	if (zdd->num_nodes == zdd->nodes_size) {
+		struct zdd_node *nodes = realloc(zdd->nodes, sizeof(*nodes) * 2 * zdd->nodes_size);
+
+		if (nodes == 0) {
+			b->failed = true;
+			return ZDD_BOTTOM;
+		}
+		zdd->nodes = nodes;
+		zdd->nodes_size *= 2;
+	}
+
+	const struct zdd_node node = {user_data, lo, hi};
+	zdd->nodes[zdd->num_nodes] = node;
+	b->unique[slot] = ++zdd->num_nodes;
+	return zdd->num_nodes - 1;
+}
+
+/**
+ * Double the unique table.
+ */
+static bool grow_unique(struct builder *b)
+{
+	const size_t size = 2 * b->unique_size;
+	size_t *unique = calloc(size, sizeof(*unique));
+
+	if (unique == 0) {
+		return false;
+	}
+
+	for (size_t i = 2; i < b->zdd->num_nodes; ++i) {
+		const struct zdd_node *node = &b->zdd->nodes[i];
+		size_t slot = (size_t)(hash_node(node->user_data, node->lo, node->hi) & (size - 1));
+
+		while (unique[slot] != 0) {
+			slot = (slot + 1) & (size - 1);
+		}
+		unique[slot] = i + 1;
+	}
+
+	free(b->unique);
+	b->unique = unique;
+	b->unique_size = size;
+	return true;
+}
+
+/**
+ * Hand every solution below node \c i to the callback, the ones that take
+ * a node's row first.  Following the \c lo children is a loop, so the
+ * recursion only goes as deep as a solution is long.
+ *
+ * @return false once the callback stopped the enumeration
+ */
+static bool walk(const struct dlx_zdd *zdd, size_t i, struct walk *w)
+{
+	for (; i != ZDD_BOTTOM; i = zdd->nodes[i].lo) {
+		if (i == ZDD_TOP) {
+			++w->solutions_found;
+			return w->callback(w->rows, w->depth, w->ctx);
+		}
+
+		w->rows[w->depth++] = zdd->nodes[i].user_data;
+		const bool go_on = walk(zdd, zdd->nodes[i].hi, w);
+		--w->depth;
+
+		if (!go_on) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static inline bool count_less(struct dlx_count a, struct dlx_count b)
+{
+	return a.high < b.high || (a.high == b.high && a.low < b.low);
+}
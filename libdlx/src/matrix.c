@@ -1,8 +1,26 @@
 #include "matrix.h"
+#include "column_buckets.h"
 #include "matrix_struct.h"
 
+#include <stdint.h>
+
+/**
+ * Size of the first slab of a growable matrix.  Every next slab is twice
+ * as large as the one before, up to GROWABLE_MAX_SLAB_SIZE nodes.
+ */
+#define GROWABLE_FIRST_SLAB_SIZE 256
+#define GROWABLE_MAX_SLAB_SIZE (1 << 20)
+
+static inline bool valid_color(const struct dlx_matrix *, size_t, uint32_t);
 static void init_header(struct header *);
-static void init_node(struct node *, const void *);
+static void init_node(struct node *, size_t);
+static bool reserve_row_data(struct dlx_matrix *, size_t);
+static bool add_colors(struct dlx_matrix *);
+static void free_colors(struct dlx_matrix *);
+static void attach_buckets(struct dlx_matrix *);
+static void point_headers(struct dlx_matrix *);
+static struct node *reserve_node(struct dlx_matrix *);
+static bool add_slab(struct dlx_matrix *, size_t);
 static void add_node_to_row(struct node *, struct node *);
 static void add_node_to_column(struct header *, struct node *);
 static void remove_node_from_column(struct node *);
@@ -20,25 +38,56 @@ struct dlx_matrix *dlx_matrix_create(size_t primary_columns, size_t secondary_co
 	}
 
 	mat->pool = malloc(col_bytes + node_bytes);
+	mat->slabs = malloc(sizeof(*mat->slabs) * 8);
 
-	if (mat->pool == 0) {
+	if (mat->pool == 0 || mat->slabs == 0) {
+		free(mat->pool);
+		free(mat->slabs);
 		free(mat);
 		return 0;
 	}
 
 	mat->primary_cols = primary_columns;
 	mat->secondary_cols = secondary_columns;
-	mat->node_pool_size = node_pool_size;
 	mat->column_list = mat->pool;
-	mat->node_pool = (struct node *)((struct header *)mat->pool + mat->primary_cols + mat->secondary_cols);
+	mat->bitset_columns = DLX_BITSET_COLUMNS;
+
+	mat->slabs_size = 8;
+	mat->num_slabs = 1;
+	mat->slabs[0].nodes = (struct node *)((struct header *)mat->pool + mat->primary_cols + mat->secondary_cols);
+	mat->slabs[0].colors = 0;
+	mat->slabs[0].size = node_pool_size;
+	mat->slabs[0].used = 0;
 
 	dlx_matrix_reset(mat);
 
 	return mat;
 }
 
+struct dlx_matrix *dlx_matrix_create_growable(size_t primary_columns, size_t secondary_columns)
+{
+	struct dlx_matrix *const mat = dlx_matrix_create(primary_columns, secondary_columns, GROWABLE_FIRST_SLAB_SIZE);
+
+	if (mat != 0) {
+		mat->growable = true;
+	}
+
+	return mat;
+}
+
 void dlx_matrix_destroy(struct dlx_matrix *mat)
 {
+	free_colors(mat);
+
+	/* The first slab is part of pool. */
+	for (size_t i = 1; i < mat->num_slabs; ++i) {
+		free(mat->slabs[i].nodes);
+	}
+
+	dlx_column_buckets_destroy(mat->buckets);
+	free(mat->slabs);
+	free(mat->row_data);
+	free(mat->symmetries);
 	free(mat->pool);
 	free(mat);
 }
@@ -46,9 +95,24 @@ void dlx_matrix_destroy(struct dlx_matrix *mat)
 void dlx_matrix_reset(struct dlx_matrix *mat)
 {
 	init_header(&mat->root);
+	free_colors(mat);
+	dlx_column_buckets_destroy(mat->buckets);
+	mat->buckets = 0;
 
+	/* Only keep the first slab. */
+	for (size_t i = 1; i < mat->num_slabs; ++i) {
+		free(mat->slabs[i].nodes);
+	}
+	mat->num_slabs = 1;
+	mat->node_pool = mat->slabs[0].nodes;
+	mat->node_pool_size = mat->slabs[0].size;
 	mat->node_pool_used = 0;
+	mat->nodes_in_mat = 0;
+	mat->last_node = 0;
 	mat->rows_in_mat = 0;
+	mat->colored = false;
+	mat->multiplicities = false;
+	mat->num_symmetries = 0;
 
 	/* First initialize all headers */
 	for (size_t i = 0; i < mat->primary_cols + mat->secondary_cols; ++i) {
@@ -68,31 +132,213 @@ void dlx_matrix_reset(struct dlx_matrix *mat)
 		add_node_to_row((struct node *)prev, (struct node *)cur);
 		prev = cur;
 	}
+
+	attach_buckets(mat);
 }
 
 struct node *dlx_matrix_begin_new_row(struct dlx_matrix *mat, const void *user_data)
 {
+	/* The first node of the row is handed out right away. */
+	struct node *const first = reserve_node(mat);
+
+	if (first == 0 || !reserve_row_data(mat, mat->rows_in_mat + 1)) {
+		return 0;
+	}
+
 	mat->start_new_row = true;
-	init_node(&mat->node_pool[mat->node_pool_used], user_data);
+	mat->row_data[mat->rows_in_mat] = user_data;
+	init_node(first, mat->rows_in_mat);
 	++mat->rows_in_mat;
-	return &mat->node_pool[mat->node_pool_used];
+	return first;
+}
+
+bool dlx_matrix_current_row_set_one(struct dlx_matrix *mat, size_t index)
+{
+	return dlx_matrix_current_row_set_colored_one(mat, index, 0);
 }
 
-void dlx_matrix_current_row_set_one(struct dlx_matrix *mat, size_t index)
+bool dlx_matrix_current_row_set_colored_one(struct dlx_matrix *mat, size_t index, uint32_t color)
 {
-	add_node_to_column(&mat->column_list[index], &mat->node_pool[mat->node_pool_used]);
+	if (index >= mat->primary_cols + mat->secondary_cols || !valid_color(mat, index, color)) {
+		return false;
+	}
+
+	struct node *const n = reserve_node(mat);
+
+	if (n == 0 || (color != 0 && !add_colors(mat))) {
+		return false;
+	}
+
+	/* The node is the next one of the current slab. */
+	if (color != 0) {
+		mat->slabs[mat->num_slabs - 1].colors[mat->node_pool_used] = (int32_t)color;
+	}
+
+	add_node_to_column(&mat->column_list[index], n);
 
 	/* If this is not the first node of a new row,
 	   tie it to its predecessor */
 	if (!mat->start_new_row) {
-		add_node_to_row(&mat->node_pool[mat->node_pool_used - 1], &mat->node_pool[mat->node_pool_used]);
-		mat->node_pool[mat->node_pool_used].user_data = mat->node_pool[mat->node_pool_used - 1].user_data;
+		add_node_to_row(mat->last_node, n);
+		n->row = mat->last_node->row;
 	}
 
+	mat->last_node = n;
 	mat->node_pool_used++;
+	mat->nodes_in_mat++;
+	mat->start_new_row = false;
+	return true;
+}
+
+bool dlx_matrix_add_rows(struct dlx_matrix *mat, size_t num_rows, const size_t *row_offsets,
+			 const size_t *column_indices, const void *const *user_data, struct node **first_nodes)
+{
+	return dlx_matrix_add_colored_rows(mat, num_rows, row_offsets, column_indices, 0, user_data, first_nodes);
+}
+
+bool dlx_matrix_add_colored_rows(struct dlx_matrix *mat, size_t num_rows, const size_t *row_offsets,
+				 const size_t *column_indices, const uint32_t *colors, const void *const *user_data,
+				 struct node **first_nodes)
+{
+	const struct csr_rows rows = {num_rows,   row_offsets, CSR_SIZE_T, column_indices,
+				      CSR_SIZE_T, user_data,   0,          colors};
+
+	return dlx_matrix_add_csr_rows(mat, &rows, first_nodes);
+}
+
+bool dlx_matrix_add_csr_rows(struct dlx_matrix *mat, const struct csr_rows *rows, struct node **first_nodes)
+{
+	const size_t num_cols = mat->primary_cols + mat->secondary_cols;
+	const size_t num_rows = rows->num_rows;
+	const size_t first_offset = csr_index(rows->offsets, rows->offset_type, 0);
+	const size_t last_offset = csr_index(rows->offsets, rows->offset_type, num_rows);
+
+	/* Validate everything before the matrix is touched. */
+	for (size_t i = 0; i < num_rows; ++i) {
+		if (csr_index(rows->offsets, rows->offset_type, i) > csr_index(rows->offsets, rows->offset_type, i + 1)) {
+			return false;
+		}
+	}
+	for (size_t k = first_offset; k < last_offset; ++k) {
+		const size_t column = csr_index(rows->columns, rows->column_type, k);
+		if (column >= num_cols || (rows->colors != 0 && !valid_color(mat, column, rows->colors[k]))) {
+			return false;
+		}
+	}
+
+	const size_t num_nodes = last_offset - first_offset;
+
+	if (!reserve_row_data(mat, mat->rows_in_mat + num_rows)) {
+		return false;
+	}
+
+	/* All the new nodes go into one slab. */
+	if (mat->node_pool_size - mat->node_pool_used < num_nodes) {
+		if (!mat->growable || !add_slab(mat, num_nodes)) {
+			return false;
+		}
+	}
+
+	/* The colors are the last thing that can fail. */
+	bool colored = false;
+	for (size_t k = first_offset; k < last_offset && rows->colors != 0 && !colored; ++k) {
+		colored = rows->colors[k] != 0;
+	}
+	if (colored && !add_colors(mat)) {
+		return false;
+	}
+
+	struct node *const nodes = &mat->node_pool[mat->node_pool_used];
+
+	if (colored) {
+		int32_t *colors = &mat->slabs[mat->num_slabs - 1].colors[mat->node_pool_used];
+		for (size_t k = first_offset; k < last_offset; ++k) {
+			colors[k - first_offset] = (int32_t)rows->colors[k];
+		}
+	}
+
+	/*
+	 * Link the rows.  The nodes of a row are adjacent so their left and
+	 * right links are known right away.  Every column's list is extended
+	 * downward as nodes come in, its header's \c up tracks the bottom,
+	 * and closed once all the nodes have been added.
+	 */
+	struct node *n = nodes;
+	for (size_t i = 0; i < num_rows; ++i) {
+		const size_t row = mat->rows_in_mat + i;
+		const size_t begin = csr_index(rows->offsets, rows->offset_type, i);
+		const size_t len = csr_index(rows->offsets, rows->offset_type, i + 1) - begin;
+
+		if (rows->user_data != 0) {
+			mat->row_data[row] = rows->user_data[i];
+		} else if (rows->row_ids != 0) {
+			mat->row_data[row] = (const void *)(uintptr_t)rows->row_ids[i];
+		} else {
+			mat->row_data[row] = (const void *)row;
+		}
+
+		if (first_nodes != 0) {
+			first_nodes[i] = len > 0 ? n : 0;
+		}
+
+		for (size_t j = 0; j < len; ++j, ++n) {
+			struct header *header = &mat->column_list[csr_index(rows->columns, rows->column_type, begin + j)];
+			struct node *bottom = header->node.up;
+
+			n->left = j > 0 ? n - 1 : n + len - 1;
+			n->right = j + 1 < len ? n + 1 : n - j;
+			n->up = bottom;
+			bottom->down = n;
+			header->node.up = n;
+			n->head = header;
+			n->row = (uint32_t)row;
+			++header->size;
+			if (header_buckets(header) != 0) {
+				column_buckets_resize(header, header->size - 1);
+			}
+		}
+	}
+
+	for (size_t c = 0; c < num_cols; ++c) {
+		struct node *header = &mat->column_list[c].node;
+		header->up->down = header;
+	}
+
+	if (num_nodes > 0) {
+		mat->last_node = n - 1;
+	}
+
 	mat->start_new_row = false;
+	mat->node_pool_used += num_nodes;
+	mat->nodes_in_mat += num_nodes;
+	mat->rows_in_mat += num_rows;
+	return true;
 }
 
+bool dlx_matrix_set_column_multiplicity(struct dlx_matrix *mat, size_t column, size_t lo, size_t hi)
+{
+	if (column >= mat->primary_cols || lo > hi || hi == 0) {
+		return false;
+	}
+
+	mat->column_list[column].bound = hi;
+	mat->column_list[column].slack = hi - lo;
+	mat->multiplicities |= lo != 1 || hi != 1;
+	return true;
+}
+
+void dlx_matrix_set_engine(struct dlx_matrix *mat, enum dlx_engine engine) { mat->engine = engine; }
+
+void dlx_matrix_set_column_selection(struct dlx_matrix *mat, enum dlx_column_selection selection)
+{
+	mat->selection = selection;
+	attach_buckets(mat);
+}
+
+void dlx_matrix_set_bitset_columns(struct dlx_matrix *mat, size_t columns) { mat->bitset_columns = columns; }
+
+size_t dlx_matrix_num_primary_columns(const struct dlx_matrix *mat) { return mat->primary_cols; }
+
 void dlx_matrix_hide_row(struct node *first)
 {
 	struct node *n = first;
@@ -113,18 +359,183 @@ void dlx_matrix_unhide_row(struct node *first)
 
 /** Unexposed functions **/
 
+/**
+ * Only ones in secondary columns can have a color.
+ */
+static inline bool valid_color(const struct dlx_matrix *mat, size_t column, uint32_t color)
+{
+	return color == 0 || (column >= mat->primary_cols && color <= DLX_MAX_COLOR);
+}
+
 static void init_header(struct header *header)
 {
 	init_node((struct node *)header, 0);
 	header->size = 0;
+	header->bound = 1;
+	header->slack = 0;
+	header->matrix = 0;
 	((struct node *)header)->head = header;
 }
 
-static void init_node(struct node *n, const void *user_data)
+static void init_node(struct node *n, size_t row)
 {
 	n->up = n->down = n->left = n->right = n;
 	n->head = 0;
-	n->user_data = user_data;
+	n->row = (uint32_t)row;
+}
+
+/**
+ * Make sure row_data can hold at least \c rows entries, the table is
+ * grown geometrically.  There can't be more than DLX_MAX_ROWS rows.
+ */
+static bool reserve_row_data(struct dlx_matrix *mat, size_t rows)
+{
+	if (rows > DLX_MAX_ROWS) {
+		return false;
+	}
+	if (rows <= mat->row_data_size) {
+		return true;
+	}
+
+	size_t size = mat->row_data_size > 0 ? mat->row_data_size * 2 : 64;
+	while (size < rows) {
+		size *= 2;
+	}
+
+	const void **row_data = realloc(mat->row_data, sizeof(*row_data) * size);
+	if (row_data == 0) {
+		return false;
+	}
+
+	mat->row_data = row_data;
+	mat->row_data_size = size;
+	return true;
+}
+
+/**
+ * Give every slab room for colors, unless the matrix has colors already,
+ * and point the headers at the matrix (see struct header).  If that fails the
+ * matrix is left without any.
+ */
+static bool add_colors(struct dlx_matrix *mat)
+{
+	if (mat->colored) {
+		return true;
+	}
+
+	for (size_t s = 0; s < mat->num_slabs; ++s) {
+		mat->slabs[s].colors = calloc(mat->slabs[s].size, sizeof(*mat->slabs[s].colors));
+		if (mat->slabs[s].colors == 0 && mat->slabs[s].size != 0) {
+			free_colors(mat);
+			return false;
+		}
+	}
+
+	mat->colored = true;
+	point_headers(mat);
+	return true;
+}
+
+static void free_colors(struct dlx_matrix *mat)
+{
+	for (size_t s = 0; s < mat->num_slabs; ++s) {
+		free(mat->slabs[s].colors);
+		mat->slabs[s].colors = 0;
+	}
+	mat->colored = false;
+	point_headers(mat);
+}
+
+/**
+ * Keep the uncovered primary columns in buckets from now on if the
+ * matrix has DLX_SELECTION_BUCKETS, and point the headers at the matrix
+ * (see struct header).  Without memory for them the columns are scanned.
+ */
+static void attach_buckets(struct dlx_matrix *mat)
+{
+	dlx_column_buckets_destroy(mat->buckets);
+	mat->buckets = mat->selection == DLX_SELECTION_BUCKETS ? dlx_column_buckets_create(mat) : 0;
+	point_headers(mat);
+}
+
+/**
+ * Point the headers at the matrix if it has colors or buckets, see
+ * struct header.
+ */
+static void point_headers(struct dlx_matrix *mat)
+{
+	const struct dlx_matrix *matrix = mat->colored || mat->buckets != 0 ? mat : 0;
+
+	for (size_t i = 0; i < mat->primary_cols + mat->secondary_cols; ++i) {
+		mat->column_list[i].matrix = matrix;
+	}
+}
+
+/**
+ * Returns the next free node in the pool, allocating a new slab if the
+ * matrix is growable and the current one is full.  Returns 0 if there
+ * are no free nodes left.
+ */
+static struct node *reserve_node(struct dlx_matrix *mat)
+{
+	if (mat->node_pool_used < mat->node_pool_size) {
+		return &mat->node_pool[mat->node_pool_used];
+	}
+
+	if (!mat->growable || !add_slab(mat, 1)) {
+		return 0;
+	}
+
+	return &mat->node_pool[0];
+}
+
+/**
+ * Start a new slab of at least \c min_size nodes and make it the current
+ * one.
+ */
+static bool add_slab(struct dlx_matrix *mat, size_t min_size)
+{
+	if (mat->num_slabs == mat->slabs_size) {
+		struct node_slab *slabs = realloc(mat->slabs, sizeof(*slabs) * mat->slabs_size * 2);
+		if (slabs == 0) {
+			return false;
+		}
+		mat->slabs = slabs;
+		mat->slabs_size *= 2;
+	}
+
+	size_t size = mat->node_pool_size * 2;
+	if (size < GROWABLE_FIRST_SLAB_SIZE) {
+		size = GROWABLE_FIRST_SLAB_SIZE;
+	} else if (size > GROWABLE_MAX_SLAB_SIZE) {
+		size = GROWABLE_MAX_SLAB_SIZE;
+	}
+	if (size < min_size) {
+		size = min_size;
+	}
+
+	struct node *nodes = malloc(sizeof(*nodes) * size);
+	int32_t *colors = mat->colored ? calloc(size, sizeof(*colors)) : 0;
+	if (nodes == 0 || (colors == 0 && mat->colored)) {
+		free(nodes);
+		free(colors);
+		return false;
+	}
+
+	/* Give up on the rest of the current slab. */
+	mat->slabs[mat->num_slabs - 1].used = mat->node_pool_used;
+
+	mat->slabs[mat->num_slabs].nodes = nodes;
+	mat->slabs[mat->num_slabs].colors = colors;
+	mat->slabs[mat->num_slabs].size = size;
+	mat->slabs[mat->num_slabs].used = 0;
+	++mat->num_slabs;
+
+	mat->node_pool = nodes;
+	mat->node_pool_size = size;
+	mat->node_pool_used = 0;
+
+	return true;
 }
 
 static void add_node_to_row(struct node *this, struct node *that)
@@ -139,6 +550,9 @@ static void add_node_to_column(struct header *header, struct node *that)
 {
 	struct node *this = (struct node *)header;
 	++header->size;
+	if (header_buckets(header) != 0) {
+		column_buckets_resize(header, header->size - 1);
+	}
 	that->head = header;
 
 	this->up->down = that;
@@ -152,4 +566,7 @@ static void remove_node_from_column(struct node *node)
 	node->up->down = node->down;
 	node->down->up = node->up;
 	--node->head->size;
+	if (header_buckets(node->head) != 0) {
+		column_buckets_resize(node->head, node->head->size + 1);
+	}
 }
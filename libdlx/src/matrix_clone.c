@@ -0,0 +1,176 @@
+#include "matrix.h"
+#include "matrix_struct.h"
+
+#include <stdint.h>
+#include <string.h>
+
+static inline struct node *rebase(const struct dlx_matrix *, struct dlx_matrix *, const size_t *, const struct node *,
+				  bool *);
+
+struct dlx_matrix *dlx_matrix_clone(const struct dlx_matrix *mat)
+{
+	const size_t num_cols = mat->primary_cols + mat->secondary_cols;
+
+	/* Nodes in use in every slab, the rest is up for grabs. */
+	size_t used = 0;
+	for (size_t s = 0; s + 1 < mat->num_slabs; ++s) {
+		used += mat->slabs[s].used;
+	}
+	used += mat->node_pool_used;
+
+	/* A fixed size matrix keeps its capacity, see dlx_matrix_finalize. */
+	const size_t capacity = mat->growable ? used : mat->slabs[0].size;
+
+	struct dlx_matrix *const clone = calloc(1, sizeof(*clone));
+	size_t *offsets = malloc(sizeof(*offsets) * mat->num_slabs);
+
+	if (clone == 0 || offsets == 0) {
+		free(clone);
+		free(offsets);
+		return 0;
+	}
+
+	const size_t bytes = sizeof(struct header) * num_cols + sizeof(struct node) * capacity;
+	clone->pool = malloc(bytes);
+	clone->slabs = malloc(sizeof(*clone->slabs) * 8);
+	int32_t *colors = mat->colored ? calloc(capacity, sizeof(*colors)) : 0;
+	clone->row_data = malloc(sizeof(*clone->row_data) * (mat->rows_in_mat + 1));
+
+	const size_t symmetry_size = (mat->symmetry_rows + num_cols) * mat->num_symmetries;
+	clone->symmetries = mat->num_symmetries > 0 ? malloc(sizeof(*clone->symmetries) * symmetry_size) : 0;
+
+	if ((clone->pool == 0 && bytes != 0) || clone->slabs == 0 || clone->row_data == 0 ||
+	    (clone->symmetries == 0 && mat->num_symmetries > 0) || (colors == 0 && mat->colored && capacity != 0)) {
+		free(colors);
+		free(clone->pool);
+		free(clone->slabs);
+		free(clone->row_data);
+		free(clone->symmetries);
+		free(clone);
+		free(offsets);
+		return 0;
+	}
+
+	clone->column_list = clone->pool;
+	clone->node_pool = (struct node *)(clone->column_list + num_cols);
+
+	/* The slabs end up back to back in the clone. */
+	memcpy(clone->column_list, mat->column_list, sizeof(struct header) * num_cols);
+	size_t offset = 0;
+	for (size_t s = 0; s < mat->num_slabs; ++s) {
+		const size_t in_slab = s + 1 == mat->num_slabs ? mat->node_pool_used : mat->slabs[s].used;
+		memcpy(clone->node_pool + offset, mat->slabs[s].nodes, sizeof(struct node) * in_slab);
+		if (colors != 0) {
+			memcpy(colors + offset, mat->slabs[s].colors, sizeof(*colors) * in_slab);
+		}
+		offsets[s] = offset;
+		offset += in_slab;
+	}
+
+	/* Now rebase all the pointers. */
+	bool ok = true;
+	for (size_t c = 0; c < num_cols; ++c) {
+		struct node *n = &clone->column_list[c].node;
+		n->up = rebase(mat, clone, offsets, n->up, &ok);
+		n->down = rebase(mat, clone, offsets, n->down, &ok);
+		n->left = rebase(mat, clone, offsets, n->left, &ok);
+		n->right = rebase(mat, clone, offsets, n->right, &ok);
+		n->head = &clone->column_list[c];
+		clone->column_list[c].matrix = mat->colored ? clone : 0;
+	}
+	for (size_t i = 0; i < used; ++i) {
+		struct node *n = &clone->node_pool[i];
+		n->up = rebase(mat, clone, offsets, n->up, &ok);
+		n->down = rebase(mat, clone, offsets, n->down, &ok);
+		n->left = rebase(mat, clone, offsets, n->left, &ok);
+		n->right = rebase(mat, clone, offsets, n->right, &ok);
+		n->head = clone->column_list + (n->head - mat->column_list);
+	}
+
+	struct node *root = &clone->root.node;
+	root->up = root->down = root;
+	root->left = rebase(mat, clone, offsets, mat->root.node.left, &ok);
+	root->right = rebase(mat, clone, offsets, mat->root.node.right, &ok);
+	root->head = &clone->root;
+	clone->root.size = 0;
+
+	clone->slabs_size = 8;
+	clone->num_slabs = 1;
+	clone->slabs[0].nodes = clone->node_pool;
+	clone->slabs[0].colors = colors;
+	clone->slabs[0].size = capacity;
+	clone->slabs[0].used = 0;
+	clone->node_pool_size = capacity;
+	clone->node_pool_used = used;
+	clone->growable = mat->growable;
+	clone->nodes_in_mat = mat->nodes_in_mat;
+	clone->last_node = mat->last_node != 0 ? rebase(mat, clone, offsets, mat->last_node, &ok) : 0;
+	clone->start_new_row = mat->start_new_row;
+
+	memcpy(clone->row_data, mat->row_data, sizeof(*clone->row_data) * mat->rows_in_mat);
+	clone->row_data_size = mat->rows_in_mat + 1;
+	clone->rows_in_mat = mat->rows_in_mat;
+	clone->colored = mat->colored;
+	clone->multiplicities = mat->multiplicities;
+
+	clone->primary_cols = mat->primary_cols;
+	clone->secondary_cols = mat->secondary_cols;
+	clone->engine = mat->engine;
+	clone->bitset_columns = mat->bitset_columns;
+
+	if (mat->num_symmetries > 0) {
+		memcpy(clone->symmetries, mat->symmetries, sizeof(*clone->symmetries) * symmetry_size);
+	}
+	clone->num_symmetries = mat->num_symmetries;
+	clone->symmetry_rows = mat->symmetry_rows;
+
+	free(offsets);
+
+	/* Either a link didn't point into mat or memory ran out. */
+	if (!ok) {
+		dlx_matrix_destroy(clone);
+		return 0;
+	}
+
+	dlx_matrix_set_column_selection(clone, mat->selection);
+
+	return clone;
+}
+
+/** Unexposed functions **/
+
+/**
+ * Translate a pointer into \c mat to the corresponding pointer into
+ * \c clone.  \c offsets holds the position of every slab of \c mat in
+ * the node_pool of \c clone.
+ *
+ * The first slab always directly follows the column headers in pool,
+ * so in the common case of a single slab this is a matter of adding
+ * the distance between the two pools.
+ *
+ * A pointer that's not into \c mat clears \c ok and comes out as 0.
+ */
+static inline struct node *rebase(const struct dlx_matrix *mat, struct dlx_matrix *clone, const size_t *offsets,
+				  const struct node *n, bool *ok)
+{
+	const uintptr_t p = (uintptr_t)n;
+	const uintptr_t pool = (uintptr_t)mat->column_list;
+
+	if (p >= pool && p < (uintptr_t)(mat->slabs[0].nodes + mat->slabs[0].size)) {
+		return (struct node *)((uintptr_t)clone->column_list + (p - pool));
+	}
+
+	if (n == &mat->root.node) {
+		return &clone->root.node;
+	}
+
+	for (size_t s = 1; s < mat->num_slabs; ++s) {
+		const uintptr_t nodes = (uintptr_t)mat->slabs[s].nodes;
+		if (p >= nodes && p < (uintptr_t)(mat->slabs[s].nodes + mat->slabs[s].size)) {
+			return &clone->node_pool[offsets[s] + (p - nodes) / sizeof(struct node)];
+		}
+	}
+
+	*ok = false;
+	return 0;
+}
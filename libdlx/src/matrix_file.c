@@ -0,0 +1,232 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "matrix_file.h"
+
+#include "matrix_struct.h"
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define MAGIC "DLXB"
+#define BYTE_ORDER_MARK 0x01020304u
+
+/**
+ * The fixed size part at the start of every matrix file.
+ */
+struct file_header {
+	char magic[4];
+	uint32_t byte_order;
+	uint32_t version;
+	uint32_t flags;
+	uint64_t primary_cols;
+	uint64_t secondary_cols;
+	uint64_t num_rows;
+	uint64_t num_nodes;
+};
+
+static struct dlx_matrix *load(const unsigned char *, size_t);
+static size_t nodes_in_slab(const struct dlx_matrix *, size_t);
+
+struct dlx_matrix *dlx_matrix_load(const char *path)
+{
+	const int fd = open(path, O_RDONLY);
+
+	if (fd < 0) {
+		return 0;
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || (uint64_t)st.st_size < sizeof(struct file_header) ||
+	    (uint64_t)st.st_size > SIZE_MAX) {
+		close(fd);
+		return 0;
+	}
+
+	const size_t size = (size_t)st.st_size;
+	void *data = mmap(0, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+
+	if (data == MAP_FAILED) {
+		return 0;
+	}
+
+	/* The rows are read front to back exactly once. */
+	posix_madvise(data, size, POSIX_MADV_SEQUENTIAL);
+
+	struct dlx_matrix *mat = load(data, size);
+
+	munmap(data, size);
+	return mat;
+}
+
+bool dlx_matrix_save(const struct dlx_matrix *mat, const char *path)
+{
+	const size_t num_cols = mat->primary_cols + mat->secondary_cols;
+
+	/* The file format has no room for multiplicities. */
+	if ((uint64_t)num_cols > UINT32_MAX || mat->multiplicities) {
+		return false;
+	}
+
+	uint64_t *column_counts = calloc(num_cols + 1, sizeof(*column_counts));
+	FILE *f = fopen(path, "wb");
+
+	if (column_counts == 0 || f == 0) {
+		free(column_counts);
+		if (f != 0) {
+			fclose(f);
+		}
+		return false;
+	}
+
+	/*
+	 * The nodes of a row are adjacent in the slabs (both when they are
+	 * added and after dlx_matrix_finalize), so a row ends where the row
+	 * index changes.  Walk the slabs once to count, then once for each
+	 * array that is written.
+	 */
+	const uint32_t flags = mat->colored ? DLX_MATRIX_FILE_COLORS : 0;
+	struct file_header header = {MAGIC, BYTE_ORDER_MARK, DLX_MATRIX_FILE_VERSION, flags, mat->primary_cols,
+				     mat->secondary_cols, 0, 0};
+	const struct node *prev = 0;
+	for (size_t s = 0; s < mat->num_slabs; ++s) {
+		for (size_t i = 0; i < nodes_in_slab(mat, s); ++i) {
+			const struct node *n = &mat->slabs[s].nodes[i];
+			header.num_rows += prev == 0 || prev->row != n->row;
+			++header.num_nodes;
+			++column_counts[n->head - mat->column_list];
+			prev = n;
+		}
+	}
+
+	bool ok = fwrite(&header, sizeof(header), 1, f) == 1;
+	ok = ok && fwrite(column_counts, sizeof(*column_counts), num_cols, f) == num_cols;
+
+	/* Row offsets. */
+	uint64_t offset = 0;
+	prev = 0;
+	for (size_t s = 0; s < mat->num_slabs && ok; ++s) {
+		for (size_t i = 0; i < nodes_in_slab(mat, s) && ok; ++i) {
+			const struct node *n = &mat->slabs[s].nodes[i];
+			if (prev == 0 || prev->row != n->row) {
+				ok = fwrite(&offset, sizeof(offset), 1, f) == 1;
+			}
+			++offset;
+			prev = n;
+		}
+	}
+	ok = ok && fwrite(&offset, sizeof(offset), 1, f) == 1;
+
+	/* Row ids. */
+	prev = 0;
+	for (size_t s = 0; s < mat->num_slabs && ok; ++s) {
+		for (size_t i = 0; i < nodes_in_slab(mat, s) && ok; ++i) {
+			const struct node *n = &mat->slabs[s].nodes[i];
+			if (prev == 0 || prev->row != n->row) {
+				const uint64_t id = (uintptr_t)mat->row_data[n->row];
+				ok = fwrite(&id, sizeof(id), 1, f) == 1;
+			}
+			prev = n;
+		}
+	}
+
+	/* Column indices. */
+	for (size_t s = 0; s < mat->num_slabs && ok; ++s) {
+		for (size_t i = 0; i < nodes_in_slab(mat, s) && ok; ++i) {
+			const uint32_t column = (uint32_t)(mat->slabs[s].nodes[i].head - mat->column_list);
+			ok = fwrite(&column, sizeof(column), 1, f) == 1;
+		}
+	}
+
+	/* Colors. */
+	for (size_t s = 0; s < mat->num_slabs && ok && mat->colored; ++s) {
+		for (size_t i = 0; i < nodes_in_slab(mat, s) && ok; ++i) {
+			const uint32_t color = (uint32_t)node_color(&mat->slabs[s].nodes[i]);
+			ok = fwrite(&color, sizeof(color), 1, f) == 1;
+		}
+	}
+
+	ok = fclose(f) == 0 && ok;
+	free(column_counts);
+	return ok;
+}
+
+/** Unexposed functions **/
+
+/**
+ * Build a matrix from the contents of a matrix file.
+ */
+static struct dlx_matrix *load(const unsigned char *data, size_t size)
+{
+	struct file_header header;
+	memcpy(&header, data, sizeof(header));
+
+	if (memcmp(header.magic, MAGIC, sizeof(header.magic)) != 0 || header.byte_order != BYTE_ORDER_MARK ||
+	    header.version != DLX_MATRIX_FILE_VERSION || (header.flags & ~(uint32_t)DLX_MATRIX_FILE_COLORS) != 0) {
+		return 0;
+	}
+
+	/* Bound every count by the file size before doing arithmetic with
+	   them, so that nothing can overflow. */
+	const uint64_t max_count = size / sizeof(uint32_t);
+	if (header.primary_cols > max_count || header.secondary_cols > max_count || header.num_rows > max_count ||
+	    header.num_nodes > max_count) {
+		return 0;
+	}
+
+	const uint64_t num_cols = header.primary_cols + header.secondary_cols;
+	const uint64_t num_arrays = (header.flags & DLX_MATRIX_FILE_COLORS) != 0 ? 2 : 1;
+	const uint64_t expected_size = sizeof(header) + sizeof(uint64_t) * (num_cols + 2 * header.num_rows + 1) +
+				       sizeof(uint32_t) * header.num_nodes * num_arrays;
+
+	if (expected_size != size) {
+		return 0;
+	}
+
+	const uint64_t *column_counts = (const uint64_t *)(data + sizeof(header));
+	const uint64_t *row_offsets = column_counts + num_cols;
+	const uint64_t *row_ids = row_offsets + header.num_rows + 1;
+	const uint32_t *column_indices = (const uint32_t *)(row_ids + header.num_rows);
+	const uint32_t *colors = num_arrays == 2 ? column_indices + header.num_nodes : 0;
+
+	if (row_offsets[0] != 0 || row_offsets[header.num_rows] != header.num_nodes) {
+		return 0;
+	}
+
+	struct dlx_matrix *mat = dlx_matrix_create(header.primary_cols, header.secondary_cols, header.num_nodes);
+
+	if (mat == 0) {
+		return 0;
+	}
+
+	const struct csr_rows rows = {header.num_rows, row_offsets, CSR_UINT64, column_indices,
+				      CSR_UINT32,      0,           row_ids,    colors};
+
+	if (!dlx_matrix_add_csr_rows(mat, &rows, 0)) {
+		dlx_matrix_destroy(mat);
+		return 0;
+	}
+
+	/* The column counts are redundant, they catch corrupt files. */
+	for (size_t c = 0; c < num_cols; ++c) {
+		if (mat->column_list[c].size != column_counts[c]) {
+			dlx_matrix_destroy(mat);
+			return 0;
+		}
+	}
+
+	return mat;
+}
+
+/**
+ * Amount of nodes in use in slab \c s.
+ */
+static size_t nodes_in_slab(const struct dlx_matrix *mat, size_t s)
+{
+	return s + 1 == mat->num_slabs ? mat->node_pool_used : mat->slabs[s].used;
+}
@@ -0,0 +1,164 @@
+#include "matrix.h"
+#include "column_buckets.h"
+#include "matrix_struct.h"
+
+/**
+ * While the nodes are being copied every old node's \c head points to
+ * its copy, FORWARD maps an old node (or header) to its copy.  The root
+ * isn't copied, its \c head points to itself.
+ */
+#define FORWARD(n) ((struct node *)(n)->head)
+
+static void copy_row(struct dlx_matrix *, struct node *, struct header *, struct node *, int32_t *, size_t *, bool *);
+
+bool dlx_matrix_finalize(struct dlx_matrix *mat, struct node **handles, size_t num_handles)
+{
+	const size_t num_cols = mat->primary_cols + mat->secondary_cols;
+
+	/* A fixed size matrix keeps its capacity, it may be reset and
+	   filled again. */
+	const size_t capacity = mat->growable ? mat->nodes_in_mat : mat->slabs[0].size;
+	const size_t bytes = sizeof(struct header) * num_cols + sizeof(struct node) * capacity;
+
+	void *pool = malloc(bytes);
+	bool *copied = calloc(mat->rows_in_mat + 1, sizeof(*copied));
+	int32_t *colors = mat->colored ? calloc(capacity, sizeof(*colors)) : 0;
+
+	if ((pool == 0 && bytes != 0) || copied == 0 || (colors == 0 && mat->colored && capacity != 0)) {
+		free(pool);
+		free(copied);
+		free(colors);
+		return false;
+	}
+
+	struct header *column_list = pool;
+	struct node *node_pool = (struct node *)(column_list + num_cols);
+	size_t used = 0;
+
+	/*
+	 * Copy the rows column by column: all the rows of the first column,
+	 * then the rows of the second column that haven't been copied yet,
+	 * and so on.  Rows that share a column end up close together, the
+	 * nodes of a row end up adjacent.  Hidden rows go last.
+	 *
+	 * Until the links are fixed up a copy's \c up points to the
+	 * original node.
+	 */
+	for (size_t c = 0; c < num_cols; ++c) {
+		struct node *header = (struct node *)&mat->column_list[c];
+		for (struct node *v = header->down; v != header; v = v->down) {
+			if (!copied[v->row]) {
+				copy_row(mat, v, column_list, node_pool, colors, &used, copied);
+			}
+		}
+	}
+
+	for (size_t s = 0; s < mat->num_slabs; ++s) {
+		const size_t in_slab = s + 1 == mat->num_slabs ? mat->node_pool_used : mat->slabs[s].used;
+		for (size_t i = 0; i < in_slab; ++i) {
+			struct node *n = &mat->slabs[s].nodes[i];
+			if (!copied[n->row]) {
+				copy_row(mat, n, column_list, node_pool, colors, &used, copied);
+			}
+		}
+	}
+
+	/* Make the old nodes and headers point to their copies.. */
+	for (size_t i = 0; i < used; ++i) {
+		node_pool[i].up->head = (struct header *)&node_pool[i];
+	}
+	for (size_t c = 0; c < num_cols; ++c) {
+		mat->column_list[c].node.head = &column_list[c];
+	}
+
+	/* .. so that the links can be translated. */
+	for (size_t i = 0; i < used; ++i) {
+		struct node *n = &node_pool[i];
+		const struct node *old = n->up;
+
+		n->left = FORWARD(old->left);
+		n->right = FORWARD(old->right);
+		n->down = FORWARD(old->down);
+		n->up = FORWARD(old->up);
+	}
+	for (size_t c = 0; c < num_cols; ++c) {
+		struct node *n = &column_list[c].node;
+		const struct node *old = &mat->column_list[c].node;
+
+		n->left = FORWARD(old->left);
+		n->right = FORWARD(old->right);
+		n->down = FORWARD(old->down);
+		n->up = FORWARD(old->up);
+		n->head = &column_list[c];
+		column_list[c].size = mat->column_list[c].size;
+		column_list[c].bound = mat->column_list[c].bound;
+		column_list[c].slack = mat->column_list[c].slack;
+		column_list[c].matrix = mat->column_list[c].matrix;
+	}
+
+	struct node *root = (struct node *)&mat->root;
+	root->left = FORWARD(root->left);
+	root->right = FORWARD(root->right);
+
+	for (size_t i = 0; i < num_handles; ++i) {
+		if (handles[i] != 0) {
+			handles[i] = FORWARD(handles[i]);
+		}
+	}
+
+	if (mat->last_node != 0) {
+		mat->last_node = FORWARD(mat->last_node);
+	}
+
+	/* Out with the old. */
+	for (size_t s = 0; s < mat->num_slabs; ++s) {
+		if (s > 0) {
+			free(mat->slabs[s].nodes);
+		}
+		free(mat->slabs[s].colors);
+	}
+	free(mat->pool);
+	free(copied);
+
+	mat->pool = pool;
+	mat->column_list = column_list;
+	if (mat->buckets != 0) {
+		mat->buckets->columns = column_list;
+	}
+	mat->num_slabs = 1;
+	mat->slabs[0].nodes = node_pool;
+	mat->slabs[0].colors = colors;
+	mat->slabs[0].size = capacity;
+	mat->slabs[0].used = 0;
+	mat->node_pool = node_pool;
+	mat->node_pool_size = capacity;
+	mat->node_pool_used = used;
+
+	return true;
+}
+
+/** Unexposed functions **/
+
+/**
+ * Append a copy of the row of \c v to \c node_pool, and its colors to
+ * \c colors if the matrix has any.  The copy starts at \c v, rows are
+ * circular so that doesn't change their order.
+ */
+static void copy_row(struct dlx_matrix *mat, struct node *v, struct header *column_list, struct node *node_pool,
+		     int32_t *colors, size_t *used, bool *copied)
+{
+	struct node *h = v;
+	do {
+		if (colors != 0) {
+			colors[*used] = node_color(h);
+		}
+
+		struct node *n = &node_pool[(*used)++];
+		n->up = h;
+		n->head = &column_list[h->head - mat->column_list];
+		n->row = h->row;
+		h = h->right;
+	} while (h != v);
+
+	copied[v->row] = true;
+}
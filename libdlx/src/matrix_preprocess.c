@@ -0,0 +1,492 @@
+#include "matrix.h"
+#include "matrix_struct.h"
+
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * The rows of the matrix in compressed sparse row format, and the same
+ * ones column by column, with what's left of them.
+ *
+ * Every row is in at least one primary column that's left: a row only
+ * loses a primary column when it's covered by a forced row, which takes
+ * the row out as well, or when the column is a copy of another one.
+ */
+struct reduction {
+	size_t num_rows;
+	size_t num_cols;
+	size_t primary_cols;
+
+	size_t *row_first;   /**< First one of every row in row_cols, and one past the last. **/
+	size_t *row_cols;    /**< Column of every one, row by row. **/
+	size_t *col_first;   /**< First one of every column in col_rows, and one past the last. **/
+	size_t *col_rows;    /**< Row of every one, column by column, in order. **/
+	int32_t *col_colors; /**< Color of every one, column by column. **/
+
+	bool *row_alive;
+	bool *row_forced;
+	bool *col_alive;
+	size_t *size; /**< Rows left in every column. **/
+
+	/* Scratch space for the checks, a mark is current if it equals stamp. */
+	size_t stamp;
+	size_t *row_mark;
+	size_t *col_mark;
+	size_t *count; /**< Rows counted in every column. **/
+};
+
+static void fill(struct reduction *, const struct dlx_matrix *, const struct node **, size_t *);
+static bool reduce(struct reduction *);
+static int32_t color_of(const struct reduction *, size_t, size_t);
+static bool conflict(const struct reduction *, size_t, int32_t, int32_t);
+static void remove_row(struct reduction *, size_t);
+static void force_row(struct reduction *, size_t);
+static bool is_useless(struct reduction *, size_t);
+static bool is_dominated(struct reduction *, size_t);
+static struct dlx_matrix *build(const struct dlx_matrix *, const struct reduction *, const size_t *, bool,
+				const void ***, size_t *, size_t **, size_t *);
+
+struct dlx_matrix *dlx_matrix_preprocess(const struct dlx_matrix *mat, const void ***forced, size_t *num_forced,
+					 size_t **rows, size_t *num_rows)
+{
+	const size_t num_cols = mat->primary_cols + mat->secondary_cols;
+	const struct node **row_node = calloc(mat->rows_in_mat + 1, sizeof(*row_node));
+	struct reduction r = {0};
+
+	if (row_node == 0) {
+		return 0;
+	}
+
+	r.num_cols = num_cols;
+	r.primary_cols = mat->primary_cols;
+
+	/* Hidden rows are in none of the columns, rows that are only in
+	   secondary columns can't be chosen. */
+	size_t num_ones = 0;
+	for (size_t c = 0; c < mat->primary_cols; ++c) {
+		const struct node *header = (const struct node *)&mat->column_list[c];
+
+		for (const struct node *v = header->down; v != header; v = v->down) {
+			if (row_node[v->row] == 0) {
+				row_node[v->row] = v;
+				++r.num_rows;
+				const struct node *h = v;
+				do {
+					++num_ones;
+					h = h->right;
+				} while (h != v);
+			}
+		}
+	}
+
+	size_t *row_index = malloc(sizeof(*row_index) * (r.num_rows + 1));
+	r.row_first = malloc(sizeof(*r.row_first) * (r.num_rows + 1));
+	r.row_cols = malloc(sizeof(*r.row_cols) * (num_ones + 1));
+	r.col_first = calloc(num_cols + 1, sizeof(*r.col_first));
+	r.col_rows = malloc(sizeof(*r.col_rows) * (num_ones + 1));
+	r.col_colors = malloc(sizeof(*r.col_colors) * (num_ones + 1));
+	r.row_alive = malloc(sizeof(*r.row_alive) * (r.num_rows + 1));
+	r.row_forced = calloc(r.num_rows + 1, sizeof(*r.row_forced));
+	r.col_alive = malloc(sizeof(*r.col_alive) * (num_cols + 1));
+	r.size = calloc(num_cols + 1, sizeof(*r.size));
+	r.row_mark = calloc(r.num_rows + 1, sizeof(*r.row_mark));
+	r.col_mark = calloc(num_cols + 1, sizeof(*r.col_mark));
+	r.count = malloc(sizeof(*r.count) * (num_cols + 1));
+
+	struct dlx_matrix *reduced = 0;
+
+	if (row_index != 0 && r.row_first != 0 && r.row_cols != 0 && r.col_first != 0 && r.col_rows != 0 &&
+	    r.col_colors != 0 && r.row_alive != 0 && r.row_forced != 0 && r.col_alive != 0 && r.size != 0 &&
+	    r.row_mark != 0 && r.col_mark != 0 && r.count != 0) {
+		fill(&r, mat, row_node, row_index);
+
+		/* Multiplicities allow a column to be covered more than once or
+		   not at all, none of the reductions hold then. */
+		const bool solvable = mat->multiplicities || reduce(&r);
+		reduced = build(mat, &r, row_index, solvable, forced, num_forced, rows, num_rows);
+	}
+
+	free(row_node);
+	free(row_index);
+	free(r.row_first);
+	free(r.row_cols);
+	free(r.col_first);
+	free(r.col_rows);
+	free(r.col_colors);
+	free(r.row_alive);
+	free(r.row_forced);
+	free(r.col_alive);
+	free(r.size);
+	free(r.row_mark);
+	free(r.col_mark);
+	free(r.count);
+	return reduced;
+}
+
+/** Unexposed functions **/
+
+/**
+ * Copy the rows found in the matrix, \c row_node holds a node of every
+ * one of them.
+ */
+static void fill(struct reduction *r, const struct dlx_matrix *mat, const struct node **row_node, size_t *row_index)
+{
+	/* The rows in order, then the columns.  Filling the columns row by
+	   row keeps their rows in order too. */
+	size_t k = 0;
+	for (size_t i = 0, row = 0; i < mat->rows_in_mat; ++i) {
+		if (row_node[i] == 0) {
+			continue;
+		}
+
+		const struct node *h = row_node[i];
+		row_index[row] = i;
+		r->row_first[row] = k;
+		do {
+			const size_t c = (size_t)(h->head - mat->column_list);
+			r->row_cols[k++] = c;
+			++r->col_first[c + 1];
+			h = h->right;
+		} while (h != row_node[i]);
+		r->row_alive[row++] = true;
+	}
+	r->row_first[r->num_rows] = k;
+
+	for (size_t c = 0; c < r->num_cols; ++c) {
+		r->size[c] = r->col_first[c + 1];
+		r->col_first[c + 1] += r->col_first[c];
+		r->col_alive[c] = c >= r->primary_cols || ((const struct node *)&mat->column_list[c])->left->right ==
+								  (const struct node *)&mat->column_list[c];
+	}
+
+	/* r->count is the next free spot of every column for now. */
+	memcpy(r->count, r->col_first, sizeof(*r->count) * r->num_cols);
+	for (size_t row = 0; row < r->num_rows; ++row) {
+		const struct node *h = row_node[row_index[row]];
+		do {
+			const size_t c = (size_t)(h->head - mat->column_list);
+			r->col_colors[r->count[c]] = node_color(h);
+			r->col_rows[r->count[c]++] = row;
+			h = h->right;
+		} while (h != row_node[row_index[row]]);
+	}
+}
+
+/**
+ * Apply the three reductions until none of them applies anymore.
+ *
+ * @return false if a primary column has no rows left, there are no
+ *         solutions then
+ */
+static bool reduce(struct reduction *r)
+{
+	bool changed = true;
+	while (changed) {
+		changed = false;
+
+		for (size_t c = 0; c < r->primary_cols; ++c) {
+			if (!r->col_alive[c] || r->size[c] > 1) {
+				continue;
+			}
+			if (r->size[c] == 0) {
+				return false;
+			}
+
+			for (size_t x = r->col_first[c]; x < r->col_first[c + 1]; ++x) {
+				if (r->row_alive[r->col_rows[x]]) {
+					force_row(r, r->col_rows[x]);
+					break;
+				}
+			}
+			changed = true;
+		}
+
+		for (size_t row = 0; row < r->num_rows; ++row) {
+			if (r->row_alive[row] && is_useless(r, row)) {
+				remove_row(r, row);
+				changed = true;
+			}
+		}
+
+		for (size_t c = 0; c < r->num_cols; ++c) {
+			if (r->col_alive[c] && is_dominated(r, c)) {
+				r->col_alive[c] = false;
+				changed = true;
+			}
+		}
+	}
+
+	return true;
+}
+
+/**
+ * Color of a row in one of its columns.  The rows of a column are in
+ * order, so it's a binary search.
+ */
+static int32_t color_of(const struct reduction *r, size_t row, size_t c)
+{
+	size_t lo = r->col_first[c];
+	size_t hi = r->col_first[c + 1];
+
+	while (hi - lo > 1) {
+		const size_t mid = lo + (hi - lo) / 2;
+		if (r->col_rows[mid] <= row) {
+			lo = mid;
+		} else {
+			hi = mid;
+		}
+	}
+
+	return r->col_colors[lo];
+}
+
+/**
+ * Whether two rows that both have column \c c, with colors \c a and \c b,
+ * can't be in the same solution.
+ */
+static bool conflict(const struct reduction *r, size_t c, int32_t a, int32_t b)
+{
+	return c < r->primary_cols || a == 0 || a != b;
+}
+
+static void remove_row(struct reduction *r, size_t row)
+{
+	r->row_alive[row] = false;
+	for (size_t k = r->row_first[row]; k < r->row_first[row + 1]; ++k) {
+		--r->size[r->row_cols[k]];
+	}
+}
+
+/**
+ * Put a row in every solution: take out every row that conflicts with it,
+ * and its columns.  The rows that are left in its secondary columns give
+ * them the same color as the row does, they can't conflict anymore.
+ */
+static void force_row(struct reduction *r, size_t row)
+{
+	for (size_t k = r->row_first[row]; k < r->row_first[row + 1]; ++k) {
+		const size_t c = r->row_cols[k];
+
+		if (!r->col_alive[c]) {
+			continue;
+		}
+		const int32_t color = c < r->primary_cols ? 0 : color_of(r, row, c);
+		for (size_t x = r->col_first[c]; x < r->col_first[c + 1]; ++x) {
+			const size_t other = r->col_rows[x];
+			if (r->row_alive[other] && other != row && conflict(r, c, color, r->col_colors[x])) {
+				remove_row(r, other);
+			}
+		}
+		r->col_alive[c] = false;
+	}
+
+	remove_row(r, row);
+	r->row_forced[row] = true;
+}
+
+/**
+ * Whether choosing a row takes out every row of some primary column it
+ * doesn't have, so that column can't be covered anymore.
+ *
+ * Counts, per primary column, the rows that conflict with the row.
+ */
+static bool is_useless(struct reduction *r, size_t row)
+{
+	const size_t stamp = ++r->stamp;
+
+	/* The row's own columns can be covered, by the row. */
+	for (size_t k = r->row_first[row]; k < r->row_first[row + 1]; ++k) {
+		r->col_mark[r->row_cols[k]] = stamp;
+		r->count[r->row_cols[k]] = SIZE_MAX;
+	}
+	r->row_mark[row] = stamp;
+
+	for (size_t k = r->row_first[row]; k < r->row_first[row + 1]; ++k) {
+		const size_t c = r->row_cols[k];
+
+		if (!r->col_alive[c]) {
+			continue;
+		}
+		const int32_t color = c < r->primary_cols ? 0 : color_of(r, row, c);
+
+		for (size_t x = r->col_first[c]; x < r->col_first[c + 1]; ++x) {
+			const size_t other = r->col_rows[x];
+
+			if (!r->row_alive[other] || r->row_mark[other] == stamp || !conflict(r, c, color, r->col_colors[x])) {
+				continue;
+			}
+			r->row_mark[other] = stamp;
+
+			for (size_t j = r->row_first[other]; j < r->row_first[other + 1]; ++j) {
+				const size_t d = r->row_cols[j];
+
+				if (d >= r->primary_cols || !r->col_alive[d]) {
+					continue;
+				}
+				if (r->col_mark[d] != stamp) {
+					r->col_mark[d] = stamp;
+					r->count[d] = 0;
+				}
+				if (r->count[d] != SIZE_MAX && ++r->count[d] == r->size[d]) {
+					return true;
+				}
+			}
+		}
+	}
+
+	return false;
+}
+
+/**
+ * Whether every row of a column is in some other primary column as well.
+ * That column is covered exactly once, so a secondary column is then
+ * covered at most once whatever the search does.  For a primary column
+ * to go both columns have to have the same rows, otherwise the rows of
+ * the other column that aren't in it are useless and will go first.  Of
+ * two such columns the one on the left stays, so that the search still
+ * branches on the same column.
+ */
+static bool is_dominated(struct reduction *r, size_t c)
+{
+	const size_t stamp = ++r->stamp;
+
+	if (r->size[c] == 0) {
+		return c >= r->primary_cols;
+	}
+
+	for (size_t x = r->col_first[c]; x < r->col_first[c + 1]; ++x) {
+		const size_t row = r->col_rows[x];
+
+		if (!r->row_alive[row]) {
+			continue;
+		}
+		for (size_t j = r->row_first[row]; j < r->row_first[row + 1]; ++j) {
+			const size_t d = r->row_cols[j];
+
+			if (d == c || d >= r->primary_cols || !r->col_alive[d]) {
+				continue;
+			}
+			if (r->col_mark[d] != stamp) {
+				r->col_mark[d] = stamp;
+				r->count[d] = 0;
+			}
+			if (++r->count[d] == r->size[c] && (c >= r->primary_cols || (r->size[d] == r->size[c] && d < c))) {
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+/**
+ * Build the reduced matrix out of the rows and columns that are left, and
+ * hand out the forced rows and the mapping of the rows.
+ */
+static struct dlx_matrix *build(const struct dlx_matrix *mat, const struct reduction *r, const size_t *row_index,
+				bool solvable, const void ***forced, size_t *num_forced, size_t **rows, size_t *num_rows)
+{
+	size_t *new_col = r->count;
+	size_t primary = 0;
+	size_t secondary = 0;
+
+	/* A matrix without solutions is reduced to a primary column without
+	   rows. */
+	for (size_t c = 0; c < r->num_cols; ++c) {
+		if (solvable && r->col_alive[c]) {
+			new_col[c] = c < r->primary_cols ? primary++ : secondary++;
+		}
+	}
+	for (size_t c = r->primary_cols; c < r->num_cols; ++c) {
+		if (solvable && r->col_alive[c]) {
+			new_col[c] += primary;
+		}
+	}
+	if (!solvable) {
+		primary = 1;
+	}
+
+	size_t kept_rows = 0;
+	size_t kept_ones = 0;
+	size_t forced_rows = 0;
+	for (size_t row = 0; row < r->num_rows; ++row) {
+		forced_rows += solvable && r->row_forced[row];
+		if (solvable && r->row_alive[row]) {
+			++kept_rows;
+			for (size_t k = r->row_first[row]; k < r->row_first[row + 1]; ++k) {
+				kept_ones += r->col_alive[r->row_cols[k]];
+			}
+		}
+	}
+
+	size_t *offsets = malloc(sizeof(*offsets) * (kept_rows + 1));
+	size_t *columns = malloc(sizeof(*columns) * (kept_ones + 1));
+	uint32_t *colors = malloc(sizeof(*colors) * (kept_ones + 1));
+	const void **user_data = malloc(sizeof(*user_data) * (kept_rows + 1));
+	const void **forced_data = malloc(sizeof(*forced_data) * (forced_rows + 1));
+	size_t *mapping = malloc(sizeof(*mapping) * (kept_rows + 1));
+	struct dlx_matrix *reduced = dlx_matrix_create(primary, secondary, kept_ones > 0 ? kept_ones : 1);
+
+	bool ok = offsets != 0 && columns != 0 && colors != 0 && user_data != 0 && forced_data != 0 && mapping != 0 &&
+		  reduced != 0;
+
+	size_t i = 0;
+	size_t k = 0;
+	size_t f = 0;
+	for (size_t row = 0; row < r->num_rows && ok; ++row) {
+		if (solvable && r->row_forced[row]) {
+			forced_data[f++] = mat->row_data[row_index[row]];
+		}
+		if (!solvable || !r->row_alive[row]) {
+			continue;
+		}
+
+		offsets[i] = k;
+		user_data[i] = mat->row_data[row_index[row]];
+		mapping[i++] = row_index[row];
+		for (size_t j = r->row_first[row]; j < r->row_first[row + 1]; ++j) {
+			const size_t c = r->row_cols[j];
+
+			if (r->col_alive[c]) {
+				colors[k] = (uint32_t)color_of(r, row, c);
+				columns[k++] = new_col[c];
+			}
+		}
+	}
+	if (ok) {
+		offsets[kept_rows] = k;
+		ok = dlx_matrix_add_colored_rows(reduced, kept_rows, offsets, columns, mat->colored ? colors : 0,
+						 user_data, 0);
+	}
+
+	free(offsets);
+	free(columns);
+	free(colors);
+	free(user_data);
+
+	if (!ok) {
+		free(forced_data);
+		free(mapping);
+		if (reduced != 0) {
+			dlx_matrix_destroy(reduced);
+		}
+		return 0;
+	}
+
+	for (size_t c = 0; c < r->primary_cols && solvable; ++c) {
+		const struct header *h = &mat->column_list[c];
+		if (r->col_alive[c]) {
+			dlx_matrix_set_column_multiplicity(reduced, new_col[c], h->bound - h->slack, h->bound);
+		}
+	}
+
+	reduced->engine = mat->engine;
+	dlx_matrix_set_column_selection(reduced, mat->selection);
+	reduced->bitset_columns = mat->bitset_columns;
+
+	*forced = forced_data;
+	*num_forced = forced_rows;
+	*rows = mapping;
+	*num_rows = kept_rows;
+	return reduced;
+}
@@ -1,9 +1,17 @@
 #include "matrix_query.h"
 
+#include "column_buckets.h"
 #include "matrix_struct.h"
 
 struct header *dlx_matrix_query_smallest_column(const struct dlx_matrix *mat)
 {
+	if (mat->buckets != 0) {
+		struct header *col = dlx_column_buckets_query(mat->buckets);
+		if (col != 0) {
+			return col;
+		}
+	}
+
 	const struct node *header = ((struct node *)&mat->root)->right;
 	const struct node *smallest = header;
 
@@ -25,6 +33,46 @@ struct header *dlx_matrix_query_smallest_column(const struct dlx_matrix *mat)
 	return (struct header *)smallest;
 }
 
+struct header *dlx_matrix_query_smallest_column_random(const struct dlx_matrix *mat, uint64_t *state)
+{
+	const struct node *header = ((struct node *)&mat->root)->right;
+	const struct node *smallest = header;
+	uint64_t ties = 1;
+
+	/* Reservoir sampling: the i-th column of the smallest size seen so
+	   far replaces the pick with probability 1/i. */
+	for (header = header->right; header != (struct node *)&mat->root; header = header->right) {
+		if (((struct header *)header)->size < ((struct header *)smallest)->size) {
+			smallest = header;
+			ties = 1;
+		} else if (((struct header *)header)->size == ((struct header *)smallest)->size &&
+			   dlx_random_next(state) % ++ties == 0) {
+			smallest = header;
+		}
+	}
+
+	return (struct header *)smallest;
+}
+
+struct header *dlx_matrix_query_fewest_branches(const struct dlx_matrix *mat)
+{
+	const struct node *header = ((struct node *)&mat->root)->right;
+	const struct node *fewest = header;
+	size_t branches = header_branches((struct header *)fewest);
+
+	/* As above, a column with at most 1 branch is as good as it gets. */
+	for (header = header->right; header != (struct node *)&mat->root && branches > 1; header = header->right) {
+		const size_t b = header_branches((struct header *)header);
+
+		if (b < branches) {
+			fewest = header;
+			branches = b;
+		}
+	}
+
+	return (struct header *)fewest;
+}
+
 bool dlx_matrix_is_empty(const struct dlx_matrix *matrix)
 {
 	const struct node *root = (const struct node *)&matrix->root;
@@ -4,6 +4,7 @@
 #include "matrix.h"
 
 #include <stdbool.h>
+#include <stdint.h>
 
 /**
  * @file
@@ -23,6 +24,33 @@
  */
 struct header *dlx_matrix_query_smallest_column(const struct dlx_matrix *);
 
+/**
+ * Same as dlx_matrix_query_smallest_column, but ties are broken
+ * uniformly at random instead of in favour of the leftmost column.
+ *
+ * @pre \c dlx_matrix_is_empty returns \c false
+ * @param the matrix
+ * @param state state of the random number generator, see
+ *        dlx_random_next
+ * @return header of a smallest column
+ */
+struct header *dlx_matrix_query_smallest_column_random(const struct dlx_matrix *, uint64_t *state);
+
+/**
+ * Find the column with the fewest branches, for a matrix with
+ * multiplicities.
+ *
+ * Same as dlx_matrix_query_smallest_column, but the columns are compared
+ * by the number of ways the search can branch on them (see
+ * dlx_matrix_set_column_multiplicity), which is 0 for a column that can
+ * no longer reach its lower bound.
+ *
+ * @pre \c dlx_matrix_is_empty returns \c false
+ * @param the matrix
+ * @return header of the column with the fewest branches
+ */
+struct header *dlx_matrix_query_fewest_branches(const struct dlx_matrix *);
+
 /**
  * Is the matrix empty (zero by zero).
  *
@@ -31,4 +59,18 @@ struct header *dlx_matrix_query_smallest_column(const struct dlx_matrix *);
  */
 bool dlx_matrix_is_empty(const struct dlx_matrix *);
 
+/**
+ * Step a xorshift64* random number generator.
+ *
+ * @param state the generator's state, must not be 0
+ * @return the next pseudo-random number
+ */
+static inline uint64_t dlx_random_next(uint64_t *state)
+{
+	*state ^= *state >> 12;
+	*state ^= *state << 25;
+	*state ^= *state >> 27;
+	return *state * UINT64_C(2685821657736338717);
+}
+
 #endif /* #ifndef LIBDLX_MATRIX_QUERY_H */
@@ -1,7 +1,10 @@
 #ifndef LIBDLX_MATRIX_STRUCT_H
 #define LIBDLX_MATRIX_STRUCT_H
 
+#include "matrix.h"
+
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdlib.h>
 
 /**
@@ -16,9 +19,16 @@
  * a 0 at that position. The sparse matrix is represented as a doubly
  * linked circular list.
  *
- * All the nodes in the same row have identical \c user_data pointers.
- * The \c user_data member stores information that will help a user
- * identify which rows are present in a solution.
+ * All the nodes in the same row have identical \c row indices.  The
+ * \c row member indexes the matrix' \c row_data table, which stores the
+ * information that will help a user identify which rows are present in
+ * a solution.  It's 32 bits (see DLX_MAX_ROWS) so that a node takes 48
+ * bytes.
+ *
+ * A node in a secondary column may have a color, see
+ * dlx_matrix_current_row_set_colored_one.  Colors are kept next to the
+ * slab the node lives in (see struct node_slab) rather than in the node,
+ * so that matrices without colors don't pay for them.
  */
 struct node {
 	struct node *up;     /**< Points to the node above this node. **/
@@ -27,11 +37,7 @@ struct node {
 	struct node *right;  /**< Points to the right neighbour. **/
 	struct header *head; /**< Points to the column header. **/
 
-	/**
-	 * points to a user provided data structure, alternatively
-	 * a user can store an integer in here (8 bytes on a 64bit system)
-	 */
-	const void *user_data;
+	uint32_t row;        /**< Index of this node's row in the matrix. **/
 };
 
 /**
@@ -40,6 +46,12 @@ struct node {
  * There are as many of these structures in the matrix as there are
  * columns. The size member is used to keep track of the amount of 1's
  * (nodes) in the corresponding column.
+ *
+ * The bound and slack members hold a primary column's multiplicity, see
+ * dlx_matrix_set_column_multiplicity: \c bound is how many more rows may
+ * still cover the column, \c slack how many of those it can do without.
+ * Both start out as \c hi and \c hi - \c lo, the search lowers \c bound
+ * as it chooses rows (1 and 0 for every other column).
  */
 struct header {
 	/**
@@ -48,7 +60,35 @@ struct header {
 	 * if node is the first member.
 	 */
 	struct node node;
-	size_t size; /**< Keeps track of the number of nodes in this column. **/
+	size_t size;  /**< Keeps track of the number of nodes in this column. **/
+	size_t bound; /**< How many more rows may cover this column. **/
+	size_t slack; /**< How many of those it may do without. **/
+
+	/**
+	 * The matrix, if it has colors (kept next to its slabs, see struct
+	 * node_slab) or keeps its columns in buckets (see column_buckets.h).
+	 * Every column has it then, so that the search can tell from any
+	 * header whether either needs to be looked at.  0 otherwise.
+	 */
+	const struct dlx_matrix *matrix;
+};
+
+/**
+ * A slab of nodes.
+ *
+ * Nodes never move once they are placed in a slab, so \c struct node *
+ * handles stay valid while the pool grows.
+ *
+ * Once the matrix has colors every slab has \c colors, the color of
+ * the node in the same slot of \c nodes: 0 for none.  While the search
+ * has committed a column to a color, the ones of that color are -1
+ * (they're purified).
+ */
+struct node_slab {
+	struct node *nodes; /**< First node of the slab. **/
+	int32_t *colors;    /**< Color of every node, 0 if the matrix has no colors. **/
+	size_t size;        /**< Amount of nodes the slab has room for. **/
+	size_t used;        /**< Amount of nodes in use, node_pool_used for the current slab. **/
 };
 
 /**
@@ -66,6 +106,11 @@ struct header {
  *
  * column_list has length equal to `primary_cols' + `secondary_cols'
  * node_pool has length equal to `node_pool_size'
+ *
+ * A growable matrix starts out the same way.  Once the nodes in pool are
+ * used up it allocates a new, larger, slab and node_pool moves on to it.
+ * No more nodes go into a slab once there is a next one, even if a few
+ * more would have fit; its capacity stays for when the matrix is reset.
  */
 struct dlx_matrix {
 	struct header root; /**< Root node of the matrix. **/
@@ -87,15 +132,158 @@ struct dlx_matrix {
 	bool start_new_row;
 
 	/**
-	 * Pointer to the first node object in pool.
+	 * Pointer to the first node object in the current slab, initially
+	 * the one in pool.
 	 */
 	struct node *node_pool;
-	size_t node_pool_size; /**< Amount of nodes in the pool. **/
-	size_t node_pool_used; /**< Amount of nodes in use. **/
+	size_t node_pool_size; /**< Amount of nodes in the current slab. **/
+	size_t node_pool_used; /**< Amount of nodes in use in the current slab. **/
+
+	/**
+	 * All the slabs of nodes, the first one lives in pool and the
+	 * last one is the current slab.
+	 */
+	struct node_slab *slabs;
+	size_t num_slabs;  /**< Amount of slabs in use. **/
+	size_t slabs_size; /**< Capacity of slabs. **/
+	bool growable;     /**< Whether new slabs may be allocated. **/
+
+	struct node *last_node; /**< Most recently added node. **/
+	size_t nodes_in_mat;    /**< Amount of nodes in the matrix. **/
 
 	size_t primary_cols;   /**< Amount of primary columns in the matrix. **/
 	size_t secondary_cols; /**< Amount of secondary columns in the matrix. **/
 	size_t rows_in_mat;    /**< Amount of rows in the matrix. **/
+	bool colored;          /**< Whether any node has a color. **/
+	bool multiplicities;   /**< Whether any column's multiplicity was set. **/
+
+	/**
+	 * The user_data of every row, indexed by row.  Stored once per row
+	 * rather than once per node.
+	 */
+	const void **row_data;
+	size_t row_data_size; /**< Capacity of row_data. **/
+
+	enum dlx_engine engine;              /**< Engine the solvers run on. **/
+	enum dlx_column_selection selection; /**< How the solvers find the smallest column. **/
+	struct column_buckets *buckets;      /**< See column_buckets.h, 0 if the columns are scanned. **/
+	size_t bitset_columns;               /**< Columns up to which the bitset engine is used. **/
+
+	/**
+	 * Generators of the symmetry group, see dlx_matrix_add_symmetry: the
+	 * image of every row followed by the image of every column, for
+	 * the \c symmetry_rows rows the matrix had when they were added.
+	 */
+	size_t *symmetries;
+	size_t num_symmetries; /**< Amount of generators in symmetries. **/
+	size_t symmetry_rows;  /**< Amount of rows the generators map. **/
 };
 
+/**
+ * Types of the index arrays in \c struct csr_rows.
+ */
+enum csr_type { CSR_SIZE_T, CSR_UINT32, CSR_UINT64 };
+
+/**
+ * Rows in compressed sparse row format, see dlx_matrix_add_rows.
+ *
+ * The index arrays may be of any of the \c csr_type's so that the rows
+ * can be read from wherever they are stored (e.g. a mapped file)
+ * without conversion.  Every row gets the user_data in \c user_data if
+ * that's set, the value in \c row_ids if that's set and its index in
+ * the matrix otherwise.
+ */
+struct csr_rows {
+	size_t num_rows;
+	const void *offsets; /**< num_rows + 1 offsets into columns. **/
+	enum csr_type offset_type;
+	const void *columns; /**< Column of every one. **/
+	enum csr_type column_type;
+	const void *const *user_data;
+	const uint64_t *row_ids;
+	const uint32_t *colors; /**< Color of every one, or 0 if none are colored. **/
+};
+
+/**
+ * Number of ways the search can branch on a column with multiplicities:
+ * once for every row that leaves enough rows below it to reach the
+ * column's lower bound, and once more for leaving the column as it is if
+ * the lower bound has been reached already.  For a column that has to be
+ * covered exactly once this is its size.
+ */
+static inline size_t header_branches(const struct header *h)
+{
+	const size_t needed = h->bound > h->slack ? h->bound - h->slack : 0;
+
+	return h->size + 1 > needed ? h->size + 1 - needed : 0;
+}
+
+static inline size_t csr_index(const void *array, enum csr_type type, size_t i)
+{
+	switch (type) {
+	case CSR_UINT32:
+		return ((const uint32_t *)array)[i];
+	case CSR_UINT64:
+		return (size_t)((const uint64_t *)array)[i];
+	default:
+		return ((const size_t *)array)[i];
+	}
+}
+
+/**
+ * Whether the matrix of \c h has colors, see struct header.
+ */
+static inline bool header_colored(const struct header *h) { return h->matrix != 0 && h->matrix->colored; }
+
+/**
+ * The buckets of the matrix of \c h, 0 if its columns are scanned.
+ */
+static inline struct column_buckets *header_buckets(const struct header *h)
+{
+	return h->matrix != 0 ? h->matrix->buckets : 0;
+}
+
+/**
+ * Where the color of the one \c n is kept, 0 if the matrix has no
+ * colors.  Most nodes live in the last slab, the largest one, so the
+ * slabs are searched from there.
+ */
+static inline int32_t *node_color_slot(const struct node *n)
+{
+	const struct dlx_matrix *mat = n->head->matrix;
+
+	if (mat == 0 || !mat->colored) {
+		return 0;
+	}
+
+	const struct node_slab *slab = &mat->slabs[mat->num_slabs - 1];
+	while ((uintptr_t)n < (uintptr_t)slab->nodes || (uintptr_t)n >= (uintptr_t)(slab->nodes + slab->size)) {
+		--slab;
+	}
+
+	return &slab->colors[n - slab->nodes];
+}
+
+/**
+ * Color of the one \c n, 0 for none and -1 if it's purified.
+ */
+static inline int32_t node_color(const struct node *n)
+{
+	const int32_t *color = node_color_slot(n);
+	return color != 0 ? *color : 0;
+}
+
+/**
+ * Implements dlx_matrix_add_rows.
+ */
+bool dlx_matrix_add_csr_rows(struct dlx_matrix *, const struct csr_rows *, struct node **);
+
+/**
+ * Whether the permutations of rows and columns map the rows that aren't
+ * hidden onto themselves, see dlx_matrix_add_symmetry.
+ *
+ * @return false if they don't or memory could not be allocated
+ */
+bool dlx_matrix_is_symmetry(const struct dlx_matrix *, const size_t *, const size_t *);
+
 #endif /* #ifndef LIBDLX_MATRIX_STRUCT_H */
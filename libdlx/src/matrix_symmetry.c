@@ -0,0 +1,116 @@
+#include "matrix.h"
+#include "matrix_struct.h"
+
+#include <string.h>
+
+static bool is_permutation(const size_t *, size_t, bool *);
+
+bool dlx_matrix_add_symmetry(struct dlx_matrix *mat, const size_t *rows, const size_t *columns)
+{
+	if (!dlx_matrix_is_symmetry(mat, rows, columns)) {
+		return false;
+	}
+
+	/* Symmetries of the matrix before rows were added are of no use. */
+	if (mat->symmetry_rows != mat->rows_in_mat) {
+		mat->num_symmetries = 0;
+		mat->symmetry_rows = mat->rows_in_mat;
+	}
+
+	const size_t stride = mat->rows_in_mat + mat->primary_cols + mat->secondary_cols;
+	size_t *symmetries = realloc(mat->symmetries, sizeof(*symmetries) * (stride * (mat->num_symmetries + 1) + 1));
+
+	if (symmetries == 0) {
+		return false;
+	}
+
+	size_t *const symmetry = symmetries + stride * mat->num_symmetries;
+	memcpy(symmetry, rows, sizeof(*rows) * mat->rows_in_mat);
+	memcpy(symmetry + mat->rows_in_mat, columns, sizeof(*columns) * (stride - mat->rows_in_mat));
+
+	mat->symmetries = symmetries;
+	++mat->num_symmetries;
+	return true;
+}
+
+/**
+ * Rows are found through the columns, so hidden rows are left out.  A
+ * row's columns are marked with the row's image and their image's color,
+ * the image then has to have exactly those.
+ */
+bool dlx_matrix_is_symmetry(const struct dlx_matrix *mat, const size_t *rows, const size_t *columns)
+{
+	const size_t num_cols = mat->primary_cols + mat->secondary_cols;
+	const struct node **row_node = calloc(mat->rows_in_mat + 1, sizeof(*row_node));
+	bool *seen = malloc(sizeof(*seen) * (mat->rows_in_mat + num_cols + 1));
+	size_t *mark = malloc(sizeof(*mark) * (num_cols + 1));
+	int32_t *color = malloc(sizeof(*color) * (num_cols + 1));
+
+	bool ok = row_node != 0 && seen != 0 && mark != 0 && color != 0 &&
+		  is_permutation(rows, mat->rows_in_mat, seen) && is_permutation(columns, num_cols, seen);
+
+	for (size_t c = 0; c < num_cols && ok; ++c) {
+		ok = (c < mat->primary_cols) == (columns[c] < mat->primary_cols);
+		mark[c] = SIZE_MAX;
+
+		const struct node *header = (const struct node *)&mat->column_list[c];
+		for (const struct node *v = header->down; v != header; v = v->down) {
+			row_node[v->row] = v;
+		}
+	}
+
+	for (size_t r = 0; r < mat->rows_in_mat && ok; ++r) {
+		const struct node *v = row_node[r];
+		const struct node *w = row_node[rows[r]];
+
+		ok = (v == 0) == (w == 0);
+		if (v == 0 || !ok) {
+			continue;
+		}
+
+		size_t ones = 0;
+		const struct node *h = v;
+		do {
+			const size_t c = columns[h->head - mat->column_list];
+			mark[c] = rows[r];
+			color[c] = node_color(h);
+			++ones;
+			h = h->right;
+		} while (h != v);
+
+		h = w;
+		do {
+			const size_t c = (size_t)(h->head - mat->column_list);
+			ok = ok && ones > 0 && mark[c] == rows[r] && color[c] == node_color(h);
+			--ones;
+			h = h->right;
+		} while (h != w);
+		ok = ok && ones == 0;
+	}
+
+	free(row_node);
+	free(seen);
+	free(mark);
+	free(color);
+	return ok;
+}
+
+/** Unexposed functions **/
+
+/**
+ * Does \c map hold every number below \c n exactly once?  \c seen is
+ * scratch space for \c n flags.
+ */
+static bool is_permutation(const size_t *map, size_t n, bool *seen)
+{
+	memset(seen, 0, sizeof(*seen) * n);
+
+	for (size_t i = 0; i < n; ++i) {
+		if (map[i] >= n || seen[map[i]]) {
+			return false;
+		}
+		seen[map[i]] = true;
+	}
+
+	return true;
+}
@@ -0,0 +1,153 @@
+/**
+ * @file
+ *
+ * The searches of the recursive solver, written once for all engines.
+ *
+ * dlx_recursive_solver.c includes this file once per engine, after
+ * defining how the searches work on that engine:
+ *
+ * - \c SEARCH(name) is the name of function \c name on the engine.
+ * - \c SEARCH_MATRIX, \c SEARCH_COLUMN and \c SEARCH_CURSOR are the types
+ *   of the matrix, of a column and of a row's place in a column.
+ * - \c SEARCH_IS_EMPTY(m, depth) tells whether every primary column is
+ *   covered, \c SEARCH_QUERY(m, depth) returns the column to branch on
+ *   otherwise.
+ * - \c SEARCH_COVER(m, depth, column) and \c SEARCH_UNCOVER(m, column)
+ *   cover and uncover that column.
+ * - \c SEARCH_FIRST(m, depth, column), \c SEARCH_MORE(m, column, x) and
+ *   \c SEARCH_NEXT(m, depth, column, x) walk the rows of the column.
+ * - \c SEARCH_CHOOSE(m, depth, x) and \c SEARCH_UNCHOOSE(m, x) cover and
+ *   uncover all other columns of row \c x.
+ * - \c SEARCH_ROW(m, x) is the index of row \c x in the source matrix.
+ * - \c SEARCH_BUDGET, if defined, adds count_budget.  SEARCH_COVER and
+ *   SEARCH_CHOOSE then return the number of updates they made.
+ *
+ * \c depth is the number of rows chosen so far, only the bitset engine
+ * needs it.  All of the above are undefined at the end of the file.
+ */
+
+/**
+ * The algorithm below maps very closely to the approach described
+ * by Knuth in doc/Donald E. Knuth - Dancing Links.pdf
+ */
+static size_t SEARCH(count_solutions)(SEARCH_MATRIX *m, size_t depth)
+{
+	if (SEARCH_IS_EMPTY(m, depth)) {
+		return 1;
+	}
+
+	size_t solutions_found = 0;
+	SEARCH_COLUMN column = SEARCH_QUERY(m, depth);
+	SEARCH_COVER(m, depth, column);
+	for (SEARCH_CURSOR x = SEARCH_FIRST(m, depth, column); SEARCH_MORE(m, column, x);
+	     x = SEARCH_NEXT(m, depth, column, x)) {
+		SEARCH_CHOOSE(m, depth, x);
+		solutions_found += SEARCH(count_solutions)(m, depth + 1);
+		SEARCH_UNCHOOSE(m, x);
+	}
+	SEARCH_UNCOVER(m, column);
+
+	return solutions_found;
+}
+
+#ifdef SEARCH_BUDGET
+/**
+ * Same as count_solutions, charging every node and update to the budget.
+ * Once it runs out the recursion unwinds without trying any more rows.
+ */
+static size_t SEARCH(count_budget)(SEARCH_MATRIX *m, struct dlx_budget *budget, size_t depth)
+{
+	if (dlx_budget_spend(budget, 1, 0)) {
+		return 0;
+	}
+
+	if (SEARCH_IS_EMPTY(m, depth)) {
+		return 1;
+	}
+
+	size_t solutions_found = 0;
+	SEARCH_COLUMN column = SEARCH_QUERY(m, depth);
+	dlx_budget_spend(budget, 0, SEARCH_COVER(m, depth, column));
+	for (SEARCH_CURSOR x = SEARCH_FIRST(m, depth, column);
+	     SEARCH_MORE(m, column, x) && budget->status == DLX_BUDGET_OK; x = SEARCH_NEXT(m, depth, column, x)) {
+		dlx_budget_spend(budget, 0, SEARCH_CHOOSE(m, depth, x));
+		solutions_found += SEARCH(count_budget)(m, budget, depth + 1);
+		SEARCH_UNCHOOSE(m, x);
+	}
+	SEARCH_UNCOVER(m, column);
+
+	return solutions_found;
+}
+#endif
+
+/**
+ * Same as count_solutions, with a 128-bit count.  Below b->levels the
+ * count under every row is recorded as well.
+ */
+static void SEARCH(count_breakdown)(SEARCH_MATRIX *m, struct breakdown *b)
+{
+	if (SEARCH_IS_EMPTY(m, b->depth)) {
+		b->total.high += ++b->total.low == 0;
+		return;
+	}
+
+	SEARCH_COLUMN column = SEARCH_QUERY(m, b->depth);
+	SEARCH_COVER(m, b->depth, column);
+	for (SEARCH_CURSOR x = SEARCH_FIRST(m, b->depth, column); SEARCH_MORE(m, column, x);
+	     x = SEARCH_NEXT(m, b->depth, column, x)) {
+		const struct dlx_count before = b->total;
+
+		SEARCH_CHOOSE(m, b->depth, x);
+		++b->depth;
+		SEARCH(count_breakdown)(m, b);
+		--b->depth;
+		SEARCH_UNCHOOSE(m, x);
+
+		if (b->depth < b->levels) {
+			count_branch(b, SEARCH_ROW(m, x), before);
+		}
+	}
+	SEARCH_UNCOVER(m, column);
+}
+
+/**
+ * Same as count_solutions, handing every solution to the callback.  Once
+ * the callback asks to stop the recursion unwinds without trying any
+ * more rows.
+ */
+static void SEARCH(enumerate)(SEARCH_MATRIX *m, struct enumeration *e)
+{
+	if (SEARCH_IS_EMPTY(m, e->depth)) {
+		++e->solutions_found;
+		e->stop = !e->callback(e->rows, e->depth, e->ctx);
+		return;
+	}
+
+	SEARCH_COLUMN column = SEARCH_QUERY(m, e->depth);
+	SEARCH_COVER(m, e->depth, column);
+	for (SEARCH_CURSOR x = SEARCH_FIRST(m, e->depth, column); SEARCH_MORE(m, column, x) && !e->stop;
+	     x = SEARCH_NEXT(m, e->depth, column, x)) {
+		SEARCH_CHOOSE(m, e->depth, x);
+		e->rows[e->depth++] = e->matrix->row_data[SEARCH_ROW(m, x)];
+		SEARCH(enumerate)(m, e);
+		--e->depth;
+		SEARCH_UNCHOOSE(m, x);
+	}
+	SEARCH_UNCOVER(m, column);
+}
+
+#undef SEARCH
+#undef SEARCH_MATRIX
+#undef SEARCH_COLUMN
+#undef SEARCH_CURSOR
+#undef SEARCH_IS_EMPTY
+#undef SEARCH_QUERY
+#undef SEARCH_COVER
+#undef SEARCH_UNCOVER
+#undef SEARCH_FIRST
+#undef SEARCH_MORE
+#undef SEARCH_NEXT
+#undef SEARCH_CHOOSE
+#undef SEARCH_UNCHOOSE
+#undef SEARCH_ROW
+#undef SEARCH_BUDGET
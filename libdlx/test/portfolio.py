@@ -0,0 +1,41 @@
+#!/usr/bin/env python3
+
+# Race a portfolio of searches for the first solution of the n-queens
+# problem, over and over.  The first search runs on the caller's matrix,
+# which has to be intact afterwards however far it got before another
+# search won.  The test cases are too small for that: every search finds
+# a solution before it would check whether another one has.
+
+import os
+import sys
+
+pydlx_dir = '../..'
+sys.path.insert(1, os.path.join(sys.path[0], pydlx_dir))
+
+from pydlx.dlx_matrix import dlx_matrix
+from pydlx.dlx_iterative_solver import dlx_iterative_solver, find_solution_portfolio
+
+n = int(sys.argv[1])
+runs = int(sys.argv[2])
+
+# A primary column for every row and column of the board, a secondary one
+# for every diagonal.
+num_primary_columns = 2 * n
+num_secondary_columns = 2 * (2 * n - 1)
+matrix = [[r, n + c, 2 * n + r + c, 2 * n + 2 * n - 1 + r - c + n - 1] for r in range(n) for c in range(n)]
+
+for seed in range(runs):
+	with dlx_matrix(num_primary_columns, num_secondary_columns) as mat:
+		mat.add_rows(matrix)
+		with dlx_iterative_solver(mat) as solver:
+			first = solver.get_next_solution()
+		portfolio_solution = find_solution_portfolio(mat, num_primary_columns, 8, seed)
+		with dlx_iterative_solver(mat) as solver:
+			again = solver.get_next_solution()
+
+	if portfolio_solution is None or again != first:
+		print('seed %d: portfolio found %s, first solution %s, afterwards %s' %
+		      (seed, str(portfolio_solution), str(first), str(again)))
+		sys.exit(1)
+
+sys.exit(0)
@@ -1,33 +1,52 @@
 #!/usr/bin/env python3
 
 import os
+import random
+import subprocess
 import sys
+import tempfile
 
 pydlx_dir = '../..'
 sys.path.insert(1, os.path.join(sys.path[0], pydlx_dir))
 
-from pydlx.dlx_matrix import dlx_matrix
-from pydlx.dlx_iterative_solver import dlx_iterative_solver
+from pydlx.dlx_matrix import dlx_matrix, ENGINE_LINKED, ENGINE_CELLS, SELECTION_SCAN, SELECTION_BUCKETS
+from pydlx.dlx_budget import dlx_budget, BUDGET_OK, BUDGET_NODES, BUDGET_UPDATES, BUDGET_CANCELLED
+from pydlx.dlx_estimator import estimate_search
+from pydlx.dlx_iterative_solver import dlx_iterative_solver, find_solution_portfolio
+from pydlx.dlx_recursive_solver import count_solutions, count_solutions_parallel, enumerate_solutions, \
+	count_solutions_wide, count_solutions_breakdown, count_solutions_up_to, is_unique, count_solutions_budget, \
+	split, count_subproblem, enumerate_up_to_symmetry
+from pydlx.dlx_zdd import dlx_zdd
+from pydlx.dlx_incremental_solver import dlx_incremental_solver
 
 lines = open(sys.argv[1]).read().split('\n')
 
 # First line contains metadata about the division between primary and
-# secondary columns.
-metadata = lines[0]
-(num_primary_columns, num_secondary_columns) = eval(metadata)
+# secondary columns, optionally followed by the (lo, hi) multiplicity of
+# every primary column.
+metadata = eval(lines[0])
+(num_primary_columns, num_secondary_columns) = metadata[:2]
+multiplicities = metadata[2] if len(metadata) > 2 else None
 
-# Find the line reading "solutions"
+# Find the line reading "solutions", and the one reading "symmetries" if
+# the case has any.
 solution_row = lines.index("solutions")
+symmetry_row = lines.index("symmetries") if "symmetries" in lines else len(lines)
 
-# Extract the matrix and the solutions from the input file
+# Extract the matrix, the solutions and the symmetries from the input file.
+# A symmetry is the image of every row, a semicolon and the image of every
+# column.
 matrix = lines[1:solution_row]
-solutions = [s for s in lines[solution_row + 1:] if len(s) > 0]
+solutions = [s for s in lines[solution_row + 1:symmetry_row] if len(s) > 0]
+symmetries = [[[int(i) for i in half.split(',') if i] for half in s.split(';')] for s in lines[symmetry_row + 1:] if len(s) > 0]
 
 
-# Convert the input rows to lists of indices of where the 1's occur
+# Convert the input rows to lists of indices of where the 1's occur, a
+# letter in a secondary column is a one of that color (a is 1).
 # For instance:
 # ['001', '101', '010'] -> [[2], [0, 2], [1]]
-matrix = [[i for i, x in enumerate(row) if x == '1'] for row in matrix]
+# ['10b'] -> [[0, (2, 2)]]
+matrix = [[i if x == '1' else (i, ord(x) - ord('a') + 1) for i, x in enumerate(row) if x != '0'] for row in matrix]
 
 # Convert [['1,2']] -> [set([1, 2])]
 solutions = set([frozenset(int(i) for i in s.split(',')) for s in solutions])
@@ -37,22 +56,632 @@ num_nodes = 0
 if len(matrix) > 0:
 	num_nodes = sum([len(row) for row in matrix])
 
-# Construct & solve the matrix.
-with dlx_matrix(num_primary_columns, num_secondary_columns, num_nodes) as mat:
-	for i, row in enumerate(matrix):
-		mat.add_row(row, i)
 
+def check(mat, description):
+	"""
+	Solve mat and compare against the expected solutions, exits on failure.
+	Returns the solutions in the order they were found.
+	"""
 	with dlx_iterative_solver(mat) as solver:
-		computed_solutions = set()
+		ordered_solutions = []
 		while True:
 			sol = solver.get_next_solution()
 			if not sol:
 				break
-			computed_solutions.add(frozenset(sol))
+			ordered_solutions.append(sol)
+	computed_solutions = set(frozenset(sol) for sol in ordered_solutions)
 
-if solutions != computed_solutions:
-	print('got ' + computed_solutions)
-	print('expected ' + solutions)
-	sys.exit(1)
+	estimate = estimate_search(mat, 1000, 1)
+
+	enumerated_solutions = set()
+	enumerate_solutions(mat, lambda rows: enumerated_solutions.add(frozenset(rows)))
+
+	# Stopping early must leave the matrix intact for the checks below.
+	stopped_count = enumerate_solutions(mat, lambda rows: False)
+
+	portfolio_solution = find_solution_portfolio(mat, num_primary_columns, 4, 1)
+
+	computed_count = count_solutions(mat)
+	(limited_count, first_solution) = count_solutions_up_to(mat, 2, num_primary_columns)
+	(unique, unique_solution) = is_unique(mat, num_primary_columns)
+	parallel_count = count_solutions_parallel(mat, 4)
+	wide_count = count_solutions_wide(mat)
+	(breakdown_count, breakdown) = count_solutions_breakdown(mat, 2)
+
+	# Every call that runs out of budget must leave the matrix intact.
+	with dlx_budget() as budget:
+		budget_count = count_solutions_budget(mat, budget)
+		(budget_status, budget_nodes, budget_updates) = (budget.status(), budget.nodes(), budget.updates())
+		budget.set_max_nodes(max(budget_nodes // 2, 1))
+		count_solutions_budget(mat, budget)
+		nodes_status = budget.status()
+		budget.set_max_nodes(0)
+		budget.set_max_updates(max(budget_updates // 2, 1))
+		count_solutions_budget(mat, budget)
+		updates_status = budget.status()
+		budget.set_max_updates(0)
+		budget.cancel()
+		cancelled_count = count_solutions_budget(mat, budget)
+		cancelled_status = budget.status()
+		budget.reset()
+
+		# Finding the first solution takes more than the root node.
+		with dlx_iterative_solver(mat) as solver:
+			budget.set_max_nodes(1)
+			solver.set_budget(budget)
+			stopped_solution = solver.get_next_solution()
+			stopped_status = budget.status()
+			budget.set_max_nodes(0)
+			resumed_solution = solver.get_next_solution()
+	restored_count = count_solutions(mat)
+
+	# Stopping the iterative solver every few nodes mustn't change the
+	# solutions it finds, nor must continuing from a checkpoint on a clone
+	# (which is built the same way).  Checkpoints are saved right after the
+	# first solution, at a stop halfway and once the search is done.
+	budgeted_solutions = []
+	resumed_solutions = []
+	with mat.clone() as copy, dlx_budget(max(budget_nodes // 20, 2)) as budget, tempfile.TemporaryDirectory() as tmp:
+		checkpoints = []
+		with dlx_iterative_solver(mat) as solver:
+			solver.set_budget(budget)
+			while len(matrix) > 0:
+				sol = solver.get_next_solution()
+				if sol:
+					budgeted_solutions.append(sol)
+				elif budget.status() == BUDGET_OK:
+					break
+				if (sol and len(budgeted_solutions) == 1) or (not sol and len(checkpoints) == 1 and
+				   len(budgeted_solutions) >= len(ordered_solutions) // 2):
+					checkpoints.append((os.path.join(tmp, str(len(checkpoints))), len(budgeted_solutions)))
+					solver.save(checkpoints[-1][0])
+			checkpoints.append((os.path.join(tmp, 'done'), len(budgeted_solutions)))
+			solver.save(checkpoints[-1][0])
+		with dlx_iterative_solver(copy) as solver:
+			for path, found in checkpoints:
+				solver.load(path)
+				rest = []
+				while len(matrix) > 0:
+					sol = solver.get_next_solution()
+					if not sol:
+						break
+					rest.append(sol)
+				resumed_solutions.append(budgeted_solutions[:found] + rest)
+
+	# The update limit runs out between two nodes, with columns of the
+	# last one covered.  The iterative solver has to unwind from there all
+	# the same, wherever that is.
+	with dlx_budget() as budget:
+		for max_updates in range(1, 101) if len(matrix) > 0 else []:
+			budget.set_max_updates(max_updates)
+			with dlx_iterative_solver(mat) as solver:
+				solver.set_budget(budget)
+				while solver.get_next_solution():
+					pass
+	update_limited_count = count_solutions(mat)
+
+	# Saving where the update limit stopped the search and continuing in
+	# a new solver mustn't change the solutions it finds.
+	update_limited = []
+	for parts in [7, 20, 53] if len(matrix) > 0 else []:
+		update_limited_solutions = []
+		with dlx_budget() as budget, tempfile.TemporaryDirectory() as tmp:
+			budget.set_max_updates(max(budget_updates // parts, 8))
+			checkpoint = None
+			while True:
+				with dlx_iterative_solver(mat) as solver:
+					solver.set_budget(budget)
+					if checkpoint:
+						solver.load(checkpoint)
+					while True:
+						sol = solver.get_next_solution()
+						if not sol:
+							break
+						update_limited_solutions.append(sol)
+					if budget.status() == BUDGET_OK:
+						break
+					checkpoint = os.path.join(tmp, 'updates')
+					solver.save(checkpoint)
+		update_limited.append(update_limited_solutions)
+
+	# Subproblems are counted on a clone, the way a worker process counts
+	# them on a matrix of its own.  Split all the way down they are the
+	# solutions.
+	subproblems = split(mat, 2)
+	leaves = split(mat, num_primary_columns + 1)
+	with mat.clone() as copy:
+		subproblem_counts = [count_subproblem(copy, rows) for rows in subproblems]
+		leaf_counts = [count_subproblem(copy, rows) for rows in leaves]
+		misplaced_count = count_subproblem(copy, [len(matrix)])
+
+	# A clone must be indistinguishable from the original.
+	with mat.clone() as copy:
+		cloned_count = count_solutions(copy)
+
+	if solutions != computed_solutions:
+		print(description)
+		print('got ' + str(computed_solutions))
+		print('expected ' + str(solutions))
+		sys.exit(1)
+
+	if len(matrix) > 0 and ((portfolio_solution is None) != (len(computed_solutions) == 0) or
+	   (portfolio_solution is not None and frozenset(portfolio_solution) not in computed_solutions)):
+		print(description)
+		print('portfolio found %s' % str(portfolio_solution))
+		sys.exit(1)
+
+	if len(matrix) > 0 and (enumerated_solutions != computed_solutions or stopped_count != min(computed_count, 1)):
+		print(description)
+		print('enumerated %s, stopped after %d' % (str(enumerated_solutions), stopped_count))
+		sys.exit(1)
+
+	if len(solutions) != computed_count and len(matrix) > 0:
+		print(description)
+		print('counted %d solutions, expected %d' % (computed_count, len(solutions)))
+		sys.exit(1)
+
+	# The first solution is the one the iterative solver finds first.
+	if len(matrix) > 0 and (limited_count != min(computed_count, 2) or unique != (computed_count == 1) or
+	   first_solution != (ordered_solutions[0] if ordered_solutions else None) or unique_solution != first_solution):
+		print(description)
+		print('counted %d solutions up to 2 (unique: %s), first %s' % (limited_count, unique, str(first_solution)))
+		sys.exit(1)
+
+	if parallel_count != computed_count:
+		print(description)
+		print('counted %d solutions in parallel, expected %d' % (parallel_count, computed_count))
+		sys.exit(1)
+
+	# The estimate is unbiased, with a fixed seed it's reproducible.
+	(mean, standard_error, low, high) = estimate['solutions']
+	if estimate['nodes'][0] < 1 or abs(mean - computed_count) > max(6 * standard_error, 1e-9 * computed_count):
+		print(description)
+		print('estimated %f +- %f solutions, expected %d' % (mean, standard_error, computed_count))
+		sys.exit(1)
+
+	if wide_count != computed_count or breakdown_count != computed_count:
+		print(description)
+		print('counted %d and %d solutions wide, expected %d' % (wide_count, breakdown_count, computed_count))
+		sys.exit(1)
+
+	# Every solution holds exactly one row of the first column chosen, so
+	# the count under such a row is the number of solutions holding it.
+	for (level, row), count in breakdown.items():
+		if level == 0 and count != len([s for s in computed_solutions if row in s]):
+			print(description)
+			print('counted %d solutions under row %d, expected %d' % (count, row, len([s for s in computed_solutions if row in s])))
+			sys.exit(1)
+	if sum(count for (level, row), count in breakdown.items() if level == 0) != (computed_count if breakdown else 0):
+		print(description)
+		print('branches at level 0 do not add up to %d' % computed_count)
+		sys.exit(1)
+
+	if (budget_count != computed_count or budget_status != BUDGET_OK or
+	   nodes_status != (BUDGET_NODES if budget_nodes > 1 else BUDGET_OK) or
+	   updates_status != (BUDGET_UPDATES if budget_updates > 1 else BUDGET_OK) or
+	   cancelled_count != 0 or cancelled_status != BUDGET_CANCELLED or restored_count != computed_count):
+		print(description)
+		print('counted %d solutions in %d nodes and %d updates (status %d), statuses %d %d %d, restored %d' %
+		      (budget_count, budget_nodes, budget_updates, budget_status, nodes_status, updates_status, cancelled_status, restored_count))
+		sys.exit(1)
+
+	if len(matrix) > 0 and ordered_solutions and (stopped_solution or stopped_status != BUDGET_NODES or
+	   resumed_solution != ordered_solutions[0]):
+		print(description)
+		print('found %s within one node (status %d), then %s' % (str(stopped_solution), stopped_status, str(resumed_solution)))
+		sys.exit(1)
+
+	if len(matrix) > 0 and (budgeted_solutions != ordered_solutions or
+	   any(resumed != ordered_solutions for resumed in resumed_solutions)):
+		print(description)
+		print('found %s within a budget, %s from checkpoints' % (str(budgeted_solutions), str(resumed_solutions)))
+		sys.exit(1)
+
+	if update_limited_count != computed_count:
+		print(description)
+		print('counted %d solutions after stopping at update limits' % update_limited_count)
+		sys.exit(1)
+
+	if any(update_limited_solutions != ordered_solutions for update_limited_solutions in update_limited):
+		print(description)
+		print('found %s solutions within update limits, expected %d' %
+		      (str([len(found) for found in update_limited]), computed_count))
+		sys.exit(1)
+
+	if (None in subproblem_counts or sum(subproblem_counts) != computed_count or
+	   leaf_counts != [1] * computed_count or misplaced_count is not None or
+	   (len(matrix) > 0 and description.startswith('engine') and set(frozenset(rows) for rows in leaves) != computed_solutions)):
+		print(description)
+		print('counted %s in %s, %d leaves' % (str(subproblem_counts), str(subproblems), len(leaves)))
+		sys.exit(1)
+
+	if cloned_count != computed_count:
+		print(description)
+		print('counted %d solutions in clone, expected %d' % (cloned_count, computed_count))
+		sys.exit(1)
+
+	return ordered_solutions
+
+
+def check_multiplicities(mat, description):
+	"""
+	Same as check, for a matrix with multiplicities.  Only the recursive
+	solver's counts and enumeration honour them.
+	"""
+	enumerated_solutions = []
+	enumerate_solutions(mat, lambda rows: enumerated_solutions.append(frozenset(rows)))
+	stopped_count = enumerate_solutions(mat, lambda rows: False)
+
+	computed_count = count_solutions(mat)
+	(limited_count, first_solution) = count_solutions_up_to(mat, 2, len(matrix))
+	(unique, unique_solution) = is_unique(mat, len(matrix))
+	wide_count = count_solutions_wide(mat)
+	(breakdown_count, breakdown) = count_solutions_breakdown(mat, 2)
+
+	with mat.clone() as copy:
+		cloned_count = count_solutions(copy)
+
+	# The budgeted count honours the bounds too, and a count that runs out
+	# of budget must leave the matrix intact.
+	with dlx_budget() as budget:
+		budget_count = count_solutions_budget(mat, budget)
+		(budget_status, budget_nodes) = (budget.status(), budget.nodes())
+		budget.set_max_nodes(max(budget_nodes // 2, 1))
+		count_solutions_budget(mat, budget)
+		nodes_status = budget.status()
+	restored_count = count_solutions(mat)
+
+	# The workers of the parallel count don't do multiplicities, it counts
+	# on a single thread.  The rest refuses the matrix.
+	parallel_count = count_solutions_parallel(mat, 4)
+	refused = []
+	for name, call in [('iterative solver', lambda: dlx_iterative_solver(mat)),
+			   ('split', lambda: split(mat, 2)),
+			   ('estimator', lambda: estimate_search(mat, 10, 1))]:
+		try:
+			call()
+		except ValueError:
+			refused.append(name)
+	if find_solution_portfolio(mat, len(matrix), 4, 1) is None:
+		refused.append('portfolio')
+	if count_subproblem(mat, []) is None:
+		refused.append('subproblem')
+	with tempfile.TemporaryDirectory() as tmp:
+		try:
+			mat.save(os.path.join(tmp, 'saved.dlxb'))
+		except IOError:
+			refused.append('save')
+
+	# Every set of rows is found once, not once per order of its rows.
+	if set(enumerated_solutions) != solutions or len(enumerated_solutions) != len(solutions):
+		print(description)
+		print('enumerated %s' % str(enumerated_solutions))
+		print('expected ' + str(solutions))
+		sys.exit(1)
+
+	if (computed_count != len(solutions) or wide_count != computed_count or breakdown_count != computed_count or
+	   cloned_count != computed_count or parallel_count != computed_count or stopped_count != min(computed_count, 1)):
+		print(description)
+		print('counted %d, %d, %d, %d and %d solutions, stopped after %d, expected %d' %
+		      (computed_count, wide_count, breakdown_count, cloned_count, parallel_count, stopped_count, len(solutions)))
+		sys.exit(1)
+
+	if (budget_count != computed_count or budget_status != BUDGET_OK or
+	   nodes_status != (BUDGET_NODES if budget_nodes > 1 else BUDGET_OK) or restored_count != computed_count):
+		print(description)
+		print('counted %d solutions in %d nodes (status %d), status %d, restored %d' %
+		      (budget_count, budget_nodes, budget_status, nodes_status, restored_count))
+		sys.exit(1)
+
+	if len(refused) != 6:
+		print(description)
+		print('only %s refused a matrix with multiplicities' % ', '.join(refused))
+		sys.exit(1)
+
+	# Leaving the first column chosen as it is isn't a row, so the rows
+	# at level 0 may add up to less.
+	if sum(count for (level, row), count in breakdown.items() if level == 0) > computed_count:
+		print(description)
+		print('branches at level 0 add up to more than %d' % computed_count)
+		sys.exit(1)
+
+	if (limited_count != min(computed_count, 2) or unique != (computed_count == 1) or
+	   (first_solution if first_solution is None else frozenset(first_solution)) !=
+	   (enumerated_solutions[0] if enumerated_solutions else None) or
+	   unique_solution != first_solution):
+		print(description)
+		print('counted %d solutions up to 2 (unique: %s), first %s' % (limited_count, unique, str(first_solution)))
+		sys.exit(1)
+
+	return enumerated_solutions
+
+
+def check_preprocess(mat, description):
+	"""
+	Reduce mat and check that the forced rows and the solutions of the
+	reduced matrix make up the solutions, exits on failure.  Rows are
+	identified by their index.
+	"""
+	(reduced, forced, rows) = mat.preprocess()
+	with reduced:
+		reduced_solutions = []
+		enumerate_solutions(reduced, lambda sol: reduced_solutions.append(frozenset(sol)))
+		reduced_count = count_solutions(reduced)
+
+	# The reduced matrix reports the rows by their user_data.
+	found = [s | frozenset(forced) for s in reduced_solutions]
+	if (set(found) != solutions or len(found) != len(solutions) or reduced_count != len(solutions) or
+	   rows != sorted(rows) or not set().union(*reduced_solutions) <= set(rows) or set(forced) & set(rows)):
+		print(description)
+		print('reduced to %d rows, forced %s, found %s' % (len(rows), str(forced), str(found)))
+		print('expected ' + str(solutions))
+		sys.exit(1)
+
+
+def check_symmetries(mat, description):
+	"""
+	Add the symmetries of the case to mat, along with the identity and
+	some that aren't, and check that the counts don't change and that
+	every solution is mapped onto by the symmetries from one of those
+	enumerated up to symmetry, exits on failure.  Rows are identified by
+	their index.
+	"""
+	num_columns = num_primary_columns + num_secondary_columns
+	identity = list(range(len(matrix)))
+	rejected = []
+	for rows, columns in [(identity, list(range(num_columns)))] + symmetries:
+		mat.add_symmetry(rows, columns)
+	# Swapping two different rows, or mapping two rows onto one.
+	for rows in [identity[1::-1] + identity[2:], [0] * len(matrix)]:
+		if len(matrix) > 1 and matrix[rows[0]] != matrix[0]:
+			try:
+				mat.add_symmetry(rows, list(range(num_columns)))
+				rejected.append(False)
+			except ValueError:
+				rejected.append(True)
+
+	representatives = []
+	enumerate_up_to_symmetry(mat, lambda rows, weight: representatives.append((frozenset(rows), weight)))
+	computed_count = count_solutions(mat)
+	wide_count = count_solutions_wide(mat)
+	with mat.clone() as copy:
+		cloned_count = count_solutions(copy)
+
+	found = set(rows for rows, weight in representatives)
+	frontier = list(found)
+	while frontier:
+		for rows, columns in symmetries:
+			image = frozenset(rows[i] for i in frontier[-1])
+			if image not in found:
+				found.add(image)
+				frontier.insert(0, image)
+		frontier.pop()
+
+	if (computed_count != len(solutions) or wide_count != len(solutions) or cloned_count != len(solutions) or
+	   sum(weight for rows, weight in representatives) != len(solutions) or found != solutions or
+	   False in rejected):
+		print(description)
+		print('counted %d, %d and %d solutions, found %s up to symmetry, rejected %s' %
+		      (computed_count, wide_count, cloned_count, str(representatives), str(rejected)))
+		print('expected ' + str(solutions))
+		sys.exit(1)
+
+
+def check_zdd(mat, cache_bytes, description):
+	"""
+	Build the diagram of mat and check that counting, listing, ranking and
+	sampling its solutions agree with the solver, exits on failure.  Rows
+	are identified by their index.
+	"""
+	ordered_solutions = []
+	enumerate_solutions(mat, lambda rows: ordered_solutions.append(frozenset(rows)))
+
+	with dlx_zdd(mat, num_primary_columns, cache_bytes) as zdd:
+		listed = []
+		listed_count = zdd.enumerate(lambda rows: listed.append(frozenset(rows)))
+		ranked = [frozenset(zdd.get_solution(i)) for i in range(len(solutions))]
+		past_end = zdd.get_solution(len(solutions))
+		samples = [zdd.sample() for _ in range(20)]
+		sampled = set(frozenset(s) for s in samples if s is not None)
+		stopped_count = zdd.enumerate(lambda rows: False)
+		(count, num_nodes) = (zdd.count(), zdd.num_nodes())
+
+	# Stopping early is only possible with a solution to stop at.
+	if (count != len(solutions) or listed_count != count or listed != ordered_solutions or ranked != listed or
+	   past_end is not None or (not sampled <= solutions) or (len(solutions) > 0 and None in samples) or
+	   stopped_count != min(1, count) or (len(solutions) == 0 and num_nodes != 0)):
+		print(description)
+		print('counted %d solutions in %d nodes, listed %s, ranked %s, sampled %s' %
+		      (count, num_nodes, str(listed), str(ranked), str(samples)))
+		print('expected ' + str(ordered_solutions))
+		sys.exit(1)
+
+
+def check_incremental(mat, description):
+	"""
+	Push and pop forced and hidden rows at random, then hide every row but
+	those of a solution and unhide them one by one.  Check every push and
+	count against the solutions of the case, exits on failure.  Rows are
+	identified by their index.
+	"""
+	forced = []
+	hidden = set()
+	rng = random.Random(len(matrix))
+
+	def expect(limit):
+		left = [sol for sol in solutions if set(forced) <= sol and not sol & hidden]
+		return (min(limit, len(left)) if limit > 0 else len(left), left)
+
+	def fail(what):
+		print(description)
+		print('%s, forced %s, hidden %s' % (what, str(forced), str(sorted(hidden))))
+		sys.exit(1)
+
+	def verify(solver):
+		limit = rng.choice([0, 1, 2, 3])
+		(count, solution) = solver.count_solutions_up_to(limit)
+		(expected, left) = expect(limit)
+		(unique, unique_solution) = solver.is_unique()
+		if count != expected or (count > 0) != (solution is not None) or (solution and frozenset(solution) not in left):
+			fail('counted %d solutions up to %d, found %s' % (count, limit, str(solution)))
+		if unique != (len(left) == 1) or (unique_solution and frozenset(unique_solution) not in left):
+			fail('unique: %s, found %s' % (unique, str(unique_solution)))
+
+	with dlx_incremental_solver(mat, num_primary_columns) as solver:
+		stack = []
+		for step in range(100):
+			row = rng.randrange(len(matrix))
+			clash = set(matrix[row]) & set(c for r in forced for c in matrix[r])
+			available = row not in hidden and row not in forced and not clash
+			action = rng.choice(['force', 'hide', 'hide', 'pop', 'pop'])
+			if action == 'pop' and stack:
+				solver.pop()
+				(row, was_forced) = stack.pop()
+				forced.remove(row) if was_forced else hidden.remove(row)
+			elif action == 'force' or action == 'hide':
+				pushed = solver.push_forced_row(row) if action == 'force' else solver.push_hidden_row(row)
+				if pushed != available:
+					fail('pushing %s row %d returned %s' % (action, row, pushed))
+				if pushed:
+					forced.append(row) if action == 'force' else hidden.add(row)
+					stack.append((row, action == 'force'))
+			if solver.num_assumptions() != len(stack):
+				fail('%d assumptions, expected %d' % (solver.num_assumptions(), len(stack)))
+			verify(solver)
+		while stack:
+			solver.pop()
+			(row, was_forced) = stack.pop()
+			forced.remove(row) if was_forced else hidden.remove(row)
+
+		if solutions:
+			kept = min(solutions, key=sorted)
+			order = [r for r in range(len(matrix)) if r not in kept]
+			rng.shuffle(order)
+			for row in order:
+				solver.push_hidden_row(row)
+				hidden.add(row)
+			verify(solver)
+			for row in reversed(order):
+				solver.pop()
+				hidden.remove(row)
+				verify(solver)
+
+
+if len(sys.argv) > 2 and sys.argv[2] == '--binary':
+	# Convert the case to a binary matrix file, load it and check it.  Then
+	# save it and check the result once more.
+	converter = os.path.join(sys.path[0], '../../examples/convert-to-binary.py')
+	with tempfile.TemporaryDirectory() as tmp:
+		converted = os.path.join(tmp, 'converted.dlxb')
+		saved = os.path.join(tmp, 'saved.dlxb')
+		with open(sys.argv[1]) as case:
+			subprocess.check_call([sys.executable, converter, converted], stdin=case)
+		with dlx_matrix.load(converted) as mat:
+			check(mat, 'converted')
+			mat.save(saved)
+		with dlx_matrix.load(saved) as mat:
+			check(mat, 'saved')
+	sys.exit(0)
+
+# Construct & solve the matrix, on every engine and column selection (the
+# linked engine with and without bitsets), with a fixed size and a
+# growable node pool, before and after finalizing it.
+# The rows of the fixed size matrix are added one by one, the growable one
+# gets them all at once.  None of this may change the order in which the
+# solutions are found.
+all_columns = 2 ** 64 - 1
+engines = [(ENGINE_LINKED, SELECTION_SCAN, 0), (ENGINE_LINKED, SELECTION_SCAN, all_columns),
+           (ENGINE_LINKED, SELECTION_BUCKETS, 0), (ENGINE_CELLS, SELECTION_SCAN, 0)]
+configurations = [(e, n, f) for e in engines for n in [num_nodes, None] for f in [False, True]]
+first_order = None
+for (engine, selection, bitset_columns), pool_size, finalize in configurations:
+	with dlx_matrix(num_primary_columns, num_secondary_columns, pool_size) as mat:
+		if pool_size is None:
+			mat.add_rows(matrix)
+		else:
+			for i, row in enumerate(matrix):
+				mat.add_row(row, i)
+		if multiplicities is not None:
+			for column, (lo, hi) in enumerate(multiplicities):
+				mat.set_column_multiplicity(column, lo, hi)
+		if finalize:
+			mat.finalize()
+		mat.set_engine(engine)
+		mat.set_column_selection(selection)
+		mat.set_bitset_columns(bitset_columns)
+		description = 'engine %d, selection %d, bitset columns %d, pool size %s, finalized %s' % (
+			engine, selection, bitset_columns, pool_size, finalize)
+		order = check(mat, description) if multiplicities is None else check_multiplicities(mat, description)
+		if first_order is None:
+			first_order = order
+		elif order != first_order:
+			print(description)
+			print('found the solutions in a different order')
+			sys.exit(1)
+
+# The reductions mustn't lose or add any solutions.
+if len(matrix) > 0:
+	with dlx_matrix(num_primary_columns, num_secondary_columns) as mat:
+		mat.add_rows(matrix)
+		if multiplicities is not None:
+			for column, (lo, hi) in enumerate(multiplicities):
+				mat.set_column_multiplicity(column, lo, hi)
+		check_preprocess(mat, 'preprocessed')
+
+# Breaking symmetries mustn't lose any solutions, on any engine.
+for engine, selection, bitset_columns in engines if len(matrix) > 0 else []:
+	with dlx_matrix(num_primary_columns, num_secondary_columns) as mat:
+		mat.add_rows(matrix)
+		if multiplicities is not None:
+			for column, (lo, hi) in enumerate(multiplicities):
+				mat.set_column_multiplicity(column, lo, hi)
+		mat.set_engine(engine)
+		mat.set_column_selection(selection)
+		mat.set_bitset_columns(bitset_columns)
+		check_symmetries(mat, 'symmetries, engine %d, selection %d, bitset columns %d' %
+				 (engine, selection, bitset_columns))
+
+# The diagram must hold every solution, whether the cache has room for all
+# subproblems or just one.  It doesn't do colors or multiplicities.
+colored = any(isinstance(one, tuple) for row in matrix for one in row)
+if len(matrix) > 0:
+	with dlx_matrix(num_primary_columns, num_secondary_columns) as mat:
+		mat.add_rows(matrix)
+		if multiplicities is not None:
+			for column, (lo, hi) in enumerate(multiplicities):
+				mat.set_column_multiplicity(column, lo, hi)
+		if colored or multiplicities is not None:
+			try:
+				dlx_zdd(mat, num_primary_columns)
+				print('built a diagram of a matrix with colors or multiplicities')
+				sys.exit(1)
+			except ValueError:
+				pass
+		else:
+			# The default cache, one entry and a few.
+			for cache_bytes in [0, 1, 100]:
+				check_zdd(mat, cache_bytes, 'diagram, %d bytes of cache' % cache_bytes)
+
+# Solving under assumptions, incrementally.  It doesn't do colors or
+# multiplicities either.
+if len(matrix) > 0:
+	with dlx_matrix(num_primary_columns, num_secondary_columns) as mat:
+		mat.add_rows(matrix)
+		if multiplicities is not None:
+			for column, (lo, hi) in enumerate(multiplicities):
+				mat.set_column_multiplicity(column, lo, hi)
+		if colored or multiplicities is not None:
+			try:
+				dlx_incremental_solver(mat, num_primary_columns)
+				print('solved a matrix with colors or multiplicities incrementally')
+				sys.exit(1)
+			except ValueError:
+				pass
+		else:
+			check_incremental(mat, 'incremental')
+			# The matrix is back in its initial state.
+			if count_solutions(mat) != len(solutions):
+				print('incremental: counted %d solutions afterwards' % count_solutions(mat))
+				sys.exit(1)
 
 sys.exit(0)
@@ -11,7 +11,8 @@ def _get_libdlx_location():
 	a dynamic library is different across platforms...
 	"""
 	cwd = os.path.dirname(os.path.abspath(__file__))
-	_glob = os.path.join(cwd, '../build/lib/*dlx*')
+	libdir = os.environ.get('LIBDLX_DIR', os.path.join(cwd, '../build/lib'))
+	_glob = os.path.join(libdir, '*dlx*')
 	matches = glob.glob(_glob)
 	if len(matches) != 1:
 		print("error: can't find libdlx, follow build-instructions.txt")
@@ -26,23 +27,122 @@ class _dlx_matrix(Structure):
 class _dlx_iterative_solver(Structure):
 	pass
 
+class _dlx_budget(Structure):
+	pass
+
+class _dlx_zdd(Structure):
+	pass
+
+class _dlx_incremental_solver(Structure):
+	pass
+
+class _dlx_count(Structure):
+	_fields_ = [('low', c_uint64), ('high', c_uint64)]
+
+	def value(self):
+		return self.high << 64 | self.low
+
+class _dlx_estimate_value(Structure):
+	_fields_ = [('mean', c_double), ('standard_error', c_double), ('low', c_double), ('high', c_double)]
+
+class _dlx_estimate(Structure):
+	_fields_ = [('probes', c_size_t), ('nodes', _dlx_estimate_value), ('solutions', _dlx_estimate_value), ('updates', _dlx_estimate_value)]
+
+class _dlx_branch_count(Structure):
+	# user_data is read back as c_size_t, see dlx_iterative_solver_get_solution_row.
+	_fields_ = [('level', c_size_t), ('user_data', c_size_t), ('count', _dlx_count)]
+
 _libdlx = cdll.LoadLibrary(_libdlx_location)
 
 _libdlx.dlx_matrix_create.argtypes = [c_size_t, c_size_t, c_size_t]
 _libdlx.dlx_matrix_create.restype = POINTER(_dlx_matrix)
 
+_libdlx.dlx_matrix_create_growable.argtypes = [c_size_t, c_size_t]
+_libdlx.dlx_matrix_create_growable.restype = POINTER(_dlx_matrix)
+
 # Actual signature in C is [POINTER(_dlx_matrix), c_void_p], note the difference
 # in the 2nd argument.  This is ok (as long as sizeof c_void_p == sizeof c_size_t), it's just an identifier.
 _libdlx.dlx_matrix_begin_new_row.argtypes = [POINTER(_dlx_matrix), c_size_t]
-_libdlx.dlx_matrix_begin_new_row.restype = None
+_libdlx.dlx_matrix_begin_new_row.restype = c_void_p
 
 _libdlx.dlx_matrix_current_row_set_one.argtypes = [POINTER(_dlx_matrix), c_size_t]
-_libdlx.dlx_matrix_current_row_set_one.restype = None
+_libdlx.dlx_matrix_current_row_set_one.restype = c_bool
+
+_libdlx.dlx_matrix_current_row_set_colored_one.argtypes = [POINTER(_dlx_matrix), c_size_t, c_uint32]
+_libdlx.dlx_matrix_current_row_set_colored_one.restype = c_bool
+
+_libdlx.dlx_matrix_add_rows.argtypes = [POINTER(_dlx_matrix), c_size_t, POINTER(c_size_t), POINTER(c_size_t), POINTER(c_void_p), c_void_p]
+_libdlx.dlx_matrix_add_rows.restype = c_bool
+
+_libdlx.dlx_matrix_add_colored_rows.argtypes = [POINTER(_dlx_matrix), c_size_t, POINTER(c_size_t), POINTER(c_size_t), POINTER(c_uint32), POINTER(c_void_p), c_void_p]
+_libdlx.dlx_matrix_add_colored_rows.restype = c_bool
+
+_libdlx.dlx_matrix_set_column_multiplicity.argtypes = [POINTER(_dlx_matrix), c_size_t, c_size_t, c_size_t]
+_libdlx.dlx_matrix_set_column_multiplicity.restype = c_bool
+
+_libdlx.dlx_matrix_set_engine.argtypes = [POINTER(_dlx_matrix), c_int]
+_libdlx.dlx_matrix_set_engine.restype = None
+
+_libdlx.dlx_matrix_set_column_selection.argtypes = [POINTER(_dlx_matrix), c_int]
+_libdlx.dlx_matrix_set_column_selection.restype = None
+
+_libdlx.dlx_matrix_set_bitset_columns.argtypes = [POINTER(_dlx_matrix), c_size_t]
+_libdlx.dlx_matrix_set_bitset_columns.restype = None
+
+_libdlx.dlx_matrix_finalize.argtypes = [POINTER(_dlx_matrix), c_void_p, c_size_t]
+_libdlx.dlx_matrix_finalize.restype = c_bool
+
+# The forced rows are read back as c_size_t, see dlx_iterative_solver_get_solution_row.
+_libdlx.dlx_matrix_preprocess.argtypes = [POINTER(_dlx_matrix), POINTER(POINTER(c_size_t)), POINTER(c_size_t), POINTER(POINTER(c_size_t)), POINTER(c_size_t)]
+_libdlx.dlx_matrix_preprocess.restype = POINTER(_dlx_matrix)
+
+_libdlx.dlx_matrix_add_symmetry.argtypes = [POINTER(_dlx_matrix), POINTER(c_size_t), POINTER(c_size_t)]
+_libdlx.dlx_matrix_add_symmetry.restype = c_bool
+
+_libdlx.dlx_matrix_clone.argtypes = [POINTER(_dlx_matrix)]
+_libdlx.dlx_matrix_clone.restype = POINTER(_dlx_matrix)
+
+_libdlx.dlx_matrix_load.argtypes = [c_char_p]
+_libdlx.dlx_matrix_load.restype = POINTER(_dlx_matrix)
+
+_libdlx.dlx_matrix_save.argtypes = [POINTER(_dlx_matrix), c_char_p]
+_libdlx.dlx_matrix_save.restype = c_bool
 
 _libdlx.dlx_matrix_destroy.argtypes = [POINTER(_dlx_matrix)]
 _libdlx.dlx_matrix_destroy.restype = None
 
 
+_libdlx.dlx_budget_create.argtypes = []
+_libdlx.dlx_budget_create.restype = POINTER(_dlx_budget)
+
+_libdlx.dlx_budget_destroy.argtypes = [POINTER(_dlx_budget)]
+_libdlx.dlx_budget_destroy.restype = None
+
+_libdlx.dlx_budget_set_max_nodes.argtypes = [POINTER(_dlx_budget), c_uint64]
+_libdlx.dlx_budget_set_max_nodes.restype = None
+
+_libdlx.dlx_budget_set_max_updates.argtypes = [POINTER(_dlx_budget), c_uint64]
+_libdlx.dlx_budget_set_max_updates.restype = None
+
+_libdlx.dlx_budget_set_time_limit.argtypes = [POINTER(_dlx_budget), c_double]
+_libdlx.dlx_budget_set_time_limit.restype = None
+
+_libdlx.dlx_budget_cancel.argtypes = [POINTER(_dlx_budget)]
+_libdlx.dlx_budget_cancel.restype = None
+
+_libdlx.dlx_budget_reset.argtypes = [POINTER(_dlx_budget)]
+_libdlx.dlx_budget_reset.restype = None
+
+_libdlx.dlx_budget_status.argtypes = [POINTER(_dlx_budget)]
+_libdlx.dlx_budget_status.restype = c_int
+
+_libdlx.dlx_budget_nodes.argtypes = [POINTER(_dlx_budget)]
+_libdlx.dlx_budget_nodes.restype = c_uint64
+
+_libdlx.dlx_budget_updates.argtypes = [POINTER(_dlx_budget)]
+_libdlx.dlx_budget_updates.restype = c_uint64
+
+
 _libdlx.dlx_iterative_solver_create.argtypes = [POINTER(_dlx_matrix)]
 _libdlx.dlx_iterative_solver_create.restype = POINTER(_dlx_iterative_solver)
 
@@ -56,10 +156,109 @@ _libdlx.dlx_iterative_solver_get_solution_row.argtypes = [POINTER(_dlx_iterative
 # Actual return type in C is c_void_p, note the difference (we use c_size_t here).
 _libdlx.dlx_iterative_solver_get_solution_row.restype = c_size_t
 
+# The solution is read back as c_size_t, see dlx_iterative_solver_get_solution_row.
+_libdlx.dlx_iterative_solver_find_solution_portfolio.argtypes = [POINTER(_dlx_matrix), c_size_t, c_uint, POINTER(c_size_t), POINTER(c_size_t)]
+_libdlx.dlx_iterative_solver_find_solution_portfolio.restype = c_bool
+
+_libdlx.dlx_iterative_solver_set_budget.argtypes = [POINTER(_dlx_iterative_solver), POINTER(_dlx_budget)]
+_libdlx.dlx_iterative_solver_set_budget.restype = None
+
+_libdlx.dlx_iterative_solver_save.argtypes = [POINTER(_dlx_iterative_solver), c_char_p]
+_libdlx.dlx_iterative_solver_save.restype = c_bool
+
+_libdlx.dlx_iterative_solver_load.argtypes = [POINTER(_dlx_iterative_solver), c_char_p]
+_libdlx.dlx_iterative_solver_load.restype = c_bool
+
 _libdlx.dlx_iterative_solver_destroy.argtypes = [POINTER(_dlx_iterative_solver)]
 _libdlx.dlx_iterative_solver_destroy.restype = None
 
 _libdlx.dlx_recursive_solver_count_solutions.argtypes = [POINTER(_dlx_matrix)]
 _libdlx.dlx_recursive_solver_count_solutions.restype = c_size_t
 
+# The rows are read back as c_size_t, see dlx_iterative_solver_get_solution_row.
+_dlx_solution_callback = CFUNCTYPE(c_bool, POINTER(c_size_t), c_size_t, c_void_p)
+
+_libdlx.dlx_recursive_solver_enumerate.argtypes = [POINTER(_dlx_matrix), _dlx_solution_callback, c_void_p]
+_libdlx.dlx_recursive_solver_enumerate.restype = c_size_t
+
+_dlx_weighted_solution_callback = CFUNCTYPE(c_bool, POINTER(c_size_t), c_size_t, c_size_t, c_void_p)
+
+_libdlx.dlx_recursive_solver_enumerate_up_to_symmetry.argtypes = [POINTER(_dlx_matrix), _dlx_weighted_solution_callback, c_void_p]
+_libdlx.dlx_recursive_solver_enumerate_up_to_symmetry.restype = c_size_t
+
+_libdlx.dlx_recursive_solver_count_solutions_budget.argtypes = [POINTER(_dlx_matrix), POINTER(_dlx_budget)]
+_libdlx.dlx_recursive_solver_count_solutions_budget.restype = c_size_t
+
+_libdlx.dlx_recursive_solver_count_solutions_up_to.argtypes = [POINTER(_dlx_matrix), c_size_t, POINTER(c_size_t), POINTER(c_size_t)]
+_libdlx.dlx_recursive_solver_count_solutions_up_to.restype = c_size_t
+
+_libdlx.dlx_recursive_solver_is_unique.argtypes = [POINTER(_dlx_matrix), POINTER(c_size_t), POINTER(c_size_t)]
+_libdlx.dlx_recursive_solver_is_unique.restype = c_bool
+
+_libdlx.dlx_recursive_solver_count_solutions_wide.argtypes = [POINTER(_dlx_matrix)]
+_libdlx.dlx_recursive_solver_count_solutions_wide.restype = _dlx_count
+
+_libdlx.dlx_recursive_solver_count_solutions_breakdown.argtypes = [POINTER(_dlx_matrix), c_size_t, POINTER(_dlx_count), POINTER(POINTER(_dlx_branch_count)), POINTER(c_size_t)]
+_libdlx.dlx_recursive_solver_count_solutions_breakdown.restype = c_bool
+
+_dlx_subproblem_callback = CFUNCTYPE(c_bool, POINTER(c_size_t), c_size_t, c_void_p)
+
+_libdlx.dlx_recursive_solver_split.argtypes = [POINTER(_dlx_matrix), c_size_t, _dlx_subproblem_callback, c_void_p]
+_libdlx.dlx_recursive_solver_split.restype = c_bool
+
+_libdlx.dlx_recursive_solver_count_subproblem.argtypes = [POINTER(_dlx_matrix), POINTER(c_size_t), c_size_t, POINTER(_dlx_count)]
+_libdlx.dlx_recursive_solver_count_subproblem.restype = c_bool
+
+_libdlx.dlx_recursive_solver_count_solutions_parallel.argtypes = [POINTER(_dlx_matrix), c_size_t]
+_libdlx.dlx_recursive_solver_count_solutions_parallel.restype = _dlx_count
+
+_libdlx.dlx_estimate_search.argtypes = [POINTER(_dlx_matrix), c_size_t, c_uint, POINTER(_dlx_estimate)]
+_libdlx.dlx_estimate_search.restype = c_bool
+
 __all__ = ["dlx_matrix", "dlx_iterative_solver"]
+
+_libdlx.dlx_zdd_create.argtypes = [POINTER(_dlx_matrix), c_size_t]
+_libdlx.dlx_zdd_create.restype = POINTER(_dlx_zdd)
+
+_libdlx.dlx_zdd_destroy.argtypes = [POINTER(_dlx_zdd)]
+_libdlx.dlx_zdd_destroy.restype = None
+
+_libdlx.dlx_zdd_num_nodes.argtypes = [POINTER(_dlx_zdd)]
+_libdlx.dlx_zdd_num_nodes.restype = c_size_t
+
+_libdlx.dlx_zdd_count.argtypes = [POINTER(_dlx_zdd)]
+_libdlx.dlx_zdd_count.restype = _dlx_count
+
+# The rows are read back as c_size_t, see dlx_iterative_solver_get_solution_row.
+_libdlx.dlx_zdd_get_solution.argtypes = [POINTER(_dlx_zdd), _dlx_count, POINTER(c_size_t), POINTER(c_size_t)]
+_libdlx.dlx_zdd_get_solution.restype = c_bool
+
+_libdlx.dlx_zdd_sample.argtypes = [POINTER(_dlx_zdd), POINTER(c_uint64), POINTER(c_size_t), POINTER(c_size_t)]
+_libdlx.dlx_zdd_sample.restype = c_bool
+
+_libdlx.dlx_zdd_enumerate.argtypes = [POINTER(_dlx_zdd), _dlx_solution_callback, c_void_p]
+_libdlx.dlx_zdd_enumerate.restype = c_size_t
+
+_libdlx.dlx_incremental_solver_create.argtypes = [POINTER(_dlx_matrix)]
+_libdlx.dlx_incremental_solver_create.restype = POINTER(_dlx_incremental_solver)
+
+_libdlx.dlx_incremental_solver_destroy.argtypes = [POINTER(_dlx_incremental_solver)]
+_libdlx.dlx_incremental_solver_destroy.restype = None
+
+_libdlx.dlx_incremental_solver_push_forced_row.argtypes = [POINTER(_dlx_incremental_solver), c_size_t]
+_libdlx.dlx_incremental_solver_push_forced_row.restype = c_bool
+
+_libdlx.dlx_incremental_solver_push_hidden_row.argtypes = [POINTER(_dlx_incremental_solver), c_size_t]
+_libdlx.dlx_incremental_solver_push_hidden_row.restype = c_bool
+
+_libdlx.dlx_incremental_solver_pop.argtypes = [POINTER(_dlx_incremental_solver)]
+_libdlx.dlx_incremental_solver_pop.restype = None
+
+_libdlx.dlx_incremental_solver_num_assumptions.argtypes = [POINTER(_dlx_incremental_solver)]
+_libdlx.dlx_incremental_solver_num_assumptions.restype = c_size_t
+
+_libdlx.dlx_incremental_solver_count_solutions_up_to.argtypes = [POINTER(_dlx_incremental_solver), c_size_t, POINTER(c_size_t), POINTER(c_size_t)]
+_libdlx.dlx_incremental_solver_count_solutions_up_to.restype = c_size_t
+
+_libdlx.dlx_incremental_solver_is_unique.argtypes = [POINTER(_dlx_incremental_solver), POINTER(c_size_t), POINTER(c_size_t)]
+_libdlx.dlx_incremental_solver_is_unique.restype = c_bool
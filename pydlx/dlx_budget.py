@@ -0,0 +1,59 @@
+from ctypes import *
+
+from pydlx import _libdlx
+
+# Must match enum dlx_budget_status in libdlx/include/dlx_budget.h.
+BUDGET_OK = 0
+BUDGET_NODES = 1
+BUDGET_UPDATES = 2
+BUDGET_TIME = 3
+BUDGET_CANCELLED = 4
+
+class dlx_budget:
+	"""
+	Bounds the work done by a call to a solver, see
+	libdlx/include/dlx_budget.h.  Limits of 0 mean no limit.
+	"""
+	__dlx_budget = None
+
+	def __init__(self, max_nodes=0, max_updates=0, time_limit=0):
+		self.__dlx_budget = _libdlx.dlx_budget_create()
+		if not self.__dlx_budget:
+			raise MemoryError("dlx_budget: out of memory")
+		self.set_max_nodes(max_nodes)
+		self.set_max_updates(max_updates)
+		self.set_time_limit(time_limit)
+
+	def __enter__(self):
+		return self
+
+	def __exit__(self, exc_type, exc_value, traceback):
+		_libdlx.dlx_budget_destroy(self.__dlx_budget)
+		self.__dlx_budget = None
+
+	def _get_budget(self):
+		return self.__dlx_budget
+
+	def set_max_nodes(self, max_nodes):
+		_libdlx.dlx_budget_set_max_nodes(self.__dlx_budget, c_uint64(max_nodes))
+
+	def set_max_updates(self, max_updates):
+		_libdlx.dlx_budget_set_max_updates(self.__dlx_budget, c_uint64(max_updates))
+
+	def set_time_limit(self, seconds):
+		_libdlx.dlx_budget_set_time_limit(self.__dlx_budget, c_double(seconds))
+
+	def cancel(self):
+		_libdlx.dlx_budget_cancel(self.__dlx_budget)
+
+	def reset(self):
+		_libdlx.dlx_budget_reset(self.__dlx_budget)
+
+	def status(self):
+		return _libdlx.dlx_budget_status(self.__dlx_budget)
+
+	def nodes(self):
+		return _libdlx.dlx_budget_nodes(self.__dlx_budget)
+
+	def updates(self):
+		return _libdlx.dlx_budget_updates(self.__dlx_budget)
@@ -0,0 +1,16 @@
+from ctypes import *
+
+from pydlx import _libdlx, _dlx_estimate
+
+def estimate_search(matrix, probes, seed=0):
+	"""
+	Estimate the search for all solutions, see libdlx/include/dlx_estimator.h.
+	Returns a dict with 'nodes', 'solutions' and 'updates', each a
+	(mean, standard_error, low, high) tuple.  A matrix with multiplicities
+	raises a ValueError.
+	"""
+	estimate = _dlx_estimate()
+	if not _libdlx.dlx_estimate_search(matrix._get_matrix(), c_size_t(probes), c_uint(seed), byref(estimate)):
+		raise ValueError("dlx_estimator: matrix has multiplicities, or out of memory")
+	value = lambda v: (v.mean, v.standard_error, v.low, v.high)
+	return {'nodes': value(estimate.nodes), 'solutions': value(estimate.solutions), 'updates': value(estimate.updates)}
@@ -0,0 +1,58 @@
+from ctypes import *
+
+from pydlx import _libdlx
+
+class dlx_incremental_solver:
+	"""
+	Solves a matrix under a stack of forced and hidden rows, see
+	libdlx/include/dlx_incremental_solver.h.  Rows are given by their
+	index.  max_rows is the number of primary columns of the matrix.  A
+	matrix with colors or multiplicities raises a ValueError.
+	"""
+	__dlx_incremental_solver = None
+
+	def __init__(self, matrix, max_rows):
+		self.__dlx_incremental_solver = _libdlx.dlx_incremental_solver_create(matrix._get_matrix())
+		if not self.__dlx_incremental_solver:
+			raise ValueError("dlx_incremental_solver: matrix has colors or multiplicities, or out of memory")
+		self.__max_rows = max_rows
+
+	def __enter__(self):
+		return self
+
+	def __exit__(self, exc_type, exc_value, traceback):
+		_libdlx.dlx_incremental_solver_destroy(self.__dlx_incremental_solver)
+		self.__dlx_incremental_solver = None
+
+	def push_forced_row(self, row):
+		return _libdlx.dlx_incremental_solver_push_forced_row(self.__dlx_incremental_solver, c_size_t(row))
+
+	def push_hidden_row(self, row):
+		return _libdlx.dlx_incremental_solver_push_hidden_row(self.__dlx_incremental_solver, c_size_t(row))
+
+	def pop(self):
+		_libdlx.dlx_incremental_solver_pop(self.__dlx_incremental_solver)
+
+	def num_assumptions(self):
+		return _libdlx.dlx_incremental_solver_num_assumptions(self.__dlx_incremental_solver)
+
+	def count_solutions_up_to(self, limit):
+		"""
+		Returns the count, at most limit (0 for no limit), and a solution
+		or None.
+		"""
+		solution = (c_size_t * (self.__max_rows + self.num_assumptions() + 1))()
+		num_rows = c_size_t(0)
+		count = _libdlx.dlx_incremental_solver_count_solutions_up_to(self.__dlx_incremental_solver, c_size_t(limit), solution, byref(num_rows))
+		return (count, solution[:num_rows.value] if count > 0 else None)
+
+	def is_unique(self):
+		"""
+		Returns whether there is exactly one solution, and a solution or
+		None.
+		"""
+		solution = (c_size_t * (self.__max_rows + self.num_assumptions() + 1))()
+		# Not touched if there is no solution.
+		num_rows = c_size_t(-1)
+		unique = _libdlx.dlx_incremental_solver_is_unique(self.__dlx_incremental_solver, solution, byref(num_rows))
+		return (unique, solution[:num_rows.value] if num_rows.value != c_size_t(-1).value else None)
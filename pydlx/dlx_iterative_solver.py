@@ -6,7 +6,12 @@ class dlx_iterative_solver:
 	__dlx_iterative_solver = None
 
 	def __init__(self, matrix):
+		"""
+		A matrix with multiplicities raises a ValueError.
+		"""
 		self.__dlx_iterative_solver = _libdlx.dlx_iterative_solver_create(matrix._get_matrix())
+		if not self.__dlx_iterative_solver:
+			raise ValueError("dlx_iterative_solver: matrix has multiplicities, or out of memory")
 
 	def __enter__(self):
 		return self
@@ -15,6 +20,25 @@ class dlx_iterative_solver:
 		_libdlx.dlx_iterative_solver_destroy(self.__dlx_iterative_solver)
 		self.__dlx_iterative_solver = None
 
+	def set_budget(self, budget):
+		"""
+		Bound every later call to get_next_solution, None for no bound.  A
+		call that runs out of budget returns False, see budget.status().
+		"""
+		_libdlx.dlx_iterative_solver_set_budget(self.__dlx_iterative_solver, budget._get_budget() if budget else None)
+
+	def save(self, path):
+		if not _libdlx.dlx_iterative_solver_save(self.__dlx_iterative_solver, path.encode()):
+			raise IOError("dlx_iterative_solver: can't write %s" % path)
+
+	def load(self, path):
+		"""
+		Continue the search saved in path, the matrix has to be built the
+		same way as the one it was saved for.
+		"""
+		if not _libdlx.dlx_iterative_solver_load(self.__dlx_iterative_solver, path.encode()):
+			raise IOError("dlx_iterative_solver: %s is not a checkpoint for this matrix" % path)
+
 	def get_next_solution(self):
 		found_solution = _libdlx.dlx_iterative_solver_find_solution(self.__dlx_iterative_solver)
 		if not found_solution:
@@ -26,3 +50,15 @@ class dlx_iterative_solver:
 
 	def get_row(self, row_index):
 		return _libdlx.dlx_iterative_solver_get_solution_row(self.__dlx_iterative_solver, c_size_t(row_index))
+
+def find_solution_portfolio(matrix, max_rows, num_searches=0, seed=0):
+	"""
+	Race num_searches randomized searches for a single solution, returns it
+	or None.  max_rows is the number of primary columns of the matrix.  A
+	matrix with multiplicities has none.
+	"""
+	solution = (c_size_t * max(max_rows, 1))()
+	num_rows = c_size_t(0)
+	if not _libdlx.dlx_iterative_solver_find_solution_portfolio(matrix._get_matrix(), c_size_t(num_searches), c_uint(seed), solution, byref(num_rows)):
+		return None
+	return solution[:num_rows.value]
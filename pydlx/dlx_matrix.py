@@ -2,11 +2,27 @@ from ctypes import *
 
 from pydlx import _libdlx
 
+_libc = CDLL(None)
+
+# Values of enum dlx_engine
+ENGINE_LINKED = 0
+ENGINE_CELLS = 1
+
+# Values of enum dlx_column_selection
+SELECTION_SCAN = 0
+SELECTION_BUCKETS = 1
+
 class dlx_matrix:
 	__dlx_matrix = None
 
-	def __init__(self, num_primary_columns, num_secondary_columns, num_ones):
-		self.__dlx_matrix = _libdlx.dlx_matrix_create(c_size_t(num_primary_columns), c_size_t(num_secondary_columns), c_size_t(num_ones))
+	def __init__(self, num_primary_columns, num_secondary_columns, num_ones=None):
+		"""
+		Leave out num_ones to get a matrix that grows as rows are added.
+		"""
+		if num_ones is None:
+			self.__dlx_matrix = _libdlx.dlx_matrix_create_growable(c_size_t(num_primary_columns), c_size_t(num_secondary_columns))
+		else:
+			self.__dlx_matrix = _libdlx.dlx_matrix_create(c_size_t(num_primary_columns), c_size_t(num_secondary_columns), c_size_t(num_ones))
 
 	def __enter__(self):
 		return self
@@ -19,9 +35,106 @@ class dlx_matrix:
 		return self.__dlx_matrix
 
 	def add_row(self, column_indices, user_data):
-		_libdlx.dlx_matrix_begin_new_row(self.__dlx_matrix, c_size_t(user_data))
+		"""
+		A one in a secondary column can be given a color by passing a
+		(column index, color) pair instead of the column index.
+		"""
+		if not _libdlx.dlx_matrix_begin_new_row(self.__dlx_matrix, c_size_t(user_data)):
+			raise MemoryError("dlx_matrix: node pool exhausted")
 		for index in column_indices:
-			_libdlx.dlx_matrix_current_row_set_one(self.__dlx_matrix, c_size_t(index))
+			(index, color) = index if isinstance(index, tuple) else (index, 0)
+			if not _libdlx.dlx_matrix_current_row_set_colored_one(self.__dlx_matrix, c_size_t(index), c_uint32(color)):
+				raise MemoryError("dlx_matrix: node pool exhausted or column or color out of range")
+
+	def add_rows(self, rows, user_data=None):
+		"""
+		Add a list of rows (lists of column indices, or pairs of a column
+		index and a color, see add_row) in a single call.  user_data
+		defaults to the index of each row in the matrix.
+		"""
+		offsets = [0]
+		for row in rows:
+			offsets.append(offsets[-1] + len(row))
+		ones = [index if isinstance(index, tuple) else (index, 0) for row in rows for index in row]
+		c_offsets = (c_size_t * len(offsets))(*offsets)
+		c_columns = (c_size_t * offsets[-1])(*[index for index, color in ones])
+		c_colors = None
+		if any(color != 0 for index, color in ones):
+			c_colors = (c_uint32 * offsets[-1])(*[color for index, color in ones])
+		c_user_data = None
+		if user_data is not None:
+			c_user_data = (c_void_p * len(rows))(*user_data)
+		if not _libdlx.dlx_matrix_add_colored_rows(self.__dlx_matrix, c_size_t(len(rows)), c_offsets, c_columns, c_colors, c_user_data, None):
+			raise MemoryError("dlx_matrix: node pool exhausted or column or color out of range")
+
+	@staticmethod
+	def load(path):
+		"""
+		Load a matrix from a binary matrix file (see libdlx/include/matrix_file.h).
+		"""
+		mat = dlx_matrix.__new__(dlx_matrix)
+		mat.__dlx_matrix = _libdlx.dlx_matrix_load(path.encode())
+		if not mat.__dlx_matrix:
+			raise IOError("dlx_matrix: can't load " + path)
+		return mat
+
+	def save(self, path):
+		if not _libdlx.dlx_matrix_save(self.__dlx_matrix, path.encode()):
+			raise IOError("dlx_matrix: can't save " + path)
+
+	def clone(self):
+		copy = dlx_matrix.__new__(dlx_matrix)
+		copy.__dlx_matrix = _libdlx.dlx_matrix_clone(self.__dlx_matrix)
+		if not copy.__dlx_matrix:
+			raise MemoryError("dlx_matrix: out of memory")
+		return copy
+
+	def preprocess(self):
+		"""
+		Returns the reduced matrix, the user_data of the rows that are in
+		every solution and the index in this matrix of every row of the
+		reduced one, see dlx_matrix_preprocess.
+		"""
+		forced = POINTER(c_size_t)()
+		num_forced = c_size_t(0)
+		rows = POINTER(c_size_t)()
+		num_rows = c_size_t(0)
+		reduced = dlx_matrix.__new__(dlx_matrix)
+		reduced.__dlx_matrix = _libdlx.dlx_matrix_preprocess(self.__dlx_matrix, byref(forced), byref(num_forced), byref(rows), byref(num_rows))
+		if not reduced.__dlx_matrix:
+			raise MemoryError("dlx_matrix: out of memory")
+		result = (reduced, forced[:num_forced.value], rows[:num_rows.value])
+		_libc.free(forced)
+		_libc.free(rows)
+		return result
+
+	def set_column_multiplicity(self, column, lo, hi):
+		"""
+		Have between lo and hi rows of a solution cover a primary column.
+		"""
+		if not _libdlx.dlx_matrix_set_column_multiplicity(self.__dlx_matrix, c_size_t(column), c_size_t(lo), c_size_t(hi)):
+			raise ValueError("dlx_matrix: column or multiplicity out of range")
+
+	def add_symmetry(self, rows, columns):
+		"""
+		Tell the solvers that mapping every row i to rows[i] and every
+		column j to columns[j] maps the matrix onto itself.
+		"""
+		if not _libdlx.dlx_matrix_add_symmetry(self.__dlx_matrix, (c_size_t * max(len(rows), 1))(*rows), (c_size_t * max(len(columns), 1))(*columns)):
+			raise ValueError("dlx_matrix: not a symmetry of the matrix")
+
+	def set_engine(self, engine):
+		_libdlx.dlx_matrix_set_engine(self.__dlx_matrix, c_int(engine))
+
+	def set_column_selection(self, selection):
+		_libdlx.dlx_matrix_set_column_selection(self.__dlx_matrix, c_int(selection))
+
+	def set_bitset_columns(self, columns):
+		_libdlx.dlx_matrix_set_bitset_columns(self.__dlx_matrix, c_size_t(columns))
+
+	def finalize(self):
+		if not _libdlx.dlx_matrix_finalize(self.__dlx_matrix, None, c_size_t(0)):
+			raise MemoryError("dlx_matrix: out of memory")
 
 	def reset(self):
 		self.libdlx.dlx_matrix_reset(self.__dlx_matrix)
@@ -1,6 +1,105 @@
 from ctypes import *
 
-from pydlx import _libdlx
+from pydlx import _libdlx, _dlx_solution_callback, _dlx_weighted_solution_callback, _dlx_subproblem_callback, _dlx_count, _dlx_branch_count
+
+_libc = CDLL(None)
 
 def count_solutions(matrix):
-	return _libdlx.dlx_recursive_solver_count_solutions(matrix._get_matrix())
\ No newline at end of file
+	return _libdlx.dlx_recursive_solver_count_solutions(matrix._get_matrix())
+
+def count_solutions_budget(matrix, budget):
+	"""
+	Returns the solutions found before running out of budget, see
+	budget.status().
+	"""
+	return _libdlx.dlx_recursive_solver_count_solutions_budget(matrix._get_matrix(), budget._get_budget())
+
+def count_solutions_wide(matrix):
+	return _libdlx.dlx_recursive_solver_count_solutions_wide(matrix._get_matrix()).value()
+
+def count_solutions_breakdown(matrix, levels):
+	"""
+	Returns the count and a dict mapping (level, row) to the count under
+	that row at that level.
+	"""
+	total = _dlx_count()
+	branches = POINTER(_dlx_branch_count)()
+	num_branches = c_size_t(0)
+	if not _libdlx.dlx_recursive_solver_count_solutions_breakdown(matrix._get_matrix(), c_size_t(levels), byref(total), byref(branches), byref(num_branches)):
+		raise MemoryError("dlx_recursive_solver: out of memory")
+	breakdown = {}
+	if levels > 0:
+		breakdown = dict(((b.level, b.user_data), b.count.value()) for b in branches[:num_branches.value])
+		_libc.free(branches)
+	return (total.value(), breakdown)
+
+def count_solutions_up_to(matrix, limit, max_rows):
+	"""
+	Count at most limit solutions (0 for no limit), returns the count and
+	the first solution or None.  max_rows is the number of primary columns
+	of the matrix, or of rows if it has multiplicities.
+	"""
+	solution = (c_size_t * max(max_rows, 1))()
+	num_rows = c_size_t(0)
+	count = _libdlx.dlx_recursive_solver_count_solutions_up_to(matrix._get_matrix(), c_size_t(limit), solution, byref(num_rows))
+	return (count, solution[:num_rows.value] if count > 0 else None)
+
+def is_unique(matrix, max_rows):
+	"""
+	Returns whether there is exactly one solution, and the first solution
+	or None.
+	"""
+	solution = (c_size_t * max(max_rows, 1))()
+	# Not touched if there is no solution.
+	num_rows = c_size_t(-1)
+	unique = _libdlx.dlx_recursive_solver_is_unique(matrix._get_matrix(), solution, byref(num_rows))
+	return (unique, solution[:num_rows.value] if num_rows.value != c_size_t(-1).value else None)
+
+def split(matrix, depth):
+	"""
+	Returns the subproblems depth levels down, each a list of row indices,
+	their counts add up to the count of the matrix.  A matrix with
+	multiplicities raises a ValueError.
+	"""
+	subproblems = []
+	def wrapper(rows, num_rows, ctx):
+		subproblems.append(rows[:num_rows])
+		return True
+	if not _libdlx.dlx_recursive_solver_split(matrix._get_matrix(), c_size_t(depth), _dlx_subproblem_callback(wrapper), None):
+		raise ValueError("dlx_recursive_solver: matrix has multiplicities, or out of memory")
+	return subproblems
+
+def count_subproblem(matrix, rows):
+	"""
+	Count the solutions of a subproblem returned by split, returns None if
+	rows is not a subproblem of the matrix or it has multiplicities.
+	"""
+	count = _dlx_count()
+	if not _libdlx.dlx_recursive_solver_count_subproblem(matrix._get_matrix(), (c_size_t * max(len(rows), 1))(*rows), c_size_t(len(rows)), byref(count)):
+		return None
+	return count.value()
+
+def count_solutions_parallel(matrix, num_threads=0):
+	"""
+	num_threads defaults to one thread per online CPU.
+	"""
+	return _libdlx.dlx_recursive_solver_count_solutions_parallel(matrix._get_matrix(), c_size_t(num_threads)).value()
+
+def enumerate_solutions(matrix, callback):
+	"""
+	Call callback with every solution (a list of rows) until it returns
+	False, returns the number of solutions passed to it.
+	"""
+	def wrapper(rows, num_rows, ctx):
+		return callback(rows[:num_rows]) is not False
+	return _libdlx.dlx_recursive_solver_enumerate(matrix._get_matrix(), _dlx_solution_callback(wrapper), None)
+
+def enumerate_up_to_symmetry(matrix, callback):
+	"""
+	Call callback with every solution left after breaking symmetries (a
+	list of rows) and the number of solutions it stands for, until it
+	returns False.  Returns the number of solutions passed to it.
+	"""
+	def wrapper(rows, num_rows, weight, ctx):
+		return callback(rows[:num_rows], weight) is not False
+	return _libdlx.dlx_recursive_solver_enumerate_up_to_symmetry(matrix._get_matrix(), _dlx_weighted_solution_callback(wrapper), None)
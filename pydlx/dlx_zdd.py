@@ -0,0 +1,64 @@
+from ctypes import *
+
+from pydlx import _libdlx, _dlx_solution_callback, _dlx_count
+
+class dlx_zdd:
+	"""
+	All solutions of a matrix as a zero-suppressed decision diagram, see
+	libdlx/include/dlx_zdd.h.  max_rows is the number of primary columns
+	of the matrix.  A matrix with colors or multiplicities raises a
+	ValueError.
+	"""
+	__dlx_zdd = None
+
+	def __init__(self, matrix, max_rows, cache_bytes=0, seed=1):
+		self.__dlx_zdd = _libdlx.dlx_zdd_create(matrix._get_matrix(), c_size_t(cache_bytes))
+		if not self.__dlx_zdd:
+			raise ValueError("dlx_zdd: matrix has colors or multiplicities, or out of memory")
+		self.__max_rows = max(max_rows, 1)
+		self.__state = c_uint64(seed)
+
+	def __enter__(self):
+		return self
+
+	def __exit__(self, exc_type, exc_value, traceback):
+		_libdlx.dlx_zdd_destroy(self.__dlx_zdd)
+		self.__dlx_zdd = None
+
+	def num_nodes(self):
+		return _libdlx.dlx_zdd_num_nodes(self.__dlx_zdd)
+
+	def count(self):
+		return _libdlx.dlx_zdd_count(self.__dlx_zdd).value()
+
+	def get_solution(self, index):
+		"""
+		Returns solution number index in the order the solvers find them,
+		or None if there are fewer solutions.
+		"""
+		solution = (c_size_t * self.__max_rows)()
+		num_rows = c_size_t(0)
+		index = _dlx_count(index & (2 ** 64 - 1), index >> 64)
+		if not _libdlx.dlx_zdd_get_solution(self.__dlx_zdd, index, solution, byref(num_rows)):
+			return None
+		return solution[:num_rows.value]
+
+	def sample(self):
+		"""
+		Returns a solution picked uniformly at random, or None if there
+		are none.
+		"""
+		solution = (c_size_t * self.__max_rows)()
+		num_rows = c_size_t(0)
+		if not _libdlx.dlx_zdd_sample(self.__dlx_zdd, byref(self.__state), solution, byref(num_rows)):
+			return None
+		return solution[:num_rows.value]
+
+	def enumerate(self, callback):
+		"""
+		Call callback with every solution (a list of rows) until it returns
+		False, returns the number of solutions passed to it.
+		"""
+		def wrapper(rows, num_rows, ctx):
+			return callback(rows[:num_rows]) is not False
+		return _libdlx.dlx_zdd_enumerate(self.__dlx_zdd, _dlx_solution_callback(wrapper), None)
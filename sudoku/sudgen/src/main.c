@@ -50,9 +50,10 @@
 static char grid[NUM_CELLS];
 
 /**
- * Initialize the matrix.
+ * Initialize the matrix.  The matrix numbers the rows in the order they
+ * are added, \c row_numbers receives the number of every row id.
  */
-void initialize_matrix(struct dlx_matrix *m, struct node **row_ptrs)
+void initialize_matrix(struct dlx_matrix *m, size_t *row_numbers)
 {
 	/* Shuffle the rows to ensure that the solver generates a random sudoku
 	 * grid. */
@@ -69,7 +70,8 @@ void initialize_matrix(struct dlx_matrix *m, struct node **row_ptrs)
 		size_t v = row_index % PUZZLE_SIZE;
 		size_t b = r / BOXSIZE * BOXSIZE + c / BOXSIZE;
 
-		row_ptrs[row_index] = dlx_matrix_begin_new_row(m, (void *)PACK_RCV(r, c, v));
+		row_numbers[row_index] = i;
+		dlx_matrix_begin_new_row(m, (void *)PACK_RCV(r, c, v));
 		/* row/value */
 		dlx_matrix_current_row_set_one(m, r * PUZZLE_SIZE + v); /* 0 - 80 */
 		/* column/value */
@@ -83,21 +85,51 @@ void initialize_matrix(struct dlx_matrix *m, struct node **row_ptrs)
 	free(row_indices);
 }
 
-void find_filled_sudoku_grid(struct dlx_solver *s)
+void find_filled_sudoku_grid(struct dlx_matrix *m)
 {
-	if (!dlx_iterative_solver_find_solution(s)) {
+	/* Race a search per CPU, each in its own random column order, so that
+	 * an unlucky order can't hold up the generator. */
+	const void *solution[NUM_MATRIX_COLUMNS];
+	size_t num_solution_rows;
+
+	if (!dlx_iterative_solver_find_solution_portfolio(m, 0, (unsigned int)rand(), solution, &num_solution_rows)) {
 		fprintf(stderr, "Couldn't find initial solution, shouldn't happen.");
 		exit(1);
 	}
 
 	/* num_solution_rows is always equal to NUM_CELLS */
-	size_t num_solution_rows = dlx_iterative_solver_num_solution_rows(s);
 	for (size_t i = 0; i < num_solution_rows; ++i) {
-		size_t ri = (size_t)dlx_iterative_solver_get_solution_row(s, i);
+		size_t ri = (size_t)solution[i];
 		grid[UNPACK_R(ri) * PUZZLE_SIZE + UNPACK_C(ri)] = (char)UNPACK_V(ri);
 	}
+}
 
-	dlx_iterative_solver_reset(s);
+/**
+ * Hide the rows for every value of a cell except the one in `grid'.
+ */
+static void fill_in_cell(struct dlx_incremental_solver *solver, const size_t *row_numbers, size_t cell)
+{
+	const size_t r = cell / PUZZLE_SIZE;
+	const size_t c = cell % PUZZLE_SIZE;
+
+	/* We need to hide 8 rows */
+	for (char v = 0; v < PUZZLE_SIZE; ++v) {
+		if (v == grid[cell]) {
+			continue;
+		}
+		size_t row_id = r * NUM_CELLS + c * PUZZLE_SIZE + v;
+		dlx_incremental_solver_push_hidden_row(solver, row_numbers[row_id]);
+	}
+}
+
+/**
+ * Take back the rows hidden by the last fill_in_cell.
+ */
+static void empty_cell(struct dlx_incremental_solver *solver)
+{
+	for (size_t i = 0; i < PUZZLE_SIZE - 1; ++i) {
+		dlx_incremental_solver_pop(solver);
+	}
 }
 
 /**
@@ -121,8 +153,12 @@ void find_filled_sudoku_grid(struct dlx_solver *s)
  * fill
  * it back in by /removing/ all the 9 rows for the cell in question except the 1
  * representing the given.
+ *
+ * The rows are hidden as assumptions of an incremental solver.  Once it has
+ * seen that the puzzle has a unique solution, a second one has to use one of
+ * the rows added back since, so every check only searches below those.
  */
-void reduce_grid(struct dlx_solver *s, struct node **row_ptrs)
+void reduce_grid(struct dlx_incremental_solver *solver, const size_t *row_numbers)
 {
 	/**
 	 * Let's try removing the givens in the cells 1 by 1, we will shuffle a
@@ -140,72 +176,56 @@ void reduce_grid(struct dlx_solver *s, struct node **row_ptrs)
 	/**
 	 * We begin by hiding all the rows in the matrix except for the 81 rows
 	 * that
-	 * represent the solution to `grid'.
+	 * represent the solution to `grid'.  The cell we try first ends up on
+	 * top of the solver's stack of assumptions.
 	 */
 	for (size_t i = 0; i < NUM_CELLS; ++i) {
-		size_t to_remove = positions[i];
-		size_t r = to_remove / PUZZLE_SIZE;
-		size_t c = to_remove % PUZZLE_SIZE;
-
-		/* We need to hide 8 rows */
-		for (char v = 0; v < PUZZLE_SIZE; ++v) {
-			if (v == grid[to_remove]) {
-				continue;
-			}
-			size_t row_id = r * NUM_CELLS + c * PUZZLE_SIZE + v;
-			dlx_matrix_hide_row(row_ptrs[row_id]);
-		}
+		fill_in_cell(solver, row_numbers, positions[i]);
 	}
 
+	/* Cells that keep their given, their rows are pushed back on top. */
+	size_t kept[NUM_CELLS];
+	size_t num_kept = 0;
+
 	/* And add them back one by one (if possible) */
 	for (size_t i = 0; i < NUM_CELLS; ++i) {
 		size_t to_remove = positions[NUM_CELLS - 1 - i];
-		size_t r = to_remove / PUZZLE_SIZE;
-		size_t c = to_remove % PUZZLE_SIZE;
-
-		/* We need to unhide 8 rows */
-		for (char v = 0; v < PUZZLE_SIZE; ++v) {
-			if (v == grid[to_remove]) {
-				continue;
-			}
-			size_t row_id = r * NUM_CELLS + c * PUZZLE_SIZE + v;
-			dlx_matrix_unhide_row(row_ptrs[row_id]);
+
+		/* Get at the cell's rows from under those of the kept cells,
+		 * and put those back. */
+		for (size_t k = 0; k < num_kept; ++k) {
+			empty_cell(solver);
+		}
+		empty_cell(solver);
+		for (size_t k = 0; k < num_kept; ++k) {
+			fill_in_cell(solver, row_numbers, kept[k]);
 		}
 
 		/**
-		 * Find the first solution.  This should always be possible
-		 * because we have only enlarged
-		 * the search space.
+		 * Count the solutions, up to 2.  There should always be one
+		 * because we have only enlarged the search space.
 		 */
-		if (!dlx_iterative_solver_find_solution(s)) {
+		const size_t num_solutions = dlx_incremental_solver_count_solutions_up_to(solver, 2, 0, 0);
+		if (num_solutions == 0) {
 			/* Famous last words :-) */
 			fprintf(stderr, "No solution anymore, shouldn't happen.\n");
 			exit(1);
 		}
 
 		/**
-		 * If we can find a second solution: too bad.  The puzzle is not
+		 * If there is a second solution: too bad.  The puzzle is not
 		 * unique anymore,
 		 * we re-add the rows and try the next cell.
 		 */
-		if (dlx_iterative_solver_find_solution(s)) {
-			dlx_iterative_solver_reset(s);
-
+		if (num_solutions > 1) {
 			/* Make it unique again by ƒilling in the value. */
-			for (char v = 0; v < PUZZLE_SIZE; ++v) {
-				if (v == grid[to_remove]) {
-					continue;
-				}
-				size_t row_id = r * NUM_CELLS + c * PUZZLE_SIZE + v;
-				dlx_matrix_hide_row(row_ptrs[row_id]);
-			}
-
+			fill_in_cell(solver, row_numbers, to_remove);
+			kept[num_kept++] = to_remove;
 			continue;
 		}
 
 		/* Remove the given value. */
 		grid[to_remove] = EMPTY_CELL;
-		dlx_iterative_solver_reset(s);
 	}
 }
 
@@ -222,14 +242,23 @@ int main(__attribute__((unused)) int argc, __attribute__((unused)) char *argv[])
 
 	srand((unsigned int)(seed.tv_sec ^ seed.tv_usec));
 
-	/* Keep a list of pointers to the rows in the matrix */
-	struct node **row_ptrs = malloc(sizeof(*row_ptrs) * NUM_MATRIX_ROWS);
+	/* Keep the number of every row in the matrix */
+	size_t *row_numbers = malloc(sizeof(*row_numbers) * NUM_MATRIX_ROWS);
 
 	struct dlx_matrix *m = dlx_matrix_create(NUM_MATRIX_COLUMNS, 0, NUM_MATRIX_NODES);
-	initialize_matrix(m, row_ptrs);
-	struct dlx_solver *s = dlx_iterative_solver_create(m);
-	find_filled_sudoku_grid(s);
-	reduce_grid(s, row_ptrs);
+	initialize_matrix(m, row_numbers);
+	/* The rows were added in random order, put them back in a cache
+	 * friendly order.  Search order (and thus randomness) is kept. */
+	dlx_matrix_finalize(m, 0, 0);
+	find_filled_sudoku_grid(m);
+
+	struct dlx_incremental_solver *solver = dlx_incremental_solver_create(m);
+	if (solver == 0) {
+		fprintf(stderr, "Out of memory.\n");
+		exit(1);
+	}
+	reduce_grid(solver, row_numbers);
+	dlx_incremental_solver_destroy(solver);
 
 	/* Print it. */
 	for (size_t i = 0; i < NUM_CELLS; ++i) {
@@ -237,8 +266,7 @@ int main(__attribute__((unused)) int argc, __attribute__((unused)) char *argv[])
 	}
 	putchar('\n');
 
-	free(row_ptrs);
-	dlx_iterative_solver_destroy(s);
+	free(row_numbers);
 	dlx_matrix_destroy(m);
 	exit(0);
 }
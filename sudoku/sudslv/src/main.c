@@ -75,29 +75,26 @@ int solve(char *grid, struct dlx_matrix *m)
 {
 	initialize_matrix(grid, m);
 
-	struct dlx_solver *s = dlx_iterative_solver_create(m);
+	/* Look for two solutions, the first one is kept. */
+	const void *solution[NUM_MATRIX_COLUMNS];
+	size_t num_solution_rows;
+	const size_t num_solutions = dlx_recursive_solver_count_solutions_up_to(m, 2, solution, &num_solution_rows);
 
-	/* Find a solution. */
-	if (!dlx_iterative_solver_find_solution(s)) {
-		dlx_iterative_solver_destroy(s);
+	if (num_solutions == 0) {
 		return PUZZLE_HAS_NO_SOLUTION;
 	}
 
 	/* Get the solution */
-	size_t num_solution_rows = dlx_iterative_solver_num_solution_rows(s);
 	for (size_t i = 0; i < num_solution_rows; ++i) {
-		size_t ri = (size_t)dlx_iterative_solver_get_solution_row(s, i);
+		size_t ri = (size_t)solution[i];
 		grid[UNPACK_R(ri) * PUZZLE_SIZE + UNPACK_C(ri)] = (char)(UNPACK_V(ri) + '1');
 	}
 
-	/* Check for multiple solutions. */
-	if (dlx_iterative_solver_find_solution(s)) {
-		dlx_iterative_solver_destroy(s);
+	if (num_solutions > 1) {
 		return PUZZLE_HAS_MULTIPLE_SOLUTIONS;
 	}
 
 	/* Solution is unique. */
-	dlx_iterative_solver_destroy(s);
 	return PUZZLE_HAS_UNIQUE_SOLUTION;
 }
 